@@ -0,0 +1,704 @@
+/*
+ * ============================================================================
+ * FIRA - Host Fault-Injection Campaign Engine
+ * Fork-per-experiment bit flips on a golden run of the host build
+ * ============================================================================
+ *
+ * The simulator runs the firmware normally (the golden run) up to the
+ * injection point. There the process becomes the controller and forks:
+ *
+ *   1. a reference run with no fault, which records the UART output of the
+ *      observation window and the final RAM / register state;
+ *   2. one worker per core. Workers pull experiment ids from a shared
+ *      counter and fork() once per experiment, so every experiment starts
+ *      from the identical copy-on-write snapshot.
+ *
+ * An experiment flips one bit (chosen from the experiment id and --seed) in
+ * the firmware's .data/.bss/.noinit or in the I/O register file, runs for
+ * the window and is classified against the reference:
+ *
+ *   reset with WDRF           -> wdt_reset
+ *   reset without flags       -> crash (wild jump, bad vector, host fault)
+ *   no progress in wall time  -> hang
+ *   more detection markers    -> detected
+ *   other output difference   -> sdc
+ *   same output, state differs-> latent
+ *   identical                 -> benign
+ *
+ * The simulator is deterministic, so any difference from the reference is
+ * caused by the flip. Note that host pointers are 8 bytes: a flip in the
+ * upper bytes of a pointer is a crash here where the AVR has no such bits.
+ */
+
+#include "atmega328p.h"
+#include "config.h"
+#include "campaign.h"
+#include "sim.h"
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define CAMPAIGN_UART_MAX       (256U * 1024U)  /* Reference output per window */
+#define CAMPAIGN_WALL_LIMIT_S   10U             /* Wall budget per experiment */
+#define CAMPAIGN_IO_FIRST       0x20U           /* Skip the CPU register file */
+#define CAMPAIGN_IO_COUNT       (0x100U - CAMPAIGN_IO_FIRST)
+
+#define TARGET_SRAM             0x01U
+#define TARGET_IO               0x02U
+
+/* Firmware data sections, renamed by the Makefile (see $(HOST_FW) in the Makefile) */
+extern "C" char __start_fira_data[] __attribute__((weak));
+extern "C" char __stop_fira_data[] __attribute__((weak));
+extern "C" char __start_fira_bss[] __attribute__((weak));
+extern "C" char __stop_fira_bss[] __attribute__((weak));
+extern "C" char __start_fira_noinit[] __attribute__((weak));
+extern "C" char __stop_fira_noinit[] __attribute__((weak));
+
+
+/* ============================================================================
+ * STATE
+ * ============================================================================ */
+
+typedef enum {
+    ROLE_GOLDEN = 0,            /* Before the injection point */
+    ROLE_REFERENCE,             /* Fault-free copy of the window */
+    ROLE_EXPERIMENT
+} campaign_role_t;
+
+typedef struct {
+    uint8_t *base;
+    uint32_t len;
+} campaign_region_t;
+
+typedef struct {
+    uint32_t offset;            /* SRAM offset or I/O address */
+    uint8_t  region;            /* TARGET_SRAM or TARGET_IO */
+    uint8_t  bit;
+    uint8_t  outcome;           /* campaign_outcome_t */
+    uint8_t  done;
+    uint64_t latency;           /* Cycles from injection to the outcome */
+} campaign_result_t;
+
+/* Shared between every process of the campaign */
+typedef struct {
+    uint64_t next_id;
+    uint64_t finished;
+    uint32_t ref_len;
+    uint32_t ref_marks;
+    uint8_t  ref_ok;
+} campaign_shared_t;
+
+static const char *const g_outcome_names[CAMPAIGN_OUTCOMES] = {
+    "benign", "latent", "detected", "sdc", "wdt_reset", "crash", "hang"
+};
+
+static uint8_t g_enabled = 0;
+static uint64_t g_count = 0;
+static double g_inject_s = 5.0;
+static double g_window_s = 5.0;
+static uint32_t g_jobs = 0;
+static uint64_t g_seed = 1;
+static uint8_t g_targets = TARGET_SRAM | TARGET_IO;
+static const char *g_results_path = "fira_campaign.csv";
+static const char *g_marker = "DETECTED";
+
+static campaign_region_t g_sram[3];
+static uint32_t g_sram_len = 0;
+static uint32_t g_sram_span = 0;            /* g_sram_len rounded up to 8 */
+
+static campaign_shared_t *g_shared;
+static uint8_t *g_ref_uart;
+static uint8_t *g_ref_sram;
+static uint8_t *g_ref_io;
+static campaign_result_t *g_results;
+
+/* Per-run observation (private to each forked run) */
+static campaign_role_t g_role = ROLE_GOLDEN;
+static uint64_t g_id = 0;
+static uint64_t g_inject_cycle = 0;
+static uint32_t g_out_len = 0;
+static uint32_t g_marks = 0;
+static uint32_t g_match = 0;
+static uint32_t g_marker_len = 0;
+static uint8_t g_diverged = 0;
+static uint64_t g_diverge_cycle = 0;
+static uint64_t g_mark_cycle = 0;
+static uint64_t g_last_out_cycle = 0;
+
+
+/* ============================================================================
+ * OPTIONS
+ * ============================================================================ */
+
+uint8_t campaign_parse_arg(int argc, char **argv, int *i)
+{
+    const char *opt = argv[*i];
+
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+
+    if (!strcmp(opt, "--campaign")) {
+        g_count = strtoull(argv[++*i], NULL, 0);
+        g_enabled = 1;
+    } else if (!strcmp(opt, "--inject-at")) {
+        g_inject_s = strtod(argv[++*i], NULL);
+    } else if (!strcmp(opt, "--window")) {
+        g_window_s = strtod(argv[++*i], NULL);
+    } else if (!strcmp(opt, "--jobs")) {
+        g_jobs = (uint32_t)strtoul(argv[++*i], NULL, 0);
+    } else if (!strcmp(opt, "--seed")) {
+        g_seed = strtoull(argv[++*i], NULL, 0);
+    } else if (!strcmp(opt, "--results")) {
+        g_results_path = argv[++*i];
+    } else if (!strcmp(opt, "--detect")) {
+        g_marker = argv[++*i];
+    } else if (!strcmp(opt, "--target")) {
+        const char *t = argv[++*i];
+        g_targets = !strcmp(t, "sram") ? TARGET_SRAM :
+                    !strcmp(t, "io")   ? TARGET_IO   : (TARGET_SRAM | TARGET_IO);
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+uint8_t campaign_enabled(void)
+{
+    return g_enabled;
+}
+
+/* ============================================================================
+ * SETUP
+ * ============================================================================ */
+
+static void campaign_add_region(uint8_t idx, char *start, char *stop)
+{
+    if (start && stop && stop > start) {
+        g_sram[idx].base = (uint8_t *)start;
+        g_sram[idx].len = (uint32_t)(stop - start);
+        g_sram_len += g_sram[idx].len;
+    }
+}
+
+void campaign_init(void)
+{
+    size_t size;
+    uint8_t *shm;
+
+    if (!g_enabled) {
+        return;
+    }
+
+    campaign_add_region(0, __start_fira_data, __stop_fira_data);
+    campaign_add_region(1, __start_fira_bss, __stop_fira_bss);
+    campaign_add_region(2, __start_fira_noinit, __stop_fira_noinit);
+
+    if (g_sram_len == 0) {
+        g_targets &= (uint8_t)~TARGET_SRAM;
+    }
+    if (g_jobs == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        g_jobs = n > 0 ? (uint32_t)n : 1U;
+    }
+    g_marker_len = (uint32_t)strlen(g_marker);
+    g_sram_span = (g_sram_len + 7U) & ~7U;
+
+    size = sizeof(campaign_shared_t) + CAMPAIGN_UART_MAX + g_sram_span + 0x100U +
+           (size_t)g_count * sizeof(campaign_result_t);
+    shm = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("[campaign] mmap");
+        exit(1);
+    }
+
+    g_shared = (campaign_shared_t *)shm;
+    g_ref_uart = shm + sizeof(campaign_shared_t);
+    g_ref_sram = g_ref_uart + CAMPAIGN_UART_MAX;
+    g_ref_io = g_ref_sram + g_sram_span;
+    g_results = (campaign_result_t *)(g_ref_io + 0x100U);
+
+    sim_set_limit((uint64_t)(g_inject_s * (double)F_CPU));
+}
+
+/* ============================================================================
+ * OBSERVATION
+ * ============================================================================ */
+
+uint8_t campaign_uart_byte(uint8_t byte)
+{
+    uint64_t now;
+
+    if (!g_enabled) {
+        return 0;
+    }
+    if (g_role == ROLE_GOLDEN) {
+        return 1;                   /* Lead-in output is not interesting */
+    }
+
+    now = sim_cycles();
+    g_last_out_cycle = now;
+
+    if (g_role == ROLE_REFERENCE) {
+        if (g_out_len < CAMPAIGN_UART_MAX) {
+            g_ref_uart[g_out_len] = byte;
+        }
+    } else if (!g_diverged &&
+               (g_out_len >= g_shared->ref_len || g_ref_uart[g_out_len] != byte)) {
+        g_diverged = 1;
+        g_diverge_cycle = now;
+    }
+    g_out_len++;
+
+    /* Detection marker (no self-overlap assumed, e.g. "DETECTED") */
+    if (g_marker_len) {
+        g_match = (byte == (uint8_t)g_marker[g_match]) ? g_match + 1 :
+                  (byte == (uint8_t)g_marker[0]) ? 1U : 0U;
+        if (g_match == g_marker_len) {
+            g_match = 0;
+            g_marks++;
+            if (g_diverged && !g_mark_cycle) {
+                g_mark_cycle = now;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static uint8_t campaign_state_differs(void)
+{
+    const uint8_t *io = sim_io_space();
+    const uint8_t *ref = g_ref_sram;
+    uint8_t r;
+
+    for (r = 0; r < 3; r++) {
+        if (g_sram[r].len && memcmp(g_sram[r].base, ref, g_sram[r].len)) {
+            return 1;
+        }
+        ref += g_sram[r].len;
+    }
+
+    return memcmp(io, g_ref_io, 0x100U) != 0;
+}
+
+static void campaign_finish(campaign_outcome_t outcome, uint64_t at)
+{
+    campaign_result_t *res = &g_results[g_id];
+
+    res->outcome = (uint8_t)outcome;
+    res->latency = at > g_inject_cycle ? at - g_inject_cycle : 0;
+    __atomic_store_n(&res->done, 1, __ATOMIC_RELEASE);
+    _exit(0);
+}
+
+static void campaign_on_alarm(int sig)
+{
+    (void)sig;
+    campaign_finish(CAMPAIGN_HANG, sim_cycles());
+}
+
+static void campaign_end_reference(void)
+{
+    const uint8_t *io = sim_io_space();
+    uint8_t *dst = g_ref_sram;
+    uint8_t r;
+
+    for (r = 0; r < 3; r++) {
+        memcpy(dst, g_sram[r].base, g_sram[r].len);
+        dst += g_sram[r].len;
+    }
+    memcpy(g_ref_io, io, 0x100U);
+
+    g_shared->ref_len = g_out_len;
+    g_shared->ref_marks = g_marks;
+    g_shared->ref_ok = (g_out_len <= CAMPAIGN_UART_MAX);
+    _exit(0);
+}
+
+static void campaign_end_experiment(void)
+{
+    if (g_diverged || g_out_len != g_shared->ref_len) {
+        if (g_marks > g_shared->ref_marks) {
+            campaign_finish(CAMPAIGN_DETECTED, g_mark_cycle ? g_mark_cycle : g_diverge_cycle);
+        }
+        if (!g_diverged) {
+            /* Output is a strict prefix of the reference: it just stopped */
+            campaign_finish(CAMPAIGN_HANG, g_last_out_cycle);
+        }
+        campaign_finish(CAMPAIGN_SDC, g_diverge_cycle);
+    }
+
+    if (campaign_state_differs()) {
+        campaign_finish(CAMPAIGN_LATENT, sim_cycles());
+    }
+    campaign_finish(CAMPAIGN_BENIGN, g_inject_cycle);
+}
+
+void campaign_on_reset(uint8_t mcusr)
+{
+    if (g_role == ROLE_EXPERIMENT) {
+        campaign_finish(BIT_GET(mcusr, MCUSR_WDRF) ? CAMPAIGN_WDT_RESET : CAMPAIGN_CRASH,
+                        sim_cycles());
+    }
+    if (g_role == ROLE_REFERENCE) {
+        fprintf(stderr, "[campaign] reference run reset inside the window\n");
+        g_shared->ref_ok = 0;
+        _exit(1);
+    }
+}
+
+/* ============================================================================
+ * INJECTION
+ * ============================================================================ */
+
+static uint64_t campaign_mix(uint64_t x)
+{
+    /* splitmix64 */
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void campaign_pick(uint64_t id, campaign_result_t *res)
+{
+    uint64_t sram_bits = (g_targets & TARGET_SRAM) ? (uint64_t)g_sram_len * 8U : 0;
+    uint64_t io_bits = (g_targets & TARGET_IO) ? (uint64_t)CAMPAIGN_IO_COUNT * 8U : 0;
+    uint64_t pick = campaign_mix(g_seed * 0x100000001B3ULL + id) % (sram_bits + io_bits);
+
+    if (pick < sram_bits) {
+        res->region = TARGET_SRAM;
+        res->offset = (uint32_t)(pick >> 3);
+    } else {
+        pick -= sram_bits;
+        res->region = TARGET_IO;
+        res->offset = CAMPAIGN_IO_FIRST + (uint32_t)(pick >> 3);
+    }
+    res->bit = (uint8_t)(pick & 7U);
+}
+
+static void campaign_flip(const campaign_result_t *res)
+{
+    uint32_t off = res->offset;
+    uint8_t r;
+
+    if (res->region == TARGET_IO) {
+        sim_io_flip((uint8_t)off, res->bit);
+        return;
+    }
+
+    for (r = 0; r < 3; r++) {
+        if (off < g_sram[r].len) {
+            g_sram[r].base[off] ^= (uint8_t)BIT(res->bit);
+            return;
+        }
+        off -= g_sram[r].len;
+    }
+}
+
+/* Runs in the freshly forked child: becomes the reference or an experiment */
+static void campaign_start_run(campaign_role_t role, uint64_t id)
+{
+    struct sigaction sa;
+
+    g_role = role;
+    g_id = id;
+    g_inject_cycle = sim_cycles();
+
+    sim_eeprom_detach();
+
+    if (role == ROLE_EXPERIMENT) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = campaign_on_alarm;
+        sigaction(SIGALRM, &sa, NULL);
+        alarm(CAMPAIGN_WALL_LIMIT_S);
+
+        campaign_pick(id, &g_results[id]);
+        campaign_flip(&g_results[id]);
+    }
+
+    sim_set_limit(g_inject_cycle + (uint64_t)(g_window_s * (double)F_CPU));
+}
+
+/* ============================================================================
+ * CONTROLLER
+ * ============================================================================ */
+
+/* Returns only inside a forked experiment */
+static void campaign_worker(void)
+{
+    for (;;) {
+        uint64_t id = __atomic_fetch_add(&g_shared->next_id, 1, __ATOMIC_RELAXED);
+        int status;
+        pid_t pid;
+
+        if (id >= g_count) {
+            _exit(0);
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            campaign_start_run(ROLE_EXPERIMENT, id);
+            return;
+        }
+
+        if (pid > 0) {
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+                /* Retry */
+            }
+        }
+
+        if (!__atomic_load_n(&g_results[id].done, __ATOMIC_ACQUIRE)) {
+            /* Died without classifying itself (e.g. a fault in the handler) */
+            g_results[id].outcome = CAMPAIGN_CRASH;
+            g_results[id].done = 1;
+        }
+        __atomic_fetch_add(&g_shared->finished, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* Firmware data objects from our own symbol table, for readable results */
+typedef struct {
+    uintptr_t addr;
+    uint64_t size;
+    const char *name;
+} campaign_sym_t;
+
+static campaign_sym_t *g_syms;
+static uint32_t g_sym_count = 0;
+
+static int campaign_base_cb(struct dl_phdr_info *info, size_t size, void *data)
+{
+    (void)size;
+    *(uintptr_t *)data = (uintptr_t)info->dlpi_addr;
+    return 1;                       /* First entry is the executable */
+}
+
+/* Firmware files are built as C++: "_ZL10g_ee_queue" -> "g_ee_queue" */
+static const char *campaign_demangle(const char *name)
+{
+    int status = 0;
+    char *plain = abi::__cxa_demangle(name, NULL, NULL, &status);
+
+    return (status == 0 && plain) ? plain : name;
+}
+
+static void campaign_load_symbols(void)
+{
+    const Elf64_Ehdr *eh;
+    const Elf64_Shdr *sh;
+    struct stat st;
+    uintptr_t base = 0;
+    uint8_t *img;
+    uint16_t s;
+    int fd = open("/proc/self/exe", O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        return;
+    }
+    img = (uint8_t *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (img == MAP_FAILED) {
+        return;
+    }
+
+    dl_iterate_phdr(campaign_base_cb, &base);
+
+    eh = (const Elf64_Ehdr *)img;
+    sh = (const Elf64_Shdr *)(img + eh->e_shoff);
+
+    for (s = 0; s < eh->e_shnum; s++) {
+        const Elf64_Sym *sym;
+        const char *strtab;
+        uint64_t n;
+        uint64_t k;
+
+        if (sh[s].sh_type != SHT_SYMTAB) {
+            continue;
+        }
+
+        sym = (const Elf64_Sym *)(img + sh[s].sh_offset);
+        strtab = (const char *)(img + sh[sh[s].sh_link].sh_offset);
+        n = sh[s].sh_size / sizeof(Elf64_Sym);
+        g_syms = (campaign_sym_t *)calloc(n, sizeof(campaign_sym_t));
+        if (!g_syms) {
+            return;
+        }
+
+        for (k = 0; k < n; k++) {
+            uintptr_t addr = base + sym[k].st_value;
+            uint8_t r;
+
+            if (ELF64_ST_TYPE(sym[k].st_info) != STT_OBJECT || sym[k].st_size == 0) {
+                continue;
+            }
+            for (r = 0; r < 3; r++) {
+                if (addr >= (uintptr_t)g_sram[r].base &&
+                    addr < (uintptr_t)g_sram[r].base + g_sram[r].len) {
+                    g_syms[g_sym_count].addr = addr;
+                    g_syms[g_sym_count].size = sym[k].st_size;
+                    g_syms[g_sym_count].name = campaign_demangle(strtab + sym[k].st_name);
+                    g_sym_count++;
+                    break;
+                }
+            }
+        }
+        return;
+    }
+}
+
+static void campaign_describe(const campaign_result_t *res, char *buf, size_t len)
+{
+    uint32_t off = res->offset;
+    uintptr_t addr = 0;
+    uint32_t k;
+    uint8_t r;
+
+    if (res->region == TARGET_IO) {
+        snprintf(buf, len, "io:0x%02X", (unsigned)res->offset);
+        return;
+    }
+
+    for (r = 0; r < 3; r++) {
+        if (off < g_sram[r].len) {
+            addr = (uintptr_t)g_sram[r].base + off;
+            break;
+        }
+        off -= g_sram[r].len;
+    }
+
+    for (k = 0; k < g_sym_count; k++) {
+        if (addr >= g_syms[k].addr && addr < g_syms[k].addr + g_syms[k].size) {
+            snprintf(buf, len, "%s+%u", g_syms[k].name, (unsigned)(addr - g_syms[k].addr));
+            return;
+        }
+    }
+    snprintf(buf, len, "sram:%u", (unsigned)res->offset);
+}
+
+static void campaign_write_results(double wall_s)
+{
+    uint64_t totals[CAMPAIGN_OUTCOMES] = { 0 };
+    FILE *out = fopen(g_results_path, "w");
+    char where[96];
+    uint64_t k;
+    uint8_t o;
+
+    if (!out) {
+        perror(g_results_path);
+        exit(1);
+    }
+
+    campaign_load_symbols();
+
+    fprintf(out, "# fira campaign: %llu experiments, inject at %.3f s, window %.3f s, seed %llu\n",
+            (unsigned long long)g_count, g_inject_s, g_window_s, (unsigned long long)g_seed);
+    fprintf(out, "id,region,offset,bit,target,outcome,latency_us\n");
+
+    for (k = 0; k < g_count; k++) {
+        const campaign_result_t *res = &g_results[k];
+
+        campaign_describe(res, where, sizeof(where));
+        fprintf(out, "%llu,%s,%u,%u,%s,%s,%llu\n",
+                (unsigned long long)k, res->region == TARGET_IO ? "io" : "sram",
+                (unsigned)res->offset, res->bit, where, g_outcome_names[res->outcome],
+                (unsigned long long)(res->latency / (F_CPU / 1000000UL)));
+        totals[res->outcome]++;
+    }
+    fclose(out);
+
+    fprintf(stderr, "\n[campaign] %llu experiments in %.1f s (%.0f/s) -> %s\n",
+            (unsigned long long)g_count, wall_s, wall_s > 0 ? (double)g_count / wall_s : 0.0,
+            g_results_path);
+    for (o = 0; o < CAMPAIGN_OUTCOMES; o++) {
+        fprintf(stderr, "  %-10s %10llu  %6.2f%%\n", g_outcome_names[o],
+                (unsigned long long)totals[o],
+                g_count ? 100.0 * (double)totals[o] / (double)g_count : 0.0);
+    }
+}
+
+static double campaign_wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void campaign_on_limit(void)
+{
+    double start = campaign_wall_s();
+    uint32_t alive = 0;
+    uint32_t j;
+    int status;
+    pid_t pid;
+
+    if (g_role == ROLE_REFERENCE) {
+        campaign_end_reference();
+    }
+    if (g_role == ROLE_EXPERIMENT) {
+        campaign_end_experiment();
+    }
+
+    /* Golden run reached the injection point: this is the snapshot */
+    fflush(NULL);
+    fprintf(stderr, "[campaign] snapshot at %.3f s (%llu cycles), %u bits of SRAM, "
+            "%u I/O registers, %u jobs\n",
+            (double)sim_cycles() / (double)F_CPU, (unsigned long long)sim_cycles(),
+            (unsigned)(g_sram_len * 8U), CAMPAIGN_IO_COUNT, (unsigned)g_jobs);
+
+    pid = fork();
+    if (pid == 0) {
+        campaign_start_run(ROLE_REFERENCE, 0);
+        return;
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !g_shared->ref_ok) {
+        fprintf(stderr, "[campaign] reference run failed (window too long or not reproducible)\n");
+        exit(1);
+    }
+
+    for (j = 0; j < g_jobs; j++) {
+        pid = fork();
+        if (pid == 0) {
+            campaign_worker();
+            return;                 /* Experiment child carries on simulating */
+        }
+        if (pid > 0) {
+            alive++;
+        }
+    }
+
+    while (alive) {
+        struct timespec ts = { 0, 200000000L };
+
+        while (waitpid(-1, &status, WNOHANG) > 0) {
+            alive--;
+        }
+        if (isatty(STDERR_FILENO)) {
+            fprintf(stderr, "\r[campaign] %llu / %llu", (unsigned long long)
+                    __atomic_load_n(&g_shared->finished, __ATOMIC_RELAXED),
+                    (unsigned long long)g_count);
+        }
+        if (alive) {
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    campaign_write_results(campaign_wall_s() - start);
+    exit(0);
+}
@@ -0,0 +1,66 @@
+/*
+ * ============================================================================
+ * FIRA - Host Fault-Injection Campaign Engine
+ * Fork-per-experiment bit flips on a golden run of the host build
+ * ============================================================================
+ */
+
+#ifndef CAMPAIGN_H
+#define CAMPAIGN_H
+
+#include <stdint.h>
+
+
+/* Experiment outcomes, in the order they are reported */
+typedef enum {
+    CAMPAIGN_BENIGN = 0,    /* Output and state identical to the golden run */
+    CAMPAIGN_LATENT,        /* Output identical, state still differs at the end */
+    CAMPAIGN_DETECTED,      /* Firmware printed the detection marker */
+    CAMPAIGN_SDC,           /* Output differs with no detection (silent) */
+    CAMPAIGN_WDT_RESET,     /* Hang caught by the watchdog */
+    CAMPAIGN_CRASH,         /* Wild jump / bad interrupt (reset without flags) */
+    CAMPAIGN_HANG,          /* No simulated progress within the wall-clock budget */
+    CAMPAIGN_OUTCOMES
+} campaign_outcome_t;
+
+/**
+ * @brief Consume a campaign command-line option
+ * @return 1 if argv[*i] (and its argument) was a campaign option
+ */
+uint8_t campaign_parse_arg(int argc, char **argv, int *i);
+
+/**
+ * @brief True once --campaign was given
+ */
+uint8_t campaign_enabled(void);
+
+/**
+ * @brief Arm the campaign before the firmware starts (sets the injection limit)
+ */
+void campaign_init(void);
+
+/**
+ * @brief Called by the simulator when virtual time reaches the limit
+ *
+ * In the golden process this is the snapshot point: it forks the reference
+ * run and the workers and never returns there. Experiments come back out
+ * of it with their bit already flipped. At the end of an experiment's
+ * window it classifies the run and exits.
+ */
+void campaign_on_limit(void);
+
+/**
+ * @brief Called on a simulated reset
+ *
+ * Inside an experiment the reset ends the run (classified from MCUSR) and
+ * this never returns; otherwise the reset proceeds normally.
+ */
+void campaign_on_reset(uint8_t mcusr);
+
+/**
+ * @brief Offer one transmitted UART byte to the campaign
+ * @return 1 if the campaign consumed it (nothing should be printed)
+ */
+uint8_t campaign_uart_byte(uint8_t byte);
+
+#endif /* CAMPAIGN_H */
@@ -0,0 +1,27 @@
+/*
+ * Host stand-in for avr-libc <avr/interrupt.h>: each vector becomes a
+ * plain function that host/sim.cpp calls when the interrupt is pending.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#define ISR(vector, ...)        extern "C" void vector(void); void vector(void)
+#define ISR_NAKED
+
+#define WDT_vect                sim_vector_WDT
+#define TIMER2_COMPA_vect       sim_vector_TIMER2_COMPA
+#define TIMER2_COMPB_vect       sim_vector_TIMER2_COMPB
+#define TIMER2_OVF_vect         sim_vector_TIMER2_OVF
+#define TIMER1_COMPA_vect       sim_vector_TIMER1_COMPA
+#define TIMER1_COMPB_vect       sim_vector_TIMER1_COMPB
+#define TIMER1_OVF_vect         sim_vector_TIMER1_OVF
+#define TIMER0_COMPA_vect       sim_vector_TIMER0_COMPA
+#define TIMER0_COMPB_vect       sim_vector_TIMER0_COMPB
+#define TIMER0_OVF_vect         sim_vector_TIMER0_OVF
+#define USART_RX_vect           sim_vector_USART_RX
+#define USART_UDRE_vect         sim_vector_USART_UDRE
+#define USART_TX_vect           sim_vector_USART_TX
+#define EE_READY_vect           sim_vector_EE_READY
+
+#endif /* HOST_AVR_INTERRUPT_H */
@@ -0,0 +1,87 @@
+/*
+ * ============================================================================
+ * FIRA - Host Simulator
+ * Simulated register file for the Linux build (make host)
+ * ============================================================================
+ *
+ * The firmware sources are compiled as C++ on the host so that MMIO8() /
+ * MMIO16() can be small proxy objects: every register read and write is
+ * routed to the simulator (host/sim.cpp), which models Timer0/1, USART0,
+ * EEPROM and the watchdog in virtual time and dispatches ISRs.
+ */
+
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <stdint.h>
+
+
+uint8_t sim_io_read(uint16_t addr);
+void sim_io_write(uint16_t addr, uint8_t value);
+
+void sim_sei(void);
+void sim_cli(void);
+void sim_wdr(void);
+void sim_nop(void);
+void sim_sei_sleep(void);
+
+
+/* 8-bit register proxy */
+struct sim_reg8 {
+    uint16_t addr;
+    
+    operator uint8_t() const { return sim_io_read(addr); }
+    
+    const sim_reg8 &operator=(unsigned value) const
+    {
+        sim_io_write(addr, (uint8_t)value);
+        return *this;
+    }
+    const sim_reg8 &operator|=(unsigned value) const
+    {
+        sim_io_write(addr, (uint8_t)(sim_io_read(addr) | value));
+        return *this;
+    }
+    const sim_reg8 &operator&=(unsigned value) const
+    {
+        sim_io_write(addr, (uint8_t)(sim_io_read(addr) & value));
+        return *this;
+    }
+    const sim_reg8 &operator^=(unsigned value) const
+    {
+        sim_io_write(addr, (uint8_t)(sim_io_read(addr) ^ value));
+        return *this;
+    }
+};
+
+/* 16-bit register proxy: low byte read first, high byte written first */
+struct sim_reg16 {
+    uint16_t addr;
+    
+    operator uint16_t() const
+    {
+        uint8_t low = sim_io_read(addr);
+        return (uint16_t)(low | ((uint16_t)sim_io_read((uint16_t)(addr + 1)) << 8));
+    }
+    
+    const sim_reg16 &operator=(unsigned value) const
+    {
+        sim_io_write((uint16_t)(addr + 1), (uint8_t)(value >> 8));
+        sim_io_write(addr, (uint8_t)value);
+        return *this;
+    }
+};
+
+#define MMIO8(addr)             (sim_reg8{(uint16_t)(addr)})
+#define MMIO16(addr)            (sim_reg16{(uint16_t)(addr)})
+
+#define INTERRUPTS_ENABLE()     sim_sei()
+#define INTERRUPTS_DISABLE()    sim_cli()
+#define NOP()                   sim_nop()
+#define WDT_RESET()             sim_wdr()
+#define SEI_SLEEP()             sim_sei_sleep()
+
+/* Kept across simulated resets (see sim_reset) */
+#define NOINIT                  __attribute__((section("fira_noinit")))
+
+#endif /* HOST_IO_H */
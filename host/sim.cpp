@@ -0,0 +1,1080 @@
+/*
+ * ============================================================================
+ * FIRA - Host Simulator
+ * Virtual-time ATmega328P peripheral model for the Linux build
+ * ============================================================================
+ *
+ * Every register access made by the firmware lands in sim_io_read() /
+ * sim_io_write(). Each access costs SIM_ACCESS_CYCLES of virtual time; when
+ * the firmware only spins (no peripheral writes for SIM_IDLE_ACCESSES
+ * accesses) virtual time warps straight to the next hardware event, so
+ * hours of operation run in seconds.
+ *
+ * Modelled: Timer0/1/2 (normal + CTC, compare/overflow flags), USART0
+ * (TX double buffer at the programmed baud rate, RX fed from --uart-in at
+ * the same rate), EEPROM (file-backed,
+ * 3.4 ms programming time), watchdog (reset and interrupt modes), idle
+ * sleep (SMCR.SE, woken by the next interrupt) and the
+ * AVR interrupt priority order. A reset re-executes the process; virtual
+ * time, MCUSR and the fira_noinit section are carried across.
+ *
+ * With --campaign the run becomes a fault-injection campaign (campaign.cpp).
+ */
+
+#include "atmega328p.h"
+#include "config.h"
+#include "sim.h"
+#include "campaign.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define SIM_ACCESS_CYCLES       4U          /* Virtual cost of one access */
+#define SIM_IDLE_ACCESSES       512U        /* Spin length before warping */
+#define SIM_POLL_WARP_CYCLES    ((uint64_t)F_CPU / 1000U)  /* 1 ms */
+#define SIM_EEPROM_SIZE         1024U
+#define SIM_EEPROM_WRITE_CYCLES ((uint64_t)F_CPU * 34U / 10000U)  /* 3.4 ms */
+#define SIM_RAMEND              0x08FFU
+#define SIM_NEVER               UINT64_MAX
+
+#define SIM_PERSIST_ENV         "FIRA_SIM_PERSIST"
+
+
+/* Firmware entry point and early init (main.c is built with -Dmain=fira_main) */
+int fira_main(void);
+void wdt_early_init(void);
+
+/* Interrupt vectors: weak, a missing handler behaves like __bad_interrupt */
+#define SIM_VECTOR(name) extern "C" void sim_vector_##name(void) __attribute__((weak))
+SIM_VECTOR(WDT);
+SIM_VECTOR(TIMER2_COMPA);
+SIM_VECTOR(TIMER2_COMPB);
+SIM_VECTOR(TIMER2_OVF);
+SIM_VECTOR(TIMER1_COMPA);
+SIM_VECTOR(TIMER1_COMPB);
+SIM_VECTOR(TIMER1_OVF);
+SIM_VECTOR(TIMER0_COMPA);
+SIM_VECTOR(TIMER0_COMPB);
+SIM_VECTOR(TIMER0_OVF);
+SIM_VECTOR(USART_RX);
+SIM_VECTOR(USART_UDRE);
+SIM_VECTOR(USART_TX);
+SIM_VECTOR(EE_READY);
+
+/* Bounds of the firmware's NOINIT data (GNU ld __start_/__stop_ symbols) */
+extern "C" char __start_fira_noinit[] __attribute__((weak));
+extern "C" char __stop_fira_noinit[] __attribute__((weak));
+
+
+/* ============================================================================
+ * STATE
+ * ============================================================================ */
+
+typedef struct {
+    uint16_t tcnt;              /* Counter register address (low byte) */
+    uint16_t tccra;
+    uint16_t tccrb;
+    uint16_t ocra;
+    uint16_t ocrb;
+    uint16_t timsk;
+    uint16_t tifr;
+    uint16_t max;               /* 0xFF or 0xFFFF */
+                                /* Flag bits share TIFR1 positions */
+    uint8_t  ctc_bit;           /* WGM bit selecting CTC in tccra/tccrb */
+    uint8_t  ctc_in_b;          /* 1 if ctc_bit lives in TCCRnB */
+    uint32_t count;
+    uint64_t base;              /* Cycle at which count was last valid */
+    const uint16_t *div;        /* Prescaler per CSn2:0 value */
+} sim_timer_t;
+
+/* Carried across a simulated reset */
+typedef struct {
+    uint64_t cycles;
+    uint64_t wall_start_ns;
+    uint32_t resets;
+    uint8_t  mcusr;
+    uint32_t noinit_len;
+} sim_persist_t;
+
+static uint8_t g_io[0x100];                 /* Register file (data space) */
+static uint64_t g_cycles = 0;
+static uint64_t g_limit = SIM_NEVER;
+static uint32_t g_idle = 0;
+static uint8_t g_polled = 0;                /* Spin reads a free-running counter */
+static uint32_t g_resets = 0;
+static uint64_t g_wall_start_ns = 0;
+static char **g_argv;
+
+/* Timer2 has its own prescaler steps (no external clock inputs) */
+static const uint16_t g_div_sync[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+static const uint16_t g_div_timer2[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+
+static sim_timer_t g_timer0 = {
+    0x46, 0x44, 0x45, 0x47, 0x48, 0x6E, 0x35, 0xFF, TCCR0A_WGM01, 0, 0, 0, g_div_sync
+};
+static sim_timer_t g_timer1 = {
+    0x84, 0x80, 0x81, 0x88, 0x8A, 0x6F, 0x36, 0xFFFF, TCCR1B_WGM12, 1, 0, 0, g_div_sync
+};
+static sim_timer_t g_timer2 = {
+    0xB2, 0xB0, 0xB1, 0xB3, 0xB4, 0x70, 0x37, 0xFF, TCCR2A_WGM21, 0, 0, 0, g_div_timer2
+};
+static uint8_t g_temp16 = 0;                /* Shared 16-bit TEMP register */
+
+static FILE *g_uart_out;
+static uint64_t g_tx_shift_until = 0;       /* 0 = shifter idle */
+static uint8_t g_tx_buf_full = 0;
+static uint8_t g_tx_buf = 0;
+static int g_uart_in = -1;                  /* Non-blocking RX source */
+static uint64_t g_rx_next = 0;              /* Earliest cycle for the next RX byte */
+
+static uint8_t *g_eeprom;
+static uint64_t g_ee_busy_until = 0;
+static uint8_t g_ee_mpe_ttl = 0;            /* Accesses left in EEMPE window */
+
+static uint64_t g_wdt_deadline = SIM_NEVER;
+static uint8_t g_wdt_change = 0;            /* Timed sequence window open */
+
+
+/* ============================================================================
+ * HELPERS
+ * ============================================================================ */
+
+static uint64_t sim_wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t sim_cycles(void)
+{
+    return g_cycles;
+}
+
+uint32_t sim_reset_count(void)
+{
+    return g_resets;
+}
+
+void sim_set_limit(uint64_t cycles)
+{
+    g_limit = cycles;
+}
+
+const uint8_t *sim_io_space(void)
+{
+    return g_io;
+}
+
+static void sim_report(FILE *out)
+{
+    double virt = (double)g_cycles / (double)F_CPU;
+    double wall = (double)(sim_wall_ns() - g_wall_start_ns) / 1e9;
+
+    fprintf(out, "\n[sim] virtual %.3f s, wall %.3f s (x%.0f), resets %u\n",
+            virt, wall, wall > 0 ? virt / wall : 0.0, g_resets);
+}
+
+/* ============================================================================
+ * RESET
+ * ============================================================================ */
+
+/*
+ * Re-execute the simulator: the C runtime re-initialises .data/.bss just
+ * like the AVR startup code, while virtual time, MCUSR and NOINIT RAM are
+ * handed over through an inherited memfd.
+ */
+void sim_reset(uint8_t mcusr)
+{
+    sim_persist_t persist;
+    uint32_t noinit_len = 0;
+    char env[32];
+    int fd;
+
+    campaign_on_reset(mcusr);
+
+    if (__start_fira_noinit && __stop_fira_noinit) {
+        noinit_len = (uint32_t)(__stop_fira_noinit - __start_fira_noinit);
+    }
+
+    persist.cycles = g_cycles;
+    persist.wall_start_ns = g_wall_start_ns;
+    persist.resets = g_resets + 1;
+    persist.mcusr = mcusr;
+    persist.noinit_len = noinit_len;
+
+    fflush(g_uart_out);
+    fflush(stdout);
+
+    fd = memfd_create("fira_persist", 0);
+    if (fd < 0 ||
+        write(fd, &persist, sizeof(persist)) != (ssize_t)sizeof(persist) ||
+        (noinit_len && write(fd, __start_fira_noinit, noinit_len) != (ssize_t)noinit_len)) {
+        perror("[sim] reset");
+        _exit(1);
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    snprintf(env, sizeof(env), "%d", fd);
+    setenv(SIM_PERSIST_ENV, env, 1);
+
+    execv("/proc/self/exe", g_argv);
+    perror("[sim] execv");
+    _exit(1);
+}
+
+static void sim_restore(void)
+{
+    const char *env = getenv(SIM_PERSIST_ENV);
+    sim_persist_t persist;
+    int fd;
+
+    g_io[0x54] = BIT(MCUSR_PORF);
+
+    if (!env) {
+        return;
+    }
+
+    fd = atoi(env);
+    if (read(fd, &persist, sizeof(persist)) == (ssize_t)sizeof(persist)) {
+        g_cycles = persist.cycles;
+        g_wall_start_ns = persist.wall_start_ns;
+        g_resets = persist.resets;
+        g_io[0x54] = persist.mcusr;
+
+        if (persist.noinit_len && __start_fira_noinit &&
+            persist.noinit_len == (uint32_t)(__stop_fira_noinit - __start_fira_noinit)) {
+            if (read(fd, __start_fira_noinit, persist.noinit_len) < 0) {
+                perror("[sim] restore");
+            }
+        }
+    }
+
+    close(fd);
+    unsetenv(SIM_PERSIST_ENV);
+}
+
+/* ============================================================================
+ * TIMERS
+ * ============================================================================ */
+
+static uint32_t sim_timer_prescale(const sim_timer_t *t)
+{
+    return t->div[g_io[t->tccrb] & 0x07];
+}
+
+static uint32_t sim_timer_top(const sim_timer_t *t)
+{
+    uint8_t ctc = t->ctc_in_b ? BIT_GET(g_io[t->tccrb], t->ctc_bit)
+                              : BIT_GET(g_io[t->tccra], t->ctc_bit);
+    uint32_t ocra = g_io[t->ocra] | (t->max > 0xFF ? (uint32_t)g_io[t->ocra + 1] << 8 : 0);
+
+    return ctc ? ocra : t->max;
+}
+
+static uint32_t sim_timer_ocr(const sim_timer_t *t, uint16_t addr)
+{
+    return g_io[addr] | (t->max > 0xFF ? (uint32_t)g_io[addr + 1] << 8 : 0);
+}
+
+/* Ticks until the counter next reaches value v (1..period) */
+static uint64_t sim_timer_distance(uint32_t count, uint32_t v, uint32_t period)
+{
+    uint64_t d = (v + period - count) % period;
+    return d ? d : period;
+}
+
+static void sim_timer_sync(sim_timer_t *t)
+{
+    uint32_t presc = sim_timer_prescale(t);
+    uint64_t ticks;
+    uint32_t period;
+    uint32_t top;
+
+    if (presc == 0) {
+        t->base = g_cycles;
+        return;
+    }
+
+    ticks = (g_cycles - t->base) / presc;
+    if (ticks == 0) {
+        return;
+    }
+    t->base += ticks * presc;
+
+    top = sim_timer_top(t);
+    period = top + 1;
+
+    if (t->count > top) {
+        /* Counter beyond TOP (TOP lowered): runs up to MAX and wraps */
+        uint64_t to_wrap = (uint64_t)t->max + 1 - t->count;
+        if (ticks < to_wrap) {
+            t->count += (uint32_t)ticks;
+            return;
+        }
+        ticks -= to_wrap;
+        t->count = 0;
+        g_io[t->tifr] |= BIT(TIFR1_TOV1);
+    }
+
+    if (sim_timer_distance(t->count, sim_timer_ocr(t, t->ocra) % period, period) <= ticks) {
+        g_io[t->tifr] |= BIT(TIFR1_OCF1A);
+    }
+    if (sim_timer_distance(t->count, sim_timer_ocr(t, t->ocrb) % period, period) <= ticks) {
+        g_io[t->tifr] |= BIT(TIFR1_OCF1B);
+    }
+    if (top == t->max && (uint64_t)period - t->count <= ticks) {
+        g_io[t->tifr] |= BIT(TIFR1_TOV1);
+    }
+
+    t->count = (uint32_t)((t->count + ticks) % period);
+}
+
+/* Cycle of the next enabled timer interrupt */
+static uint64_t sim_timer_next(const sim_timer_t *t)
+{
+    uint32_t presc = sim_timer_prescale(t);
+    uint8_t mask = g_io[t->timsk];
+    uint32_t top;
+    uint32_t period;
+    uint64_t d = SIM_NEVER;
+
+    if (presc == 0 || mask == 0) {
+        return SIM_NEVER;
+    }
+
+    top = sim_timer_top(t);
+    period = top + 1;
+
+    if (t->count > top) {
+        d = (uint64_t)t->max + 1 - t->count;
+    } else {
+        if (BIT_GET(mask, TIMSK1_OCIE1A)) {
+            uint64_t x = sim_timer_distance(t->count, sim_timer_ocr(t, t->ocra) % period, period);
+            d = x < d ? x : d;
+        }
+        if (BIT_GET(mask, TIMSK1_OCIE1B)) {
+            uint64_t x = sim_timer_distance(t->count, sim_timer_ocr(t, t->ocrb) % period, period);
+            d = x < d ? x : d;
+        }
+        if (BIT_GET(mask, TIMSK1_TOIE1) && top == t->max) {
+            uint64_t x = period - t->count;
+            d = x < d ? x : d;
+        }
+    }
+
+    return (d == SIM_NEVER) ? SIM_NEVER : t->base + d * presc;
+}
+
+/* ============================================================================
+ * USART0
+ * ============================================================================ */
+
+static uint64_t sim_uart_byte_cycles(void)
+{
+    uint16_t ubrr = (uint16_t)(g_io[0xC4] | ((g_io[0xC5] & 0x0F) << 8));
+    uint8_t div = BIT_GET(g_io[0xC0], UCSR0A_U2X0) ? 8 : 16;
+
+    /* Start + 8 data + stop bits */
+    return (uint64_t)10 * div * (ubrr + 1U);
+}
+
+static void sim_uart_shift(uint8_t byte)
+{
+    if (!campaign_uart_byte(byte)) {
+        fputc(byte, g_uart_out);
+    }
+    g_tx_shift_until = g_cycles + sim_uart_byte_cycles();
+}
+
+static void sim_uart_service(void)
+{
+    while (g_tx_shift_until && g_cycles >= g_tx_shift_until) {
+        if (g_tx_buf_full) {
+            uint64_t end = g_tx_shift_until;
+            g_tx_buf_full = 0;
+            sim_uart_shift(g_tx_buf);
+            g_tx_shift_until = end + sim_uart_byte_cycles();
+        } else {
+            g_tx_shift_until = 0;
+            g_io[0xC0] |= BIT(UCSR0A_TXC0);
+        }
+    }
+
+    if (g_tx_buf_full) {
+        g_io[0xC0] &= (uint8_t)~BIT(UCSR0A_UDRE0);
+    } else {
+        g_io[0xC0] |= BIT(UCSR0A_UDRE0);
+    }
+}
+
+/*
+ * Deliver the next input byte once the previous one has been read and a
+ * byte time has passed. An empty source is polled once per virtual ms.
+ */
+static void sim_uart_receive(void)
+{
+    uint8_t byte;
+    ssize_t n;
+
+    if (g_uart_in < 0 || g_cycles < g_rx_next ||
+        !BIT_GET(g_io[0xC1], UCSR0B_RXEN0) || BIT_GET(g_io[0xC0], UCSR0A_RXC0)) {
+        return;
+    }
+
+    n = read(g_uart_in, &byte, 1);
+    if (n == 1) {
+        g_io[0xC6] = byte;
+        g_io[0xC0] |= BIT(UCSR0A_RXC0);
+        g_rx_next = g_cycles + sim_uart_byte_cycles();
+    } else if (n == 0) {
+        close(g_uart_in);
+        g_uart_in = -1;
+    } else {
+        g_rx_next = g_cycles + F_CPU / 1000U;
+    }
+}
+
+static void sim_uart_write_udr(uint8_t byte)
+{
+    if (!BIT_GET(g_io[0xC1], UCSR0B_TXEN0)) {
+        return;
+    }
+
+    if (!g_tx_shift_until) {
+        sim_uart_shift(byte);
+    } else if (!g_tx_buf_full) {
+        g_tx_buf = byte;
+        g_tx_buf_full = 1;
+    }
+    /* else: data register overwritten while full, byte lost like on HW */
+
+    sim_uart_service();
+}
+
+/* ============================================================================
+ * EEPROM
+ * ============================================================================ */
+
+static void sim_eeprom_open(const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        exit(1);
+    }
+
+    if (st.st_size < (off_t)SIM_EEPROM_SIZE) {
+        /* Fresh device: erased cells read 0xFF */
+        uint8_t erased[SIM_EEPROM_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        if (pwrite(fd, erased, sizeof(erased), 0) != (ssize_t)sizeof(erased)) {
+            perror(path);
+            exit(1);
+        }
+    }
+
+    g_eeprom = (uint8_t *)mmap(NULL, SIM_EEPROM_SIZE, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0);
+    if (g_eeprom == MAP_FAILED) {
+        perror(path);
+        exit(1);
+    }
+    close(fd);
+}
+
+void sim_eeprom_detach(void)
+{
+    uint8_t copy[SIM_EEPROM_SIZE];
+
+    memcpy(copy, g_eeprom, sizeof(copy));
+    if (mmap(g_eeprom, SIM_EEPROM_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        perror("[sim] eeprom detach");
+        _exit(1);
+    }
+    memcpy(g_eeprom, copy, sizeof(copy));
+}
+
+static uint16_t sim_eeprom_addr(void)
+{
+    return (uint16_t)(((g_io[0x42] << 8) | g_io[0x41]) & (SIM_EEPROM_SIZE - 1));
+}
+
+static void sim_eeprom_service(void)
+{
+    if (g_ee_busy_until && g_cycles >= g_ee_busy_until) {
+        g_ee_busy_until = 0;
+        g_io[0x3F] &= (uint8_t)~BIT(EECR_EEPE);
+    }
+
+    if (g_ee_mpe_ttl && --g_ee_mpe_ttl == 0) {
+        g_io[0x3F] &= (uint8_t)~BIT(EECR_EEMPE);
+    }
+}
+
+static void sim_eeprom_write_eecr(uint8_t value)
+{
+    uint8_t old = g_io[0x3F];
+    uint8_t busy = BIT_GET(old, EECR_EEPE);
+
+    /* EERIE and EEPM are plain bits; EEPE/EERE are strobes */
+    g_io[0x3F] = (uint8_t)((value & ~(BIT(EECR_EEPE) | BIT(EECR_EERE))) | (old & BIT(EECR_EEPE)));
+
+    if (BIT_GET(value, EECR_EEMPE) && !BIT_GET(old, EECR_EEMPE)) {
+        g_ee_mpe_ttl = 3;
+    }
+
+    if (BIT_GET(value, EECR_EEPE) && !busy && BIT_GET(old, EECR_EEMPE)) {
+        g_eeprom[sim_eeprom_addr()] = g_io[0x40];
+        g_ee_busy_until = g_cycles + SIM_EEPROM_WRITE_CYCLES;
+        g_io[0x3F] |= BIT(EECR_EEPE);
+        g_io[0x3F] &= (uint8_t)~BIT(EECR_EEMPE);
+        g_ee_mpe_ttl = 0;
+    }
+
+    if (BIT_GET(value, EECR_EERE) && !busy) {
+        g_io[0x40] = g_eeprom[sim_eeprom_addr()];
+        g_cycles += 4;              /* CPU halted during the read */
+    }
+}
+
+/* ============================================================================
+ * WATCHDOG
+ * ============================================================================ */
+
+static uint64_t sim_wdt_period(void)
+{
+    uint8_t v = g_io[0x60];
+    uint8_t wdp = (uint8_t)((v & 0x07) | (BIT_GET(v, WDTCSR_WDP3) << 3));
+
+    /* 128 kHz oscillator: 2K cycles = 16 ms, doubling per step */
+    return (uint64_t)F_CPU / 1000U * (16U << (wdp > 9 ? 9 : wdp));
+}
+
+static void sim_wdt_rearm(void)
+{
+    uint8_t v = g_io[0x60];
+
+    if (BIT_GET(v, WDTCSR_WDE) || BIT_GET(v, WDTCSR_WDIE)) {
+        g_wdt_deadline = g_cycles + sim_wdt_period();
+    } else {
+        g_wdt_deadline = SIM_NEVER;
+    }
+}
+
+static void sim_wdt_write(uint8_t value)
+{
+    uint8_t old = g_io[0x60];
+    uint8_t flags = old & BIT(WDTCSR_WDIF);
+
+    if (BIT_GET(value, WDTCSR_WDIF)) {
+        flags = 0;                  /* Write one to clear */
+    }
+
+    if (BIT_GET(value, WDTCSR_WDCE) && BIT_GET(value, WDTCSR_WDE)) {
+        /* Start of the timed sequence */
+        g_wdt_change = 1;
+        g_io[0x60] = (uint8_t)((old & ~BIT(WDTCSR_WDIF)) | flags | BIT(WDTCSR_WDCE) | BIT(WDTCSR_WDE));
+        return;
+    }
+
+    if (g_wdt_change) {
+        g_io[0x60] = (uint8_t)((value & ~(BIT(WDTCSR_WDIF) | BIT(WDTCSR_WDCE))) | flags);
+    } else {
+        /* Without the sequence only WDIE may change and WDE may only be set */
+        uint8_t keep = old & (uint8_t)~(BIT(WDTCSR_WDIE) | BIT(WDTCSR_WDIF) | BIT(WDTCSR_WDCE));
+        g_io[0x60] = (uint8_t)(keep | (value & (BIT(WDTCSR_WDIE) | BIT(WDTCSR_WDE))) | flags);
+    }
+
+    g_wdt_change = 0;
+    sim_wdt_rearm();
+}
+
+static void sim_wdt_service(void)
+{
+    uint8_t v;
+
+    if (g_cycles < g_wdt_deadline) {
+        return;
+    }
+
+    v = g_io[0x60];
+
+    if (BIT_GET(v, WDTCSR_WDIE) && !BIT_GET(v, WDTCSR_WDIF)) {
+        g_io[0x60] |= BIT(WDTCSR_WDIF);
+        g_wdt_deadline += sim_wdt_period();
+    } else if (BIT_GET(v, WDTCSR_WDE)) {
+        sim_reset(BIT(MCUSR_WDRF));
+    } else {
+        g_wdt_deadline += sim_wdt_period();
+    }
+}
+
+void sim_wdr(void)
+{
+    g_cycles += 1;
+    sim_wdt_rearm();
+}
+
+/* ============================================================================
+ * INTERRUPTS
+ * ============================================================================ */
+
+static void sim_call_vector(void (*vector)(void))
+{
+    if (!vector) {
+        /* __bad_interrupt jumps to the reset vector */
+        sim_reset(0);
+    }
+
+    g_io[0x5F] &= (uint8_t)~BIT(SREG_I);
+    g_cycles += 8;                  /* Vector + prologue */
+    vector();
+    g_cycles += 8;                  /* Epilogue + reti */
+    g_io[0x5F] |= BIT(SREG_I);
+}
+
+/* Highest-priority pending interrupt, in AVR vector order */
+static uint8_t sim_dispatch_one(void)
+{
+    uint8_t *tifr0 = &g_io[0x35];
+    uint8_t *tifr1 = &g_io[0x36];
+    uint8_t *tifr2 = &g_io[0x37];
+    uint8_t timsk0 = g_io[0x6E];
+    uint8_t timsk1 = g_io[0x6F];
+    uint8_t timsk2 = g_io[0x70];
+    uint8_t ucsr0a = g_io[0xC0];
+    uint8_t ucsr0b = g_io[0xC1];
+    uint8_t wdt = g_io[0x60];
+
+    if (BIT_GET(wdt, WDTCSR_WDIE) && BIT_GET(wdt, WDTCSR_WDIF)) {
+        g_io[0x60] &= (uint8_t)~BIT(WDTCSR_WDIF);
+        if (BIT_GET(wdt, WDTCSR_WDE)) {
+            g_io[0x60] &= (uint8_t)~BIT(WDTCSR_WDIE);
+        }
+        sim_call_vector(sim_vector_WDT);
+    } else if ((timsk2 & *tifr2) & BIT(TIFR1_OCF1A)) {
+        *tifr2 &= (uint8_t)~BIT(TIFR1_OCF1A);
+        sim_call_vector(sim_vector_TIMER2_COMPA);
+    } else if ((timsk2 & *tifr2) & BIT(TIFR1_OCF1B)) {
+        *tifr2 &= (uint8_t)~BIT(TIFR1_OCF1B);
+        sim_call_vector(sim_vector_TIMER2_COMPB);
+    } else if ((timsk2 & *tifr2) & BIT(TIFR1_TOV1)) {
+        *tifr2 &= (uint8_t)~BIT(TIFR1_TOV1);
+        sim_call_vector(sim_vector_TIMER2_OVF);
+    } else if ((timsk1 & *tifr1) & BIT(TIFR1_OCF1A)) {
+        *tifr1 &= (uint8_t)~BIT(TIFR1_OCF1A);
+        sim_call_vector(sim_vector_TIMER1_COMPA);
+    } else if ((timsk1 & *tifr1) & BIT(TIFR1_OCF1B)) {
+        *tifr1 &= (uint8_t)~BIT(TIFR1_OCF1B);
+        sim_call_vector(sim_vector_TIMER1_COMPB);
+    } else if ((timsk1 & *tifr1) & BIT(TIFR1_TOV1)) {
+        *tifr1 &= (uint8_t)~BIT(TIFR1_TOV1);
+        sim_call_vector(sim_vector_TIMER1_OVF);
+    } else if ((timsk0 & *tifr0) & BIT(TIFR0_OCF0A)) {
+        *tifr0 &= (uint8_t)~BIT(TIFR0_OCF0A);
+        sim_call_vector(sim_vector_TIMER0_COMPA);
+    } else if ((timsk0 & *tifr0) & BIT(TIFR0_OCF0B)) {
+        *tifr0 &= (uint8_t)~BIT(TIFR0_OCF0B);
+        sim_call_vector(sim_vector_TIMER0_COMPB);
+    } else if ((timsk0 & *tifr0) & BIT(TIFR0_TOV0)) {
+        *tifr0 &= (uint8_t)~BIT(TIFR0_TOV0);
+        sim_call_vector(sim_vector_TIMER0_OVF);
+    } else if (BIT_GET(ucsr0b, UCSR0B_RXCIE0) && BIT_GET(ucsr0a, UCSR0A_RXC0)) {
+        sim_call_vector(sim_vector_USART_RX);
+    } else if (BIT_GET(ucsr0b, UCSR0B_UDRIE0) && BIT_GET(ucsr0a, UCSR0A_UDRE0)) {
+        sim_call_vector(sim_vector_USART_UDRE);
+    } else if (BIT_GET(ucsr0b, UCSR0B_TXCIE0) && BIT_GET(ucsr0a, UCSR0A_TXC0)) {
+        g_io[0xC0] &= (uint8_t)~BIT(UCSR0A_TXC0);
+        sim_call_vector(sim_vector_USART_TX);
+    } else if (BIT_GET(g_io[0x3F], EECR_EERIE) && !BIT_GET(g_io[0x3F], EECR_EEPE)) {
+        sim_call_vector(sim_vector_EE_READY);
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/* ============================================================================
+ * VIRTUAL TIME
+ * ============================================================================ */
+
+static uint64_t sim_next_event(void)
+{
+    uint64_t next = g_wdt_deadline;
+    uint64_t t;
+
+    t = sim_timer_next(&g_timer0);
+    next = t < next ? t : next;
+    t = sim_timer_next(&g_timer1);
+    next = t < next ? t : next;
+    t = sim_timer_next(&g_timer2);
+    next = t < next ? t : next;
+
+    if (g_tx_shift_until && g_tx_shift_until < next) {
+        next = g_tx_shift_until;
+    }
+    if (g_ee_busy_until && g_ee_busy_until < next) {
+        next = g_ee_busy_until;
+    }
+
+    return next;
+}
+
+/* Bring every peripheral up to the current virtual time */
+static void sim_service(void)
+{
+    if (g_cycles >= g_limit) {
+        if (!campaign_enabled()) {
+            fflush(g_uart_out);
+            sim_report(stderr);
+            exit(0);
+        }
+        campaign_on_limit();
+    }
+
+    sim_timer_sync(&g_timer0);
+    sim_timer_sync(&g_timer1);
+    sim_timer_sync(&g_timer2);
+    sim_uart_service();
+    sim_uart_receive();
+    sim_eeprom_service();
+    sim_wdt_service();
+}
+
+static void sim_tick(uint32_t cycles)
+{
+    g_cycles += cycles;
+
+    /*
+     * Pure spinning: skip ahead to whatever the firmware is waiting for.
+     * A spin that polls TCNTn may be waiting for a counter value rather
+     * than an interrupt, so it only skips up to 1 ms at a time.
+     */
+    if (++g_idle >= SIM_IDLE_ACCESSES) {
+        uint64_t next = sim_next_event();
+        if (g_polled && (next == SIM_NEVER || next > g_cycles + SIM_POLL_WARP_CYCLES)) {
+            next = g_cycles + SIM_POLL_WARP_CYCLES;
+        }
+        if (next != SIM_NEVER && next > g_cycles) {
+            g_cycles = (next < g_limit) ? next : g_limit;
+        }
+        g_idle = 0;
+        g_polled = 0;
+    }
+
+    sim_service();
+
+    while (BIT_GET(g_io[0x5F], SREG_I) && sim_dispatch_one()) {
+        sim_service();
+    }
+}
+
+/* ============================================================================
+ * REGISTER ACCESS
+ * ============================================================================ */
+
+uint8_t sim_io_read(uint16_t addr)
+{
+    sim_tick(SIM_ACCESS_CYCLES);
+
+    switch (addr) {
+    case 0x46:                                  /* TCNT0 */
+        g_polled = 1;
+        return (uint8_t)g_timer0.count;
+    case 0xB2:                                  /* TCNT2 */
+        g_polled = 1;
+        return (uint8_t)g_timer2.count;
+    case 0x84:                                  /* TCNT1L: latch high byte */
+        g_polled = 1;
+        g_temp16 = (uint8_t)(g_timer1.count >> 8);
+        return (uint8_t)g_timer1.count;
+    case 0x85:                                  /* TCNT1H */
+    case 0x87:                                  /* ICR1H */
+        return g_temp16;
+    case 0x86:                                  /* ICR1L */
+        g_temp16 = g_io[0x87];
+        return g_io[0x86];
+    case 0xC6:                                  /* UDR0 (receive side) */
+        g_io[0xC0] &= (uint8_t)~BIT(UCSR0A_RXC0);
+        return g_io[0xC6];
+    default:
+        return g_io[addr & 0xFF];
+    }
+}
+
+void sim_io_write(uint16_t addr, uint8_t value)
+{
+    sim_tick(SIM_ACCESS_CYCLES);
+
+    /* Any peripheral write counts as activity; SREG toggling does not */
+    if (addr != 0x5F) {
+        g_idle = 0;
+        g_polled = 0;
+    }
+
+    switch (addr) {
+    case 0x35:                                  /* TIFR0: write one to clear */
+    case 0x36:                                  /* TIFR1 */
+    case 0x37:                                  /* TIFR2 */
+        g_io[addr] &= (uint8_t)~value;
+        break;
+    case 0x46:                                  /* TCNT0 */
+        g_timer0.count = value;
+        g_timer0.base = g_cycles;
+        break;
+    case 0xB2:                                  /* TCNT2 */
+        g_timer2.count = value;
+        g_timer2.base = g_cycles;
+        break;
+    case 0x85:                                  /* 16-bit high bytes -> TEMP */
+    case 0x87:
+    case 0x89:
+    case 0x8B:
+        g_temp16 = value;
+        break;
+    case 0x84:                                  /* TCNT1L: commit TEMP */
+        g_timer1.count = (uint32_t)value | ((uint32_t)g_temp16 << 8);
+        g_timer1.base = g_cycles;
+        break;
+    case 0x86:                                  /* ICR1L / OCR1AL / OCR1BL */
+    case 0x88:
+    case 0x8A:
+        g_io[addr] = value;
+        g_io[addr + 1] = g_temp16;
+        break;
+    case 0x3F:                                  /* EECR */
+        sim_eeprom_write_eecr(value);
+        break;
+    case 0x54:                                  /* MCUSR: flags only clear */
+        g_io[0x54] &= value;
+        break;
+    case 0x60:                                  /* WDTCSR */
+        sim_wdt_write(value);
+        break;
+    case 0xC0:                                  /* UCSR0A: TXC0 write-one-clear */
+        if (BIT_GET(value, UCSR0A_TXC0)) {
+            g_io[0xC0] &= (uint8_t)~BIT(UCSR0A_TXC0);
+        }
+        g_io[0xC0] = (uint8_t)((g_io[0xC0] & ~(BIT(UCSR0A_U2X0) | 0x01)) |
+                               (value & (BIT(UCSR0A_U2X0) | 0x01)));
+        break;
+    case 0xC6:                                  /* UDR0 (transmit side) */
+        sim_uart_write_udr(value);
+        break;
+    default:
+        g_io[addr & 0xFF] = value;
+        break;
+    }
+
+    /* Setting I (e.g. CRITICAL_SECTION_END) may unmask a pending IRQ */
+    while (BIT_GET(g_io[0x5F], SREG_I) && sim_dispatch_one()) {
+        sim_service();
+    }
+}
+
+void sim_sei(void)
+{
+    g_cycles += 1;
+    g_io[0x5F] |= BIT(SREG_I);
+
+    while (sim_dispatch_one()) {
+        sim_service();
+    }
+}
+
+void sim_cli(void)
+{
+    g_cycles += 1;
+    g_io[0x5F] &= (uint8_t)~BIT(SREG_I);
+}
+
+void sim_nop(void)
+{
+    sim_tick(1);
+}
+
+/*
+ * sei; sleep. Like the real pair, an interrupt already pending wakes the
+ * CPU straight away. In idle mode the clocks keep running, so virtual
+ * time skips from event to event until one of them raises an interrupt.
+ */
+void sim_sei_sleep(void)
+{
+    g_cycles += 2;
+    g_io[0x5F] |= BIT(SREG_I);
+
+    if (BIT_GET(g_io[0x53], SMCR_SE)) {
+        while (!sim_dispatch_one()) {
+            uint64_t next = sim_next_event();
+
+            if (next == SIM_NEVER || next <= g_cycles) {
+                next = g_cycles + SIM_POLL_WARP_CYCLES;
+            }
+            g_cycles = (next < g_limit) ? next : g_limit;
+            sim_service();
+        }
+    }
+
+    while (sim_dispatch_one()) {
+        sim_service();
+    }
+    g_idle = 0;
+}
+
+void sim_io_flip(uint8_t addr, uint8_t bit)
+{
+    switch (addr) {
+    case 0x46:                                  /* TCNT0 */
+        g_timer0.count ^= BIT(bit);
+        break;
+    case 0xB2:                                  /* TCNT2 */
+        g_timer2.count ^= BIT(bit);
+        break;
+    case 0x84:                                  /* TCNT1L */
+        g_timer1.count ^= BIT(bit);
+        break;
+    case 0x85:                                  /* TCNT1H */
+        g_timer1.count ^= (uint32_t)BIT(bit) << 8;
+        break;
+    case 0x60:                                  /* WDTCSR: may switch it on */
+        g_io[0x60] ^= (uint8_t)BIT(bit);
+        if (g_wdt_deadline == SIM_NEVER) {
+            sim_wdt_rearm();
+        }
+        break;
+    default:
+        g_io[addr] ^= (uint8_t)BIT(bit);
+        break;
+    }
+}
+
+/* ============================================================================
+ * ENTRY POINT
+ * ============================================================================ */
+
+static void sim_on_signal(int sig)
+{
+    if (sig == SIGSEGV || sig == SIGBUS || sig == SIGILL) {
+        /* Wild jump (e.g. ATTACK_MODE_B): restart without reset flags */
+        static const char msg[] = "\n[sim] wild jump -> software reset\n";
+        if (!campaign_enabled() && write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) {
+            /* Nothing useful to do */
+        }
+        sim_reset(0);
+    }
+
+    fflush(g_uart_out);
+    sim_report(stderr);
+    _exit(0);
+}
+
+static void sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--time SEC] [--eeprom FILE] [--uart FILE] [--uart-in FILE]\n"
+            "  --time SEC     stop after SEC seconds of virtual time\n"
+            "  --eeprom FILE  EEPROM backing file (default: fira_eeprom.bin)\n"
+            "  --uart FILE    UART output file or FIFO (default: stdout)\n"
+            "  --uart-in FILE UART input file or FIFO, - for stdin (default: none)\n"
+            "\n"
+            "Fault-injection campaign:\n"
+            "  --campaign N   run N single-bit-flip experiments\n"
+            "  --inject-at S  injection point in virtual seconds (default 5)\n"
+            "  --window S     observation window after injection (default 5)\n"
+            "  --target T     sram, io or all (default all)\n"
+            "  --jobs J       worker processes (default: online CPUs)\n"
+            "  --seed X       experiment selection seed (default 1)\n"
+            "  --detect STR   firmware detection marker (default DETECTED)\n"
+            "  --results FILE CSV output (default fira_campaign.csv)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *eeprom_path = "fira_eeprom.bin";
+    const char *uart_path = NULL;
+    const char *uart_in_path = NULL;
+    struct sigaction sa;
+    int i;
+
+    g_argv = argv;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--time") && i + 1 < argc) {
+            g_limit = (uint64_t)(strtod(argv[++i], NULL) * (double)F_CPU);
+        } else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) {
+            eeprom_path = argv[++i];
+        } else if (!strcmp(argv[i], "--uart") && i + 1 < argc) {
+            uart_path = argv[++i];
+        } else if (!strcmp(argv[i], "--uart-in") && i + 1 < argc) {
+            uart_in_path = argv[++i];
+        } else if (campaign_parse_arg(argc, argv, &i)) {
+            /* Consumed */
+        } else {
+            sim_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    g_uart_out = stdout;
+    if (uart_path) {
+        g_uart_out = fopen(uart_path, "ab");
+        if (!g_uart_out) {
+            perror(uart_path);
+            return 1;
+        }
+    }
+
+    /* Reopened after every reset; bytes not yet read stay in the source */
+    if (uart_in_path) {
+        g_uart_in = strcmp(uart_in_path, "-") ? open(uart_in_path, O_RDONLY | O_CLOEXEC) : STDIN_FILENO;
+        if (g_uart_in < 0) {
+            perror(uart_in_path);
+            return 1;
+        }
+        fcntl(g_uart_in, F_SETFL, fcntl(g_uart_in, F_GETFL) | O_NONBLOCK);
+    }
+
+    sim_eeprom_open(eeprom_path);
+
+    g_wall_start_ns = sim_wall_ns();
+    sim_restore();
+    campaign_init();
+
+    /* Power-on register state */
+    g_io[0xC0] = BIT(UCSR0A_UDRE0);
+    g_io[0x5D] = LOW_BYTE(SIM_RAMEND);
+    g_io[0x5E] = HIGH_BYTE(SIM_RAMEND);
+    if (g_io[0x54] & BIT(MCUSR_WDRF)) {
+        g_io[0x60] = BIT(WDTCSR_WDE);   /* WDRF forces the watchdog on */
+        sim_wdt_rearm();
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sim_on_signal;
+    sa.sa_flags = SA_NODEFER;
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+    sigaction(SIGILL, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    /* .init3 */
+    wdt_early_init();
+
+    return fira_main();
+}
@@ -0,0 +1,55 @@
+/*
+ * ============================================================================
+ * FIRA - Host Simulator
+ * Control interface for host-only tools
+ * ============================================================================
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief Virtual CPU cycles since the first power-on
+ */
+uint64_t sim_cycles(void);
+
+/**
+ * @brief Number of simulated resets so far
+ */
+uint32_t sim_reset_count(void);
+
+/**
+ * @brief Reset the simulated MCU (re-executes the process, never returns)
+ * @param mcusr Reset flags the firmware will see in MCUSR
+ */
+void sim_reset(uint8_t mcusr) __attribute__((noreturn));
+
+/**
+ * @brief Stop (or hand over to the campaign engine) at an absolute cycle
+ */
+void sim_set_limit(uint64_t cycles);
+
+/**
+ * @brief Read-only view of the simulated register file (data space 0x00-0xFF)
+ */
+const uint8_t *sim_io_space(void);
+
+/**
+ * @brief Flip one bit of a simulated I/O register in place
+ *
+ * Registers whose value lives in simulator state (TCNT0, TCNT1) are
+ * flipped there, so the upset behaves like one in the real latch.
+ */
+void sim_io_flip(uint8_t addr, uint8_t bit);
+
+/**
+ * @brief Give this process a private copy of the EEPROM
+ *
+ * Used by forked campaign runs so they never write the backing file.
+ */
+void sim_eeprom_detach(void);
+
+#endif /* SIM_H */
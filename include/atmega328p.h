@@ -1,9 +1,10 @@
-#define REG_EEARH       MMIO8(0x41)
-#define REG_EEARL       MMIO8(0x40)
-#define REG_EEDR        MMIO8(0x3C)
+#define REG_EEARH       MMIO8(0x42)
+#define REG_EEARL       MMIO8(0x41)
+#define REG_EEDR        MMIO8(0x40)
 #define EECR_EEPE       1
 #define EECR_EERE       0
 #define EECR_EEMPE      2
+#define EECR_EERIE      3
 
 #ifndef ATMEGA328P_H
 #define ATMEGA328P_H
@@ -11,13 +12,23 @@
 #include <stdint.h>
 
 
+#ifdef FIRA_HOST
+#include "host_io.h"            /* Simulated register file (make host) */
+#else
 #define MMIO8(addr)     (*(volatile uint8_t *)(addr))
 #define MMIO16(addr)    (*(volatile uint16_t *)(addr))
+#endif
 
 
 #define REG_SREG        MMIO8(0x5F)
+#define SREG_C          0       /* Carry */
+#define SREG_T          6       /* Bit copy storage */
 #define SREG_I          7       
 
+#define REG_SP          MMIO16(0x5D)    /* Stack Pointer */
+#define REG_SPL         MMIO8(0x5D)
+#define REG_SPH         MMIO8(0x5E)
+
 
 
 #define REG_MCUSR       MMIO8(0x54)
@@ -26,6 +37,12 @@
 #define MCUSR_BORF      2       
 #define MCUSR_WDRF      3       
 
+#define REG_SMCR        MMIO8(0x53)     /* Sleep Mode Control */
+#define SMCR_SE         0       /* Sleep enable */
+#define SMCR_SM0        1       /* Mode 000 = idle */
+#define SMCR_SM1        2
+#define SMCR_SM2        3
+
 
 #define REG_WDTCSR      MMIO8(0x60)
 #define WDTCSR_WDP0     0       
@@ -100,6 +117,11 @@
 #define TIMSK0_OCIE0A   1       /* Compare Match A Interrupt Enable */
 #define TIMSK0_OCIE0B   2       /* Compare Match B Interrupt Enable */
 
+/* TIFR0 bits */
+#define TIFR0_TOV0      0       /* Overflow Flag */
+#define TIFR0_OCF0A     1       /* Compare Match A Flag */
+#define TIFR0_OCF0B     2       /* Compare Match B Flag */
+
 
 
 #define REG_TCCR1A      MMIO8(0x80)     /* Timer/Counter1 Control A */
@@ -128,6 +150,30 @@
 #define TIMSK1_OCIE1A   1       /* Compare Match A Interrupt Enable */
 #define TIMSK1_OCIE1B   2       /* Compare Match B Interrupt Enable */
 
+/* TIFR1 bits */
+#define TIFR1_TOV1      0       /* Overflow Flag */
+#define TIFR1_OCF1A     1       /* Compare Match A Flag */
+#define TIFR1_OCF1B     2       /* Compare Match B Flag */
+
+
+
+#define REG_TCCR2A      MMIO8(0xB0)     /* Timer/Counter2 Control A */
+#define REG_TCCR2B      MMIO8(0xB1)     /* Timer/Counter2 Control B */
+#define REG_TCNT2       MMIO8(0xB2)     /* Timer/Counter2 Value */
+#define REG_OCR2A       MMIO8(0xB3)     /* Output Compare A */
+#define REG_TIMSK2      MMIO8(0x70)     /* Timer2 Interrupt Mask */
+#define REG_TIFR2       MMIO8(0x37)     /* Timer2 Interrupt Flag */
+
+/* TCCR2A / TCCR2B bits */
+#define TCCR2A_WGM21    1       /* CTC mode */
+#define TCCR2B_CS20     0       /* Clock Select bit 0 */
+#define TCCR2B_CS21     1       /* Clock Select bit 1 */
+#define TCCR2B_CS22     2       /* Clock Select bit 2 */
+
+/* TIMSK2 / TIFR2 bits */
+#define TIMSK2_OCIE2A   1       /* Compare Match A Interrupt Enable */
+#define TIFR2_OCF2A     1       /* Compare Match A Flag */
+
 
 
 #define REG_EECR        MMIO8(0x3F)     /* EEPROM Control Register */
@@ -176,16 +222,26 @@
 
 
 
+#ifndef FIRA_HOST
 #define INTERRUPTS_ENABLE()     __asm__ __volatile__ ("sei" ::: "memory")
 #define INTERRUPTS_DISABLE()    __asm__ __volatile__ ("cli" ::: "memory")
+#endif
 
 #define CRITICAL_SECTION_BEGIN  uint8_t _sreg_save = REG_SREG; INTERRUPTS_DISABLE()
 #define CRITICAL_SECTION_END    REG_SREG = _sreg_save
 
 
+#ifndef FIRA_HOST
 #define NOP()                   __asm__ __volatile__ ("nop")
 
 
 #define WDT_RESET()             __asm__ __volatile__ ("wdr")
 
+/* The instruction after sei always runs first: no wake-up is missed */
+#define SEI_SLEEP()             __asm__ __volatile__ ("sei" "\n\t" "sleep" ::: "memory")
+
+/* Not cleared by the C runtime, survives a watchdog reset */
+#define NOINIT                  __attribute__((section(".noinit")))
+#endif
+
 #endif 
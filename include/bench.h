@@ -0,0 +1,28 @@
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+
+/*
+ * Boot-time cycle benchmarks.
+ *
+ * Timer1 is borrowed at clk/1 as a 16-bit cycle counter, so benchmarks
+ * must run before fault_timer_init() claims it. Results go out over UART.
+ */
+
+typedef void (*bench_fn_t)(uint32_t arg);
+
+/**
+ * @brief Cycles spent in fn(arg), with call/timer overhead subtracted
+ * @note Saturates at 65535 cycles (~4 ms)
+ */
+uint16_t bench_measure(bench_fn_t fn, uint32_t arg);
+
+/**
+ * @brief Run every enabled benchmark and print the results
+ */
+void bench_run(void);
+
+#endif /* BENCH_H */
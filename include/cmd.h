@@ -0,0 +1,28 @@
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+
+
+/*
+ * UART command channel. One command per line (CR or LF), case-insensitive:
+ *
+ *   m <n|a-j>     fault model (n = none, a-j = FAULT_MODE_BITFLIP..STORM)
+ *   i <1-255>     injection interval in seconds (mean for random arrivals)
+ *   s <p|u|e>     arrivals: periodic, uniform or exponential (Poisson)
+ *   a / d         arm / disarm the fault timer
+ *   r             reset the persisted stats, the fault and upset counts
+ *   q             query settings and counters
+ *
+ * Every command answers with one line: "OK mode=A int=3 armed=1 arr=P", with
+ * the counters appended for q, or "ERR". In binary telemetry mode the
+ * answer is a TLM_REC_SETTINGS record (plus a summary record for q).
+ */
+
+/**
+ * @brief Execute any complete command lines waiting in the RX ring
+ * @param counter Application counter reported by the query command
+ */
+void cmd_poll(uint32_t counter);
+
+#endif /* CMD_H */
@@ -18,6 +18,10 @@
 
 /* ============================================================================
  * ATTACK MODE SELECTION (uncomment ONE)
+ *
+ * This, FAULT_INJECT_INTERVAL_SEC and FAULT_ARRIVAL_DEFAULT are only the
+ * first-boot defaults: all can be changed over the UART at runtime (which
+ * also reaches the fault models beyond A-C) and are kept in EEPROM.
  * ============================================================================ */
 
 #define ATTACK_MODE_A       /* Data Corruption (Bit Flip) */
@@ -30,7 +34,74 @@
 
 #define HEARTBEAT_INTERVAL_MS       100U
 #define FAULT_INJECT_INTERVAL_SEC   3U
-#define WDT_TIMEOUT_SEC             2U
+
+/*
+ * Fault arrival process (first-boot default, see fault_inject.h):
+ *   0 = periodic, every FAULT_INJECT_INTERVAL_SEC
+ *   1 = uniform gaps in [0, 2 x interval)
+ *   2 = Poisson: exponential gaps with the interval as mean
+ */
+#define FAULT_ARRIVAL_DEFAULT       0
+
+/*
+ * Interrupt-storm fault model: Timer2 interrupts every FAULT_STORM_PERIOD_US
+ * (1-127 us), FAULT_STORM_LENGTH of them per injection.
+ */
+#define FAULT_STORM_PERIOD_US       4U
+#define FAULT_STORM_LENGTH          5000U
+
+/*
+ * Supervisor deadlines (see supervisor.h): the longest a task may go
+ * without checking in. The watchdog timeout is the longest period that
+ * fits the tightest of them, so the loop deadline must stay above the
+ * slowest main-loop pass.
+ */
+#define SUPERVISOR_LOOP_DEADLINE_MS         100U
+#define SUPERVISOR_HEARTBEAT_DEADLINE_MS    (3U * HEARTBEAT_INTERVAL_MS)
+#define SUPERVISOR_SUMMARY_DEADLINE_MS      (RESEARCH_SUMMARY_INTERVAL + 1000U)
+
+/* How often the scheduler runs supervisor_poll(), well inside the WDT period */
+#define SUPERVISOR_KICK_INTERVAL_MS         10U
+
+/*
+ * Background RAM scrubber (see scrub.h): bytes CRC-checked per main-loop
+ * pass (about 100 cycles each), and the worst-case detection latency of
+ * each protected region.
+ */
+#define SCRUB_CHUNK_BYTES           8U
+#define SCRUB_STATS_LATENCY_MS      1000U
+#define SCRUB_FAULT_LATENCY_MS      500U
+
+/*
+ * Flash self-test (see flashcheck.h): bytes of the application image
+ * checksummed per main-loop pass (about 50 cycles each). A full sweep
+ * takes image size / FLASHCHECK_CHUNK_BYTES passes.
+ */
+#define FLASHCHECK_CHUNK_BYTES      256U
+
+/*
+ * Painted guard between the static data and the stack (see stack.h),
+ * checked on every systick. It has to absorb what the stack can grow in
+ * one systick period plus the deepest interrupt frame on top of that;
+ * stack.c refuses anything below STACK_FRAME_BUDGET.
+ */
+#define STACK_GUARD_BYTES           48U
+
+/*
+ * Timer0 prescaler for the free-running timebase. The overflow interrupt
+ * rate (and the systick_get_us() resolution) follows from it:
+ *   64   -> 4 us,  ISR every 1.024 ms
+ *   256  -> 16 us, ISR every 4.096 ms
+ *   1024 -> 64 us, ISR every 16.384 ms (low interrupt load)
+ */
+#define SYSTICK_PRESCALER           64U
+
+/*
+ * 1 = watchdog runs in interrupt-then-reset mode: the first timeout
+ * captures a crash record into .noinit RAM and forces a fast reset.
+ * 0 = plain reset mode.
+ */
+#define WDT_CRASH_CAPTURE           1
 
 /* ============================================================================
  * UART CONFIGURATION
@@ -38,16 +109,50 @@
 
 #define UART_BAUD_RATE      115200UL
 
+/* TX ring buffer size in bytes (power of two, max 256) */
+#define UART_TX_BUFFER_SIZE 128U
+
+/* 1 = uart_putc waits for space when the ring is full, 0 = drop and count */
+#define UART_TX_BLOCKING    1
+
+/* RX ring buffer size in bytes (power of two, max 256) */
+#define UART_RX_BUFFER_SIZE 32U
+
+/* Longest command line accepted on the UART (see cmd.h) */
+#define CMD_LINE_MAX        16U
+
+/* ============================================================================
+ * TELEMETRY CONFIGURATION
+ * ============================================================================ */
+
+/* 1 = COBS-framed binary records after boot (see telemetry.h), 0 = ASCII */
+#define TELEMETRY_BINARY    0
+
 /* ============================================================================
  * EEPROM MEMORY MAP
  * ============================================================================ */
 
+/* Legacy fixed-address stats (read once to migrate into the journal) */
 #define EEPROM_ADDR_MAGIC           0x0000
 #define EEPROM_ADDR_CRASH_COUNT     0x0002
 #define EEPROM_ADDR_TOTAL_UPTIME    0x0004
 
 #define EEPROM_MAGIC_VALUE          0xAA55
 
+/* Runtime fault-campaign settings (see settings.h) */
+#define EEPROM_ADDR_SETTINGS        0x0010
+
+/* Stats journal: ring of CRC-checked records spread over the upper EEPROM */
+#define EEPROM_JOURNAL_START        0x0040
+#define EEPROM_JOURNAL_SLOT_SIZE    16U
+#define EEPROM_JOURNAL_SLOTS        60U     /* 0x0040 - 0x03FF */
+
+/* Periodic stats checkpoint budget (journal appends per hour) */
+#define STATS_CHECKPOINT_PER_HOUR   12U
+
+/* Background write queue depth in bytes (power of two, max 256) */
+#define EEPROM_QUEUE_SIZE           32U
+
 /* ============================================================================
  * BUILD CONFIGURATION
  * ============================================================================ */
@@ -55,4 +160,17 @@
 #define ENABLE_RESEARCH_SUMMARY     1
 #define RESEARCH_SUMMARY_INTERVAL   10000U  /* ms */
 
+/* Print cycle benchmarks (see bench.h) once at boot */
+#define ENABLE_BOOT_BENCHMARK       0
+
+/* Triple-copy / complement protection of critical variables (see protect.h) */
+#define ENABLE_PROTECTED_VARS       1
+
+/* Sleep (AVR idle mode) between scheduler passes instead of spinning (see power.h) */
+#define ENABLE_IDLE_SLEEP           1
+
+/* Profiling probes on the hot paths (see probe.h), reported over UART */
+#define ENABLE_PROBES               0
+#define PROBE_REPORT_INTERVAL       10000U  /* ms */
+
 #endif /* CONFIG_H */
@@ -0,0 +1,61 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+
+
+/*
+ * Checksums, each in three speed/size variants over the same algorithm:
+ *
+ *   _bitwise  no table, ~8 shift/XOR steps per byte (smallest, slowest)
+ *   _nibble   16-entry PROGMEM table, two lookups per byte
+ *   _table    256-entry PROGMEM table, one lookup per byte (fastest)
+ *
+ * All of them are streaming: start from the _INIT value, feed the data in
+ * any number of chunks, and pass the running CRC back in each time. A
+ * table is only linked in if its variant is called. The boot benchmark
+ * prints cycles per byte; "make crc-size" lists the flash cost.
+ *
+ * Check values over "123456789": CRC-8 0xF4, CRC-16 0x29B1, CRC-32 0xCBF43926.
+ */
+
+/* CRC-8/SMBUS: poly 0x07, init 0x00, MSB first, no final XOR */
+#define CRC8_INIT           0x00U
+
+/* CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, MSB first, no final XOR */
+#define CRC16_CCITT_INIT    0xFFFFU
+
+/* CRC-32 (IEEE 802.3, zlib): reflected poly 0xEDB88320, init and final XOR 0xFFFFFFFF */
+#define CRC32_INIT          0xFFFFFFFFUL
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) single-byte step
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, uint8_t data);
+
+/**
+ * @brief CRC-16/CCITT-FALSE over a RAM buffer
+ */
+uint16_t crc16_ccitt(const void *data, uint16_t len);
+
+uint8_t crc8_bitwise(uint8_t crc, const void *data, uint16_t len);
+uint8_t crc8_nibble(uint8_t crc, const void *data, uint16_t len);
+uint8_t crc8_table(uint8_t crc, const void *data, uint16_t len);
+
+uint16_t crc16_ccitt_bitwise(uint16_t crc, const void *data, uint16_t len);
+uint16_t crc16_ccitt_nibble(uint16_t crc, const void *data, uint16_t len);
+uint16_t crc16_ccitt_table(uint16_t crc, const void *data, uint16_t len);
+
+uint32_t crc32_bitwise(uint32_t crc, const void *data, uint16_t len);
+uint32_t crc32_nibble(uint32_t crc, const void *data, uint16_t len);
+uint32_t crc32_table(uint32_t crc, const void *data, uint16_t len);
+
+/**
+ * @brief Final CRC-32 value from the running one
+ */
+static inline uint32_t crc32_final(uint32_t crc)
+{
+    return ~crc;
+}
+
+#endif /* CRC_H */
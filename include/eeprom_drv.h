@@ -5,6 +5,40 @@
 #include <stdint.h>
 
 
+/*
+ * Writes are queued and programmed in the background by the EE_READY ISR
+ * (~3.4 ms per byte), in FIFO order. eeprom_write_* only block when the
+ * queue is full. Reads see queued data before it reaches the array.
+ */
+
+/**
+ * @brief Queue a single byte write without blocking
+ * @return 1 if queued, 0 if the queue is full
+ */
+uint8_t eeprom_queue_byte(uint16_t addr, uint8_t data);
+
+/**
+ * @brief Queue a block write without blocking (all or nothing)
+ * @return 1 if the whole block was queued, 0 if there was not enough room
+ */
+uint8_t eeprom_queue_block(uint16_t addr, const void *src, uint16_t len);
+
+/**
+ * @brief Number of queued bytes not yet started
+ */
+uint8_t eeprom_pending(void);
+
+/**
+ * @brief 1 while queued or in-progress writes remain
+ */
+uint8_t eeprom_busy(void);
+
+/**
+ * @brief Block until every queued write has been programmed
+ * @note Safe with interrupts disabled; call before a deliberate reset
+ */
+void eeprom_flush(void);
+
 uint8_t eeprom_read_byte(uint16_t addr);
 
 void eeprom_write_byte(uint16_t addr, uint8_t data);
@@ -3,6 +3,55 @@
 #define FAULT_INJECT_H
 
 #include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Fault models, selectable at runtime (see cmd.h). Each one is an entry in
+ * the model table in fault_inject.c and runs from the Timer1 compare ISR,
+ * so every model does a bounded amount of work there. Random choices come
+ * from fault_random().
+ */
+typedef enum {
+    FAULT_MODE_NONE     = 0,    /* Safe mode: count injections only */
+    FAULT_MODE_BITFLIP  = 1,    /* Mode A: flip a bit of the victim */
+    FAULT_MODE_PC_RESET = 2,    /* Mode B: jump to the reset vector */
+    FAULT_MODE_HANG     = 3,    /* Mode C: hang until the watchdog fires */
+    FAULT_MODE_MULTIBIT = 4,    /* D: 2-4 adjacent bits of one victim byte */
+    FAULT_MODE_STUCK0   = 5,    /* E: a victim bit stuck at 0 */
+    FAULT_MODE_STUCK1   = 6,    /* F: a victim bit stuck at 1 */
+    FAULT_MODE_RETADDR  = 7,    /* G: a bit of the interrupted return address */
+    FAULT_MODE_SREG     = 8,    /* H: a flag of the interrupted SREG */
+    FAULT_MODE_PERIPH   = 9,    /* I: a bit of a peripheral register */
+    FAULT_MODE_STORM    = 10,   /* J: a burst of Timer2 interrupts */
+    FAULT_MODE_COUNT
+} fault_mode_t;
+
+/* Gap distribution between two injections */
+typedef enum {
+    FAULT_ARRIVAL_PERIODIC    = 0,  /* Exactly the interval */
+    FAULT_ARRIVAL_UNIFORM     = 1,  /* Uniform in [0, 2 x interval) */
+    FAULT_ARRIVAL_EXPONENTIAL = 2,  /* Poisson process, interval = mean */
+    FAULT_ARRIVAL_COUNT
+} fault_arrival_t;
+
+/* Shortest gap handed to Timer1 (64 us ticks), keeps OCR1A ahead of TCNT1 */
+#define FAULT_GAP_MIN_TICKS     16UL
+
+/* Mode used until one is set at runtime (ATTACK_MODE_x in config.h) */
+#if defined(ATTACK_MODE_A)
+#define FAULT_MODE_DEFAULT  FAULT_MODE_BITFLIP
+#elif defined(ATTACK_MODE_B)
+#define FAULT_MODE_DEFAULT  FAULT_MODE_PC_RESET
+#elif defined(ATTACK_MODE_C)
+#define FAULT_MODE_DEFAULT  FAULT_MODE_HANG
+#else
+#define FAULT_MODE_DEFAULT  FAULT_MODE_NONE
+#endif
+
+#if FAULT_ARRIVAL_DEFAULT >= 3
+#error "FAULT_ARRIVAL_DEFAULT must be 0, 1 or 2"
+#endif
 
 
 volatile uint32_t* fault_get_victim_ptr(void);
@@ -10,7 +59,54 @@ volatile uint32_t* fault_get_victim_ptr(void);
 void fault_set_victim_ptr(volatile uint32_t *ptr);
 
 
+void fault_set_mode(uint8_t mode);
+
+uint8_t fault_get_mode(void);
+
+void fault_set_arrival(uint8_t arrival);
+
+uint8_t fault_get_arrival(void);
+
+/**
+ * @brief Seed the injector's PRNG (xorshift32; 0 is replaced by a constant)
+ */
+void fault_seed(uint32_t seed);
+
+/**
+ * @brief Next PRNG output
+ */
+uint32_t fault_random(void);
+
+/**
+ * @brief Draw the next inter-arrival gap (ISR-safe, fixed worst-case cost)
+ * @param mean_ticks Mean gap in Timer1 ticks (64 us, up to 255 s worth)
+ * @return Gap in Timer1 ticks, at least FAULT_GAP_MIN_TICKS
+ */
+uint32_t fault_arrival_gap(uint32_t mean_ticks);
+
+/**
+ * @brief Run the current fault model (from the Timer1 ISR)
+ */
 void fault_inject_execute(void);
 
+
+/*
+ * Stuck-at bits of the victim. They are forced again on every systick
+ * interrupt until the fault model changes, so software writes cannot
+ * clear them for more than one timebase period.
+ */
+extern volatile uint32_t *volatile g_fault_stuck_ptr;
+extern volatile uint32_t g_fault_stuck_clr;
+extern volatile uint32_t g_fault_stuck_set;
+
+static inline void fault_stuck_hold(void)
+{
+    volatile uint32_t *victim = g_fault_stuck_ptr;
+    
+    if (victim) {
+        *victim = (*victim & ~g_fault_stuck_clr) | g_fault_stuck_set;
+    }
+}
+
 #endif /* FAULT_INJECT_H */
 // ...existing code...
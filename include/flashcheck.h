@@ -0,0 +1,53 @@
+#ifndef FLASHCHECK_H
+#define FLASHCHECK_H
+
+#include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Application flash self-test.
+ *
+ * tools/fira_flashcrc.py runs after linking and stores the image length
+ * and its CRC-32 (slot excluded) in g_flash_image. flashcheck_poll() (main
+ * loop) reads FLASHCHECK_CHUNK_BYTES of flash per call with pgm_read_byte
+ * and compares the result at the end of every sweep; a mismatch is
+ * counted and raised as an event.
+ *
+ * A build whose slot was never filled in (the host build, or an ELF
+ * linked without the post-link step) leaves the test disabled.
+ */
+
+typedef struct {
+    uint32_t crc;               /* CRC-32 of the image without this slot */
+    uint16_t length;            /* Image bytes from address 0 */
+} flash_image_t;
+
+typedef struct {
+    uint16_t length;            /* 0 = not embedded, test disabled */
+    uint32_t expected;
+    uint16_t sweeps;            /* Completed sweeps (saturates) */
+    uint16_t bad;               /* Sweeps that ended in a mismatch */
+    uint32_t period_ms;         /* Duration of the last full sweep */
+} flashcheck_info_t;
+
+extern const flash_image_t g_flash_image;
+
+/**
+ * @brief Read the embedded length and CRC and start the first sweep
+ */
+void flashcheck_init(void);
+
+/**
+ * @brief Checksum the next chunk (call once per main-loop pass)
+ */
+void flashcheck_poll(void);
+
+/**
+ * @brief 1 if a sweep ended in a mismatch since the last call
+ */
+uint8_t flashcheck_take_event(void);
+
+void flashcheck_get_info(flashcheck_info_t *info);
+
+#endif /* FLASHCHECK_H */
@@ -0,0 +1,44 @@
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+
+/*
+ * Division-free integer formatting.
+ *
+ * Decimal digits are produced by repeated subtraction of powers of ten,
+ * so no 32-bit software division is ever called. Every function writes a
+ * NUL-terminated string and returns its length (excluding the NUL).
+ */
+
+/* Buffer sizes including the terminating NUL */
+#define FMT_U8_LEN      4U
+#define FMT_U16_LEN     6U
+#define FMT_U32_LEN     11U
+#define FMT_I32_LEN     12U
+#define FMT_HEX32_LEN   9U
+
+uint8_t fmt_u8(char *buf, uint8_t num);
+
+uint8_t fmt_u16(char *buf, uint16_t num);
+
+uint8_t fmt_u32(char *buf, uint32_t num);
+
+uint8_t fmt_i32(char *buf, int32_t num);
+
+/**
+ * @brief Right-align a decimal value in a field of @p width characters
+ * @param pad Fill character (' ' or '0'); width is clamped to 10
+ */
+uint8_t fmt_u32_pad(char *buf, uint32_t num, uint8_t width, char pad);
+
+/**
+ * @brief Upper-case hex without prefix, always 2 / 4 / 8 digits
+ */
+uint8_t fmt_hex8(char *buf, uint8_t num);
+uint8_t fmt_hex16(char *buf, uint16_t num);
+uint8_t fmt_hex32(char *buf, uint32_t num);
+
+#endif /* FMT_H */
@@ -0,0 +1,40 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Idle sleep and duty-cycle accounting.
+ *
+ * power_idle() puts the CPU in idle mode until the next interrupt. Timers,
+ * the UART and the watchdog keep running in idle mode, and the systick
+ * overflow wakes it at least every 256 Timer0 ticks, so a sleep never
+ * outlasts a supervisor deadline. The time spent asleep is measured with
+ * systick_get_ticks() around the sleep; it includes the ISR that ends it.
+ *
+ * With ENABLE_IDLE_SLEEP = 0 the call returns at once, the loop spins as
+ * before and the reported load is 100%.
+ */
+
+typedef struct {
+    uint32_t window_us;         /* Since power_reset_stats() */
+    uint32_t sleep_us;          /* Asleep within the window */
+    uint32_t sleeps;
+    uint16_t load_permille;     /* Awake share of the window */
+} power_info_t;
+
+/**
+ * @brief Sleep until the next interrupt (call with interrupts enabled)
+ */
+void power_idle(void);
+
+void power_get_info(power_info_t *info);
+
+/**
+ * @brief Start a new accounting window
+ */
+void power_reset_stats(void);
+
+#endif /* POWER_H */
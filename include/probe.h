@@ -0,0 +1,113 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "atmega328p.h"
+#include "timer.h"
+
+
+/*
+ * Profiling probes.
+ *
+ * PROBE_BEGIN/PROBE_END bracket a region and record its duration in CPU
+ * cycles. Per probe we keep count, min, max, total and a log2 histogram in
+ * fixed RAM; a report goes out over UART every PROBE_REPORT_INTERVAL ms,
+ * one line per probe_report_poll() call. With ENABLE_PROBES = 0 every
+ * macro compiles to nothing.
+ *
+ * Timing: Timer2 runs free at clk/1 (no interrupt), so TCNT2 gives the
+ * cycle count modulo 256. The timebase (SYSTICK_TICK_CYCLES per tick)
+ * gives the duration to within one tick, which picks the right multiple
+ * of 256. Main-loop probes take the timebase from systick_get_ticks();
+ * the ISR variants use TCNT0 alone, which also works inside the Timer0
+ * overflow ISR and covers up to 255 ticks.
+ *
+ * The interrupt-storm fault model borrows Timer2 and hands it back with
+ * probe_timer_start(); regions that overlap a storm are only accurate
+ * to a couple of timebase ticks.
+ *
+ * Each probe id must only be used from one context (main loop or one ISR).
+ */
+
+typedef enum {
+    PROBE_LOOP = 0,             /* One scheduler dispatch */
+    PROBE_HEARTBEAT,            /* heartbeat() when it fires */
+    PROBE_SUMMARY,              /* research_summary() when it fires */
+    PROBE_UART_PUTS,            /* uart_puts_P() */
+    PROBE_EEPROM_ISR,           /* EE_READY */
+    PROBE_SYSTICK_ISR,          /* TIMER0_OVF */
+    PROBE_FAULT_ISR,            /* TIMER1_COMPA (not for models B and C) */
+    PROBE_CHECKPOINT,           /* stats_checkpoint_poll() */
+    PROBE_SCRUB,                /* scrub_poll() */
+    PROBE_FLASHCHECK,           /* flashcheck_poll() */
+    PROBE_COUNT
+} probe_id_t;
+
+/*
+ * Histogram: bucket 0 holds durations under 16 cycles, bucket b >= 1
+ * 2^(b+3) .. 2^(b+4) - 1 cycles; the last bucket is open-ended (>= 8192)
+ */
+#define PROBE_HIST_BUCKETS      11U
+#define PROBE_HIST_SHIFT        4U
+
+#if ENABLE_PROBES
+
+#if SYSTICK_TICK_CYCLES >= 128
+#error "Probe timing needs a timebase tick shorter than half a TCNT2 period"
+#endif
+
+/*
+ * Duration from a coarse tick count and the TCNT2 difference: the coarse
+ * estimate is off by less than one tick, so the signed difference to the
+ * exact count modulo 256 is the correction.
+ */
+static inline uint32_t probe_cycles(uint32_t ticks, uint8_t fine)
+{
+    uint32_t coarse = ticks * SYSTICK_TICK_CYCLES;
+    
+    return coarse + (uint32_t)(int32_t)(int8_t)(uint8_t)(fine - (uint8_t)coarse);
+}
+
+#define PROBE_BEGIN(id)         uint32_t probe_t0_##id = systick_get_ticks(); \
+                                uint8_t probe_f0_##id = REG_TCNT2
+#define PROBE_END(id)           probe_record((id), probe_cycles( \
+                                    systick_get_ticks() - probe_t0_##id, \
+                                    (uint8_t)(REG_TCNT2 - probe_f0_##id)))
+#define PROBE_ISR_BEGIN(id)     uint8_t probe_t0_##id = REG_TCNT0; \
+                                uint8_t probe_f0_##id = REG_TCNT2
+#define PROBE_ISR_END(id)       probe_record((id), probe_cycles( \
+                                    (uint8_t)(REG_TCNT0 - probe_t0_##id), \
+                                    (uint8_t)(REG_TCNT2 - probe_f0_##id)))
+
+/**
+ * @brief Run Timer2 free at clk/1 for the probes (boot, and after a storm)
+ */
+void probe_timer_start(void);
+
+/**
+ * @brief Add one sample (in CPU cycles) to a probe
+ */
+void probe_record(uint8_t id, uint32_t cycles);
+
+/**
+ * @brief Print and reset the probe table every PROBE_REPORT_INTERVAL ms
+ * @note Sends at most one line per call, and only when the TX ring is
+ *       empty, so it never blocks (call it from a background task)
+ * @return 1 while a report is being sent
+ */
+uint8_t probe_report_poll(void);
+
+#else
+
+#define PROBE_BEGIN(id)
+#define PROBE_END(id)
+#define PROBE_ISR_BEGIN(id)
+#define PROBE_ISR_END(id)
+
+#define probe_timer_start()     ((void)0)
+#define probe_report_poll()     0U
+
+#endif /* ENABLE_PROBES */
+
+#endif /* PROBE_H */
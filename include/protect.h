@@ -0,0 +1,230 @@
+#ifndef PROTECT_H
+#define PROTECT_H
+
+#include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Protected variables against single-event upsets in RAM.
+ *
+ * tmrN_t keeps three copies and reads by bitwise majority vote: an upset
+ * confined to one copy is corrected in place and counted. cplN_t keeps
+ * the value and its complement: less RAM and cheaper, but it can only
+ * detect, so the caller decides what a failed read means.
+ *
+ * The inline read only compares the copies; a mismatch leaves the fast
+ * path for the out-of-line repair in protect.c. A variable shared with an
+ * ISR still needs interrupts off around main-loop accesses, as any
+ * multi-byte value does.
+ *
+ * With ENABLE_PROTECTED_VARS = 0 both types hold a single plain copy, so
+ * the cost of protection can be compared against the same code (see the
+ * boot benchmark). Fault model A always targets the first copy (.a).
+ */
+
+#if ENABLE_PROTECTED_VARS
+
+typedef struct { uint8_t a, b, c; } tmr8_t;
+typedef struct { uint16_t a, b, c; } tmr16_t;
+typedef struct { uint32_t a, b, c; } tmr32_t;
+
+typedef struct { uint8_t v, n; } cpl8_t;
+typedef struct { uint16_t v, n; } cpl16_t;
+typedef struct { uint32_t v, n; } cpl32_t;
+
+#define TMR_INIT(x)         { (x), (x), (x) }
+#define CPL8_INIT(x)        { (uint8_t)(x), (uint8_t)~(x) }
+#define CPL16_INIT(x)       { (uint16_t)(x), (uint16_t)~(x) }
+#define CPL32_INIT(x)       { (uint32_t)(x), (uint32_t)~(x) }
+
+#else
+
+typedef struct { uint8_t a; } tmr8_t;
+typedef struct { uint16_t a; } tmr16_t;
+typedef struct { uint32_t a; } tmr32_t;
+
+typedef struct { uint8_t v; } cpl8_t;
+typedef struct { uint16_t v; } cpl16_t;
+typedef struct { uint32_t v; } cpl32_t;
+
+#define TMR_INIT(x)         { (x) }
+#define CPL8_INIT(x)        { (uint8_t)(x) }
+#define CPL16_INIT(x)       { (uint16_t)(x) }
+#define CPL32_INIT(x)       { (uint32_t)(x) }
+
+#endif /* ENABLE_PROTECTED_VARS */
+
+
+/**
+ * @brief Majority-vote all three copies, write the result back and count it
+ * @note Slow path of tmrN_read(); only called on a mismatch
+ */
+uint8_t protect_tmr8_repair(volatile tmr8_t *t);
+uint16_t protect_tmr16_repair(volatile tmr16_t *t);
+uint32_t protect_tmr32_repair(volatile tmr32_t *t);
+
+/**
+ * @brief Count a complement mismatch (slow path of cplN_read())
+ */
+void protect_cpl_detected(void);
+
+/**
+ * @brief Upsets corrected by a TMR read since boot or the last reset (saturates)
+ */
+uint16_t protect_get_corrected(void);
+
+/**
+ * @brief Complement mismatches seen since boot or the last reset (saturates)
+ */
+uint16_t protect_get_detected(void);
+
+void protect_reset_counts(void);
+
+
+/* ============================================================================
+ * TRIPLE MODULAR REDUNDANCY
+ * ============================================================================ */
+
+#if ENABLE_PROTECTED_VARS
+
+static inline uint8_t tmr8_read(volatile tmr8_t *t)
+{
+    uint8_t a = t->a;
+    
+    if (a == t->b && a == t->c) {
+        return a;
+    }
+    return protect_tmr8_repair(t);
+}
+
+static inline uint16_t tmr16_read(volatile tmr16_t *t)
+{
+    uint16_t a = t->a;
+    
+    if (a == t->b && a == t->c) {
+        return a;
+    }
+    return protect_tmr16_repair(t);
+}
+
+static inline uint32_t tmr32_read(volatile tmr32_t *t)
+{
+    uint32_t a = t->a;
+    
+    if (a == t->b && a == t->c) {
+        return a;
+    }
+    return protect_tmr32_repair(t);
+}
+
+static inline void tmr8_write(volatile tmr8_t *t, uint8_t value)
+{
+    t->a = value;
+    t->b = value;
+    t->c = value;
+}
+
+static inline void tmr16_write(volatile tmr16_t *t, uint16_t value)
+{
+    t->a = value;
+    t->b = value;
+    t->c = value;
+}
+
+static inline void tmr32_write(volatile tmr32_t *t, uint32_t value)
+{
+    t->a = value;
+    t->b = value;
+    t->c = value;
+}
+
+#else
+
+static inline uint8_t tmr8_read(volatile tmr8_t *t) { return t->a; }
+static inline uint16_t tmr16_read(volatile tmr16_t *t) { return t->a; }
+static inline uint32_t tmr32_read(volatile tmr32_t *t) { return t->a; }
+
+static inline void tmr8_write(volatile tmr8_t *t, uint8_t value) { t->a = value; }
+static inline void tmr16_write(volatile tmr16_t *t, uint16_t value) { t->a = value; }
+static inline void tmr32_write(volatile tmr32_t *t, uint32_t value) { t->a = value; }
+
+#endif /* ENABLE_PROTECTED_VARS */
+
+/* ============================================================================
+ * VALUE + COMPLEMENT
+ * ============================================================================ */
+
+/*
+ * cplN_read() stores the value in *out either way and returns 1 if it
+ * matched its complement, 0 (counted) if one of the two was hit.
+ */
+#if ENABLE_PROTECTED_VARS
+
+static inline uint8_t cpl8_read(volatile cpl8_t *c, uint8_t *out)
+{
+    uint8_t v = c->v;
+    
+    *out = v;
+    if (v == (uint8_t)~c->n) {
+        return 1;
+    }
+    protect_cpl_detected();
+    return 0;
+}
+
+static inline uint8_t cpl16_read(volatile cpl16_t *c, uint16_t *out)
+{
+    uint16_t v = c->v;
+    
+    *out = v;
+    if (v == (uint16_t)~c->n) {
+        return 1;
+    }
+    protect_cpl_detected();
+    return 0;
+}
+
+static inline uint8_t cpl32_read(volatile cpl32_t *c, uint32_t *out)
+{
+    uint32_t v = c->v;
+    
+    *out = v;
+    if (v == ~c->n) {
+        return 1;
+    }
+    protect_cpl_detected();
+    return 0;
+}
+
+static inline void cpl8_write(volatile cpl8_t *c, uint8_t value)
+{
+    c->v = value;
+    c->n = (uint8_t)~value;
+}
+
+static inline void cpl16_write(volatile cpl16_t *c, uint16_t value)
+{
+    c->v = value;
+    c->n = (uint16_t)~value;
+}
+
+static inline void cpl32_write(volatile cpl32_t *c, uint32_t value)
+{
+    c->v = value;
+    c->n = ~value;
+}
+
+#else
+
+static inline uint8_t cpl8_read(volatile cpl8_t *c, uint8_t *out) { *out = c->v; return 1; }
+static inline uint8_t cpl16_read(volatile cpl16_t *c, uint16_t *out) { *out = c->v; return 1; }
+static inline uint8_t cpl32_read(volatile cpl32_t *c, uint32_t *out) { *out = c->v; return 1; }
+
+static inline void cpl8_write(volatile cpl8_t *c, uint8_t value) { c->v = value; }
+static inline void cpl16_write(volatile cpl16_t *c, uint16_t value) { c->v = value; }
+static inline void cpl32_write(volatile cpl32_t *c, uint32_t value) { c->v = value; }
+
+#endif /* ENABLE_PROTECTED_VARS */
+
+#endif /* PROTECT_H */
@@ -0,0 +1,99 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include "config.h"
+#include "timer.h"
+
+
+/*
+ * Cooperative task scheduler.
+ *
+ * Tasks live in a static table indexed by priority (0 runs first). A
+ * periodic task is released by a drift-free periodic_t (see timer.h)
+ * every period_ms; a background task (period 0) is released once per
+ * pass. sched_dispatch() runs the highest-priority
+ * ready task to completion. When nothing is ready the pass ends: the idle
+ * hook runs and the background tasks are released again.
+ *
+ * Selection is O(1): the ready set is a bitmask and the earliest pending
+ * release is cached, so a dispatch only walks the table when a periodic
+ * task actually comes due. Each run of a periodic task records how late
+ * it started in the timer's jitter histogram; periods that go by before
+ * it gets to run are dropped and counted as deadline misses.
+ *
+ * Run time per task and the scheduler's own cost per dispatch are measured
+ * with systick_get_us() (SYSTICK_TICK_US resolution) and kept per window,
+ * see sched_reset_stats(). Task run times are full 32-bit microseconds;
+ * only the per-dispatch overhead saturates at 16 bits.
+ */
+
+#define SCHED_MAX_TASKS         8U
+#define SCHED_MAX_PERIODIC      4U      /* Tasks with a period (and a histogram) */
+#define SCHED_NONE              0xFFU
+
+typedef void (*sched_fn_t)(void);
+
+typedef struct {
+    uint16_t period_ms;         /* 0 = background (every pass) */
+    uint8_t  mark;              /* WDT_TASK_MARK() id while it runs */
+    uint16_t misses;            /* Periods dropped (saturates) */
+    uint32_t runs;
+    uint32_t max_us;            /* Longest run */
+    uint32_t total_us;
+} sched_stats_t;
+
+typedef struct {
+    uint32_t dispatches;        /* Task runs plus idle passes */
+    uint32_t idle;              /* Passes that ended in the idle hook */
+    uint32_t overhead_us;       /* Scheduler time, summed over dispatches */
+    uint16_t overhead_max_us;   /* Saturates */
+} sched_info_t;
+
+/**
+ * @brief Add a task (priorities 0..SCHED_MAX_TASKS-1, each used once)
+ * @param mark WDT task marker set while it runs (see wdt.h)
+ * @param period_ms Release period, 0 for a background task
+ */
+void sched_add(uint8_t prio, uint8_t mark, sched_fn_t fn, uint16_t period_ms);
+
+/**
+ * @brief Called at the end of every pass (may be 0)
+ */
+void sched_set_idle(sched_fn_t fn);
+
+/**
+ * @brief First periodic release one period from now; background tasks ready
+ */
+void sched_start(void);
+
+/**
+ * @brief Run the next ready task, or the idle hook (call from the main loop)
+ */
+void sched_dispatch(void);
+
+/**
+ * @brief 1 if a periodic release is already due (the idle hook should not sleep)
+ */
+uint8_t sched_due(void);
+
+/**
+ * @brief Per-task counters of the current window
+ * @return 0 if no task has this priority
+ */
+uint8_t sched_get_stats(uint8_t prio, sched_stats_t *stats);
+
+/**
+ * @brief Release timer of a periodic task, with its jitter histogram
+ * @return 0 for a background task or an unused priority
+ */
+const periodic_t *sched_get_timer(uint8_t prio);
+
+void sched_get_info(sched_info_t *info);
+
+/**
+ * @brief Start a new measurement window (zero the counters)
+ */
+void sched_reset_stats(void);
+
+#endif /* SCHED_H */
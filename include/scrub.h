@@ -0,0 +1,65 @@
+#ifndef SCRUB_H
+#define SCRUB_H
+
+#include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Background RAM scrubber.
+ *
+ * Long-lived state is registered as a region with a stored CRC-16 and an
+ * optional shadow copy. scrub_poll() (main loop) re-checks at most
+ * SCRUB_CHUNK_BYTES per call, so its cost per loop pass is fixed. A pass
+ * over a region starts every latency_ms / 2, which bounds the time an
+ * upset can go unnoticed by latency_ms as long as the loop keeps up; the
+ * bound actually achieved is measured and reported.
+ *
+ * On a mismatch the region is restored from its shadow if the shadow
+ * still matches the CRC. Otherwise the upset is counted as lost and the
+ * current contents are accepted as the new reference. Either way the
+ * region's bit is raised in the event mask.
+ *
+ * Every legitimate write must be followed by scrub_commit(), from the
+ * same context (an ISR-written region commits inside the ISR).
+ */
+
+#define SCRUB_MAX_REGIONS       4U
+#define SCRUB_REGION_MAX        64U     /* Bytes per region */
+#define SCRUB_NONE              0xFFU
+
+typedef struct {
+    uint16_t latency_ms;        /* Configured worst-case detection latency */
+    uint16_t worst_ms;          /* Longest latency actually achieved */
+    uint16_t passes;            /* Completed passes (saturates) */
+    uint16_t repaired;          /* Upsets restored from the shadow */
+    uint16_t lost;              /* Upsets without a good shadow */
+} scrub_info_t;
+
+/**
+ * @brief Add a region and take its current contents as the reference
+ * @param shadow Buffer of len bytes for repairs, or 0 to detect only
+ * @return Region id, or SCRUB_NONE if the table is full or len is too big
+ */
+uint8_t scrub_register(volatile void *addr, void *shadow, uint8_t len, uint16_t latency_ms);
+
+/**
+ * @brief Region was written on purpose: refresh its CRC and shadow (ISR-safe)
+ */
+void scrub_commit(uint8_t id);
+
+/**
+ * @brief Check the next chunk (call once per main-loop pass)
+ */
+void scrub_poll(void);
+
+/**
+ * @brief Regions that saw an upset since the last call (bit per id)
+ */
+uint8_t scrub_take_events(void);
+
+uint8_t scrub_region_count(void);
+
+void scrub_get_info(uint8_t id, scrub_info_t *info);
+
+#endif /* SCRUB_H */
@@ -0,0 +1,48 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+
+
+/*
+ * Fault-campaign settings, changeable at runtime (see cmd.h) and kept in
+ * EEPROM at EEPROM_ADDR_SETTINGS so they survive watchdog resets. The
+ * entry also records the build defaults it started from: reflashing with
+ * a different ATTACK_MODE_x / FAULT_INJECT_INTERVAL_SEC /
+ * FAULT_ARRIVAL_DEFAULT discards it.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  mode;              /* fault_mode_t */
+    uint8_t  interval_sec;      /* 1-255 */
+    uint8_t  armed;             /* Fault timer running */
+    uint8_t  arrival;           /* fault_arrival_t */
+    uint16_t defaults;          /* Build defaults this entry derives from */
+    uint16_t crc;               /* CRC-16/CCITT over the preceding bytes */
+} settings_t;
+
+
+/**
+ * @brief Load settings from EEPROM, or the build defaults if none are valid
+ */
+void settings_load(void);
+
+/**
+ * @brief Push the settings to the fault injector and Timer1
+ */
+void settings_apply(void);
+
+const settings_t *settings_get(void);
+
+/*
+ * Setters apply the change immediately and queue it for EEPROM.
+ * Each returns 0 (and changes nothing) if the value is out of range.
+ */
+uint8_t settings_set_mode(uint8_t mode);
+
+uint8_t settings_set_interval(uint8_t interval_sec);
+
+uint8_t settings_set_armed(uint8_t armed);
+
+uint8_t settings_set_arrival(uint8_t arrival);
+
+#endif /* SETTINGS_H */
@@ -0,0 +1,79 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdint.h>
+#include "config.h"
+
+
+/*
+ * Stack usage and overflow detection.
+ *
+ * stack_paint() (.init3, before the C runtime sets up .data/.bss) fills
+ * the free RAM between the end of the static data and the top of the
+ * stack with STACK_PAINT. The lowest STACK_GUARD_BYTES of it are the
+ * guard: the systick ISR checks them with stack_guard_intact() and turns
+ * a dead guard into a stack-overflow crash record and an immediate reset,
+ * before the stack grows further into .bss/.noinit. stack_check() finds
+ * the lowest repainted byte, i.e. the deepest the stack has reached.
+ *
+ * The host build runs on the host's stack, so nothing is painted there
+ * and stack_get_info() reports a size of 0.
+ */
+
+#define STACK_PAINT             0xC5U
+
+/*
+ * What an interrupt can push below the deepest main-loop stack before the
+ * next systick sees a dead guard: the entry frame (return address, r0, r1,
+ * SREG and the 12 call-used registers), callee-saved registers and calls
+ * in the ISR body (TIMER1_COMPA goes two calls deep into a fault model),
+ * and the call into wdt_stack_overflow(). The capture after that runs from
+ * the top of the stack and does not count.
+ */
+#define STACK_ISR_ENTRY_BYTES   17U
+#define STACK_ISR_BODY_BYTES    16U
+#define STACK_OVERFLOW_CALL_BYTES 2U
+#define STACK_FRAME_BUDGET      (STACK_ISR_ENTRY_BYTES + STACK_ISR_BODY_BYTES + STACK_OVERFLOW_CALL_BYTES)
+
+typedef struct {
+    uint16_t size;              /* Bytes between the guard and the stack top, 0 = untracked */
+    uint16_t peak;              /* Deepest use seen by stack_check() */
+    uint16_t static_bytes;      /* .data + .bss + .noinit below the guard */
+} stack_info_t;
+
+#ifndef FIRA_HOST
+/* Linker symbols: end of the static data and the initial stack pointer */
+extern uint8_t _end;
+extern uint8_t __stack;
+
+/**
+ * @brief 1 while the guard below the stack still holds the paint (ISR-safe)
+ */
+static inline uint8_t stack_guard_intact(void)
+{
+    const volatile uint8_t *p = &_end;
+    uint8_t i;
+    
+    for (i = 0; i < STACK_GUARD_BYTES; i++) {
+        if (p[i] != STACK_PAINT) {
+            return 0;
+        }
+    }
+    return 1;
+}
+#else
+static inline uint8_t stack_guard_intact(void)
+{
+    return 1;
+}
+#endif
+
+/**
+ * @brief Update the high-water mark (cost grows with the unused stack)
+ * @return Bytes never used so far above the guard
+ */
+uint16_t stack_check(void);
+
+void stack_get_info(stack_info_t *info);
+
+#endif /* STACK_H */
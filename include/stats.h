@@ -3,32 +3,103 @@
 #define STATS_H
 
 #include <stdint.h>
+#include "wdt.h"
+#include "protect.h"
 
 
+/* Availability is reported in parts per million of total time */
+#define STATS_PPM_ONE           1000000UL
+
+/*
+ * The persisted totals are triplicated: an upset there would be written to
+ * the journal at the next checkpoint and outlive every reset. The tick
+ * fields only matter for the current session.
+ */
 typedef struct {
-    uint16_t crash_count;       /* Total crash count (persisted in EEPROM) */
-    uint32_t total_uptime_ms;   /* Cumulative uptime (persisted in EEPROM) */
+    tmr16_t  crash_count;       /* Total crash count (persisted in EEPROM) */
+    tmr32_t  total_uptime_s;    /* Uptime, folded in from the session at checkpoints */
+    tmr32_t  total_downtime_ms; /* Sum of measured crash-to-recovery gaps */
+    uint32_t uptime_tick;       /* Tick up to which session uptime is folded in */
+    uint16_t uptime_carry_ms;   /* Sub-second uptime carried over a crash */
     uint32_t session_start;     /* Current session start tick */
+    uint8_t  gap_open;          /* Crash boot: downtime closes at the first heartbeat */
 } system_stats_t;
 
+/*
+ * One journal entry as stored in EEPROM. Entries are appended to the next
+ * slot of a ring; the valid entry with the highest sequence number wins.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;               /* Monotonic, 0xFFFFFFFF = erased slot */
+    uint16_t crash_count;
+    uint32_t total_uptime_s;    /* Version 1 entries: milliseconds */
+    uint32_t total_downtime_ms; /* Version 1 entries: always 0 */
+    uint16_t crc;               /* CRC-16/CCITT over the preceding bytes + version */
+} stats_record_t;
+
+/* Journal health, filled in by stats_init() */
+typedef struct {
+    uint32_t seq;               /* Sequence number of the newest entry */
+    uint8_t  slot;              /* Slot holding the newest entry */
+    uint8_t  bad_slots;         /* Entries rejected by CRC during the scan */
+    uint32_t scan_cycles;       /* Boot-time recovery cost (CPU cycles, 64-cycle steps) */
+} stats_journal_t;
+
 
 void stats_init(void);
 
-void stats_record_crash(void);
+/**
+ * @brief Count a watchdog reset and open its downtime gap
+ * @param gasp Last-gasp record of the hang, or 0 if none was captured
+ *
+ * The gap runs from the last heartbeat before the hang (kept in .noinit
+ * across the reset) to the first heartbeat of this boot.
+ */
+void stats_record_crash(const wdt_crash_record_t *gasp);
+
+/**
+ * @brief Timestamp a heartbeat (call on every heartbeat)
+ * @return Downtime in ms if this heartbeat closed a crash gap, 0 otherwise
+ */
+uint32_t stats_heartbeat(void);
 
+/**
+ * @brief Append a checkpoint of the current stats to the journal
+ * @note Never blocks: if the EEPROM queue is full the checkpoint is
+ *       deferred to stats_checkpoint_poll()
+ */
 void stats_update_uptime(void);
 
+/**
+ * @brief Checkpoint uptime when due, or a deferred checkpoint, once the
+ *        EEPROM queue has room for a whole record (call from main loop)
+ */
+void stats_checkpoint_poll(void);
+
 uint16_t stats_get_crash_count(void);
 
+/**
+ * @brief Total uptime in seconds (persisted part plus this session)
+ */
 uint32_t stats_get_total_uptime(void);
 
+uint32_t stats_get_total_downtime(void);
+
 uint32_t stats_get_session_uptime(void);
 
-uint8_t stats_get_availability(void);
-void stats_reset(void);
-void stats_session_start(void);
-uint8_t stats_get_availability(void);
+/**
+ * @brief Uptime / (uptime + measured downtime), in ppm (STATS_PPM_ONE = 100%)
+ */
+uint32_t stats_get_availability_ppm(void);
+
+/**
+ * @brief Number of leading nines of an availability (999712 ppm -> 3)
+ */
+uint8_t stats_availability_nines(uint32_t ppm);
+
 void stats_reset(void);
 void stats_session_start(void);
 
+const stats_journal_t *stats_get_journal(void);
+
 #endif /* STATS_H */
@@ -0,0 +1,59 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include "wdt.h"
+
+
+/*
+ * Watchdog supervisor.
+ *
+ * Each registered task gets a deadline and a check-in bit. A task must
+ * call supervisor_checkin() at least once per deadline; supervisor_poll()
+ * (main loop) kicks the hardware watchdog only while every live task is
+ * within its deadline. A task that stalls while the loop keeps spinning
+ * therefore still ends in a watchdog reset.
+ *
+ * The hardware timeout is the longest WDT period that fits inside the
+ * tightest deadline, so a stuck main loop is caught in tens of ms.
+ */
+
+#define SUPERVISOR_MAX_TASKS    8U
+
+/**
+ * @brief Add a task (ids 0..SUPERVISOR_MAX_TASKS-1), live from the start
+ * @param deadline_ms Longest allowed gap between two check-ins
+ */
+void supervisor_register(uint8_t task, uint16_t deadline_ms);
+
+/**
+ * @brief Exclude a task from supervision, or bring it back (restarts its deadline)
+ */
+void supervisor_set_live(uint8_t task, uint8_t live);
+
+/**
+ * @brief Start all deadlines now and arm the watchdog from the tightest one
+ */
+void supervisor_start(void);
+
+/**
+ * @brief Task is alive (safe from ISRs)
+ */
+void supervisor_checkin(uint8_t task);
+
+/**
+ * @brief Collect check-ins and kick the watchdog if no live task is overdue
+ */
+void supervisor_poll(void);
+
+/**
+ * @brief Hardware timeout chosen by supervisor_start()
+ */
+wdt_timeout_t supervisor_get_timeout(void);
+
+/**
+ * @brief WDT period in ms (16 << timeout, so 125 ms shows as 128)
+ */
+uint16_t supervisor_timeout_ms(wdt_timeout_t timeout);
+
+#endif /* SUPERVISOR_H */
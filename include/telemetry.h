@@ -0,0 +1,84 @@
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "timer.h"
+
+
+/*
+ * Binary telemetry frame (before COBS encoding):
+ *
+ *   [type:1][payload:N][crc16:2]
+ *
+ * Multi-byte fields are little-endian. The CRC is CRC-16/CCITT-FALSE over
+ * type + payload, stored LSB first. Each frame is COBS-encoded and
+ * terminated by a single 0x00 delimiter.
+ */
+
+/* Largest raw frame (type + payload + CRC) */
+#define TLM_MAX_FRAME       32U
+
+typedef enum {
+    TLM_REC_HEARTBEAT   = 0x01,     /* counter:u32 uptime_ms:u32 faults:u16 */
+    TLM_REC_FAULT       = 0x02,     /* counter:u32 delta:i32 faults:u16 */
+    TLM_REC_CRASH       = 0x03,     /* crashes:u16 reset_reason:u8 */
+    TLM_REC_SUMMARY     = 0x04,     /* uptime_ms:u32 counter:u32 faults:u16
+                                       crashes:u16 avail_ppm:u32
+                                       downtime_ms:u32 drops:u16 */
+    TLM_REC_CRASH_INFO  = 0x05,     /* pc:u16 sp:u16 sreg:u8 systick_ms:u32
+                                       faults:u16 task:u8 stalled:u8
+                                       cause:u8 */
+    TLM_REC_RECOVERY    = 0x06,     /* downtime_ms:u32 total_downtime_ms:u32 */
+    TLM_REC_SETTINGS    = 0x07,     /* ok:u8 mode:u8 interval_sec:u8 armed:u8 arrival:u8 */
+    TLM_REC_JITTER      = 0x08      /* task:u8 interval_ms:u16 skipped:u16
+                                       hist:u16 x 12 (start lateness, bucket b
+                                       below 16 << b us) */
+} tlm_record_t;
+
+
+/**
+ * @brief Emit the 0x00 sync byte that marks the switch from ASCII to frames
+ */
+void telemetry_begin(void);
+
+/**
+ * @brief Start building a frame of the given record type
+ */
+void tlm_frame_begin(uint8_t type);
+
+void tlm_frame_put_u8(uint8_t value);
+void tlm_frame_put_u16(uint16_t value);
+void tlm_frame_put_u32(uint32_t value);
+
+/**
+ * @brief Append the CRC, COBS-encode and queue the frame on the UART
+ */
+void tlm_frame_end(void);
+
+
+void telemetry_heartbeat(uint32_t counter, uint32_t uptime_ms, uint16_t faults);
+
+void telemetry_fault(uint32_t counter, int32_t delta, uint16_t faults);
+
+void telemetry_crash(uint16_t crashes, uint8_t reset_reason);
+
+void telemetry_crash_info(uint16_t pc, uint16_t sp, uint8_t sreg,
+                          uint32_t systick_ms, uint16_t faults, uint8_t task,
+                          uint8_t stalled, uint8_t cause);
+
+void telemetry_recovery(uint32_t downtime_ms, uint32_t total_downtime_ms);
+
+void telemetry_settings(uint8_t ok, uint8_t mode, uint8_t interval_sec, uint8_t armed,
+                        uint8_t arrival);
+
+/**
+ * @brief Release-jitter histogram of one periodic task (fills a whole frame)
+ */
+void telemetry_jitter(uint8_t task, const periodic_t *timer);
+
+void telemetry_summary(uint32_t uptime_ms, uint32_t counter, uint16_t faults,
+                       uint16_t crashes, uint32_t avail_ppm,
+                       uint32_t downtime_ms, uint16_t drops);
+
+#endif /* TELEMETRY_H */
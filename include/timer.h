@@ -3,17 +3,85 @@
 #define TIMER_H
 
 #include <stdint.h>
+#include "config.h"
+
+
+/* One Timer0 tick of the timebase, in CPU cycles and microseconds */
+#define SYSTICK_TICK_CYCLES     SYSTICK_PRESCALER
+#define SYSTICK_TICK_US         (SYSTICK_PRESCALER / (F_CPU / 1000000UL))
 
 
 void systick_init(void);
 
 uint32_t systick_get_ms(void);
 
+/**
+ * @brief Microsecond timestamp (resolution SYSTICK_TICK_US, wraps after ~71 min)
+ */
+uint32_t systick_get_us(void);
+
+/**
+ * @brief Raw timebase count in SYSTICK_TICK_CYCLES units (Timer0 + overflows)
+ */
+uint32_t systick_get_ticks(void);
+
+/**
+ * @brief 1 once interval_ms has passed since *last_tick, then restarts from now
+ * @note Lateness accumulates; use a periodic_t for a fixed rate
+ */
 uint8_t systick_elapsed(uint32_t *last_tick, uint32_t interval_ms);
 
+/*
+ * Drift-free periodic timer. Each period starts exactly one interval
+ * after the previous one, however late it was served. Serving a period
+ * records its lateness (release jitter) in a log2 histogram; whole periods
+ * that went by unserved are counted as skipped and dropped.
+ *
+ * Bucket b holds lateness below 16 << b us; the last one everything above.
+ * Times are in microseconds (SYSTICK_TICK_US resolution), so intervals
+ * are limited to 65535 ms.
+ */
+#define PERIODIC_HIST_BUCKETS   12U
+
+typedef struct {
+    uint32_t due_us;            /* Start of the period not served yet */
+    uint32_t interval_us;
+    uint16_t skipped;           /* Periods dropped (saturates) */
+    uint16_t hist[PERIODIC_HIST_BUCKETS];
+} periodic_t;
+
+/**
+ * @brief First period due one interval from now; statistics cleared
+ */
+void periodic_start(periodic_t *p, uint16_t interval_ms);
+
+/**
+ * @brief 1 if the current period is due at now_us
+ */
+static inline uint8_t periodic_expired(const periodic_t *p, uint32_t now_us)
+{
+    return (int32_t)(now_us - p->due_us) >= 0;
+}
+
+/**
+ * @brief Serve the due period at now_us: record its lateness and move on
+ */
+void periodic_advance(periodic_t *p, uint32_t now_us);
+
+/**
+ * @brief Drop-in for systick_elapsed(): 1 (and advance) if a period is due
+ */
+uint8_t periodic_elapsed(periodic_t *p);
+
+void periodic_reset_stats(periodic_t *p);
+
 void delay_ms(uint16_t ms);
 
 
+/**
+ * @brief Start injecting faults, @p interval_sec seconds apart on average (1-255)
+ * @note Gaps follow the distribution set with fault_set_arrival()
+ */
 void fault_timer_init(uint8_t interval_sec);
 
 void fault_timer_enable(void);
@@ -27,6 +95,8 @@ void fault_timer_disable(void);
  */
 uint16_t fault_get_count(void);
 
+void fault_reset_count(void);
+
 /**
  * @brief Check if fault was recently injected (clears flag)
  * @return 1 if fault occurred, 0 otherwise
@@ -9,6 +9,28 @@ void uart_init(uint32_t baud_rate);
 
 void uart_putc(char c);
 
+/**
+ * @brief Queue a byte without ever blocking
+ * @return 1 if queued, 0 if the TX ring was full (byte dropped and counted)
+ */
+uint8_t uart_try_putc(char c);
+
+/**
+ * @brief Block until every queued byte has left the shift register
+ * @note Safe with interrupts disabled (drains the ring by polling)
+ */
+void uart_flush(void);
+
+/**
+ * @brief Number of bytes waiting in the TX ring
+ */
+uint8_t uart_tx_pending(void);
+
+/**
+ * @brief Number of bytes dropped because the TX ring was full
+ */
+uint16_t uart_tx_get_dropped(void);
+
 void uart_puts(const char *str);
 
 void uart_puts_P(const char *str);
@@ -19,18 +41,35 @@ void uart_put_u16(uint16_t num);
 
 void uart_put_u32(uint32_t num);
 
+/**
+ * @brief Print a decimal value right-aligned in @p width characters
+ * @param pad Fill character, e.g. ' ' or '0'
+ */
+void uart_put_u32_pad(uint32_t num, uint8_t width, char pad);
+
+void uart_put_hex8(uint8_t num);
+
+void uart_put_hex16(uint16_t num);
+
 void uart_put_i32(int32_t num);
 void uart_put_hex32(uint32_t num);
 void uart_newline(void);
+
+/**
+ * @brief Number of received bytes waiting in the RX ring
+ */
 uint8_t uart_available(void);
+
+/**
+ * @brief Take one byte from the RX ring (blocks until one arrives)
+ */
 char uart_getc(void);
-#define UART_PRINT(s)       uart_puts_P(PSTR(s))
-#define UART_PRINTLN(s)     do { uart_puts_P(PSTR(s)); uart_newline(); } while(0)
-void uart_put_i32(int32_t num);
-void uart_put_hex32(uint32_t num);
-void uart_newline(void);
-uint8_t uart_available(void);
-char uart_getc(void);
+
+/**
+ * @brief Number of received bytes lost because the RX ring was full
+ */
+uint16_t uart_rx_get_overruns(void);
+
 #define UART_PRINT(s)       uart_puts_P(PSTR(s))
 #define UART_PRINTLN(s)     do { uart_puts_P(PSTR(s)); uart_newline(); } while(0)
 
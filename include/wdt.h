@@ -27,6 +27,39 @@ typedef enum {
 } reset_reason_t;
 
 
+/* What ended the session described by a crash record */
+typedef enum {
+    WDT_CAUSE_HANG      = 0,    /* Watchdog interrupt: a task stopped checking in */
+    WDT_CAUSE_STACK     = 1     /* Stack reached the guard (see stack.h) */
+} wdt_cause_t;
+
+/*
+ * Crash record captured by the watchdog interrupt (WDT_CRASH_CAPTURE) or
+ * by the stack guard. Lives in .noinit RAM so it survives the reset that
+ * follows.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t pc;                /* Interrupted program counter (byte address) */
+    uint16_t sp;                /* Stack pointer before the interrupt */
+    uint8_t  sreg;              /* Status register at the time of the hang */
+    uint32_t systick_ms;        /* Uptime when the watchdog fired */
+    uint16_t faults;            /* Fault injections so far */
+    uint8_t  task;              /* Last WDT_TASK_MARK() value */
+    uint8_t  stalled;           /* Supervisor tasks past their deadline (mask) */
+    uint8_t  cause;             /* wdt_cause_t */
+    uint16_t crc;               /* CRC-16/CCITT over the preceding bytes */
+} wdt_crash_record_t;
+
+/* Last task marker, reported in the crash record */
+extern volatile uint8_t g_wdt_task;
+
+#define WDT_TASK_MARK(id)   (g_wdt_task = (uint8_t)(id))
+
+/* Overdue task mask, maintained by the supervisor (see supervisor.h) */
+extern volatile uint8_t g_wdt_stalled;
+
+
 uint8_t wdt_get_reset_reason(void);
 
 void wdt_clear_reset_reason(void);
@@ -48,13 +81,28 @@ void wdt_kick(void);
 
 /**
  * @brief Force immediate system reset via watchdog
+ * @note Arms the WDT in reset-only mode (16 ms): no crash record is taken
  */
 void wdt_force_reset(void);
 
+/**
+ * @brief Record a stack-overflow crash and reset within 16 ms
+ * @param sp Stack pointer at detection
+ * @note Switches to the top of the stack first, so the capture itself
+ *       does not grow the stack any further into .noinit
+ */
+void wdt_stack_overflow(uint16_t sp) __attribute__((noreturn));
+
 /**
  * @brief Check if last reset was caused by watchdog
  * @return 1 if watchdog reset, 0 otherwise
  */
 uint8_t wdt_was_reset(void);
 
+/**
+ * @brief Fetch (and consume) the crash record left by the last watchdog hit
+ * @return 1 if a valid record was copied to @p out, 0 otherwise
+ */
+uint8_t wdt_crash_record_take(wdt_crash_record_t *out);
+
 #endif /* WDT_H */
@@ -0,0 +1,449 @@
+
+#include "bench.h"
+#include "atmega328p.h"
+#include "uart.h"
+#include "fmt.h"
+#include "fault_inject.h"
+#include "protect.h"
+#include "crc.h"
+#include <avr/pgmspace.h>
+
+
+/* Output sink shared by the benchmarked functions */
+static char g_bench_buf[FMT_I32_LEN];
+
+/* Sinks for the fault injector benchmarks */
+static volatile uint32_t g_bench_gap;
+static volatile uint32_t g_bench_victim;
+
+/* Sink for results that must not be optimised away */
+static volatile uint32_t g_bench_sink;
+
+/* Cost of an empty bench_measure() call */
+static uint16_t g_bench_overhead = 0;
+
+static const char str_bench_hdr[] PROGMEM = "---- cycle benchmark (clk/1) ----";
+static const char str_bench_u32[] PROGMEM = "fmt u32 ";
+static const char str_bench_div[] PROGMEM = " div=";
+static const char str_bench_fast[] PROGMEM = " fast=";
+static const char str_bench_gap[] PROGMEM = "fault gap ";
+static const char str_bench_model[] PROGMEM = "fault model ";
+static const char str_bench_min[] PROGMEM = " min=";
+static const char str_bench_max[] PROGMEM = " max=";
+static const char str_bench_prot[] PROGMEM = "prot ";
+static const char str_bench_cyc_byte[] PROGMEM = " cyc/B=";
+static const char str_bench_table[] PROGMEM = " table=";
+static const char str_bench_check[] PROGMEM = "B check=";
+
+/* Arrival names, indexed by fault_arrival_t */
+static const char bench_arrival_names[] PROGMEM = "PUE";
+
+/* Models that are safe to run at boot against a scratch victim */
+static const uint8_t bench_fault_models[] PROGMEM = {
+    FAULT_MODE_NONE, FAULT_MODE_BITFLIP, FAULT_MODE_MULTIBIT,
+    FAULT_MODE_STUCK0, FAULT_MODE_STUCK1
+};
+
+/* Draws per distribution / runs per model */
+#define BENCH_FAULT_RUNS    64U
+
+
+/* ============================================================================
+ * CYCLE COUNTER
+ * ============================================================================ */
+
+static void bench_empty(uint32_t arg)
+{
+    (void)arg;
+}
+
+uint16_t bench_measure(bench_fn_t fn, uint32_t arg)
+{
+    uint16_t cycles;
+    
+    REG_TCCR1A = 0;
+    REG_TCCR1B = 0;
+    REG_TCNT1 = 0;
+    REG_TIFR1 = BIT(TIFR1_TOV1);                /* Writing 1 clears TOV1 */
+    REG_TCCR1B = BIT(TCCR1B_CS10);              /* Start at clk/1 */
+    
+    fn(arg);
+    
+    cycles = REG_TCNT1;
+    REG_TCCR1B = 0;
+    
+    if (BIT_GET(REG_TIFR1, TIFR1_TOV1)) {
+        return 0xFFFF;
+    }
+    
+    return (cycles > g_bench_overhead) ? (uint16_t)(cycles - g_bench_overhead) : 0;
+}
+
+/* ============================================================================
+ * FORMATTING
+ * ============================================================================ */
+
+/* The original uart_put_u32 conversion: one 32-bit divmod per digit */
+static void bench_fmt_div(uint32_t num)
+{
+    char *p = g_bench_buf + sizeof(g_bench_buf) - 1;
+    *p = '\0';
+    
+    if (num == 0) {
+        *--p = '0';
+    }
+    
+    while (num > 0) {
+        *--p = '0' + (num % 10);
+        num /= 10;
+    }
+    
+    __asm__ __volatile__ ("" ::: "memory");
+}
+
+static void bench_fmt_fast(uint32_t num)
+{
+    fmt_u32(g_bench_buf, num);
+    __asm__ __volatile__ ("" ::: "memory");
+}
+
+static const uint32_t bench_fmt_values[] PROGMEM = {
+    0UL, 7UL, 42UL, 999UL, 65535UL, 1234567UL, 4294967295UL
+};
+
+static void bench_fmt(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < sizeof(bench_fmt_values) / sizeof(bench_fmt_values[0]); i++) {
+        uint32_t value = pgm_read_dword(&bench_fmt_values[i]);
+        
+        uart_puts_P(str_bench_u32);
+        uart_put_u32_pad(value, 10, ' ');
+        uart_puts_P(str_bench_div);
+        uart_put_u16(bench_measure(bench_fmt_div, value));
+        uart_puts_P(str_bench_fast);
+        uart_put_u16(bench_measure(bench_fmt_fast, value));
+        uart_newline();
+    }
+}
+
+/* ============================================================================
+ * FAULT INJECTOR (ISR-side cost)
+ * ============================================================================ */
+
+static void bench_gap(uint32_t mean_ticks)
+{
+    g_bench_gap = fault_arrival_gap(mean_ticks);
+}
+
+static void bench_model(uint32_t arg)
+{
+    (void)arg;
+    fault_inject_execute();
+}
+
+static void bench_put_range(char name, uint16_t min, uint16_t max)
+{
+    uart_putc(name);
+    uart_puts_P(str_bench_min);
+    uart_put_u16(min);
+    uart_puts_P(str_bench_max);
+    uart_put_u16(max);
+    uart_newline();
+}
+
+/* Min and max cycles of fn over BENCH_FAULT_RUNS calls */
+static void bench_range(bench_fn_t fn, uint32_t arg, uint16_t *min, uint16_t *max)
+{
+    uint8_t i;
+    
+    *min = 0xFFFF;
+    *max = 0;
+    for (i = 0; i < BENCH_FAULT_RUNS; i++) {
+        uint16_t cycles = bench_measure(fn, arg);
+        
+        if (cycles < *min) {
+            *min = cycles;
+        }
+        if (cycles > *max) {
+            *max = cycles;
+        }
+    }
+}
+
+static void bench_fault(void)
+{
+    uint8_t saved_arrival = fault_get_arrival();
+    uint16_t min;
+    uint16_t max;
+    uint8_t i;
+    
+    /* Mean of 255 s: the widest operands the sampler sees */
+    for (i = 0; i < FAULT_ARRIVAL_COUNT; i++) {
+        fault_set_arrival(i);
+        bench_range(bench_gap, (F_CPU / 1024UL) * 255U, &min, &max);
+        uart_puts_P(str_bench_gap);
+        bench_put_range((char)pgm_read_byte(&bench_arrival_names[i]), min, max);
+    }
+    fault_set_arrival(saved_arrival);
+    
+    fault_set_victim_ptr(&g_bench_victim);
+    for (i = 0; i < sizeof(bench_fault_models); i++) {
+        uint8_t mode = pgm_read_byte(&bench_fault_models[i]);
+        
+        fault_set_mode(mode);
+        bench_range(bench_model, 0, &min, &max);
+        uart_puts_P(str_bench_model);
+        bench_put_range((char)(mode ? 'A' + mode - 1 : 'N'), min, max);
+    }
+    
+    /* Releases the stuck bits; settings_apply() sets the real mode */
+    fault_set_mode(FAULT_MODE_NONE);
+    fault_set_victim_ptr((volatile uint32_t *)0);
+}
+
+/* ============================================================================
+ * PROTECTED VARIABLES (per access)
+ * ============================================================================ */
+
+/*
+ * Plain, TMR and complement variable of one width, with one function per
+ * access. The "upset" function flips a bit of copy b ahead of the
+ * measured repair read.
+ */
+#if ENABLE_PROTECTED_VARS
+#define BENCH_PROT_COPY     b
+#else
+#define BENCH_PROT_COPY     a
+#endif
+
+#define BENCH_PROT_WIDTH(bits)                                                      \
+    static volatile uint##bits##_t g_bench_plain##bits;                             \
+    static volatile tmr##bits##_t g_bench_tmr##bits;                                \
+    static volatile cpl##bits##_t g_bench_cpl##bits = CPL##bits##_INIT(0);          \
+                                                                                    \
+    static void bench_plain##bits##_rd(uint32_t arg)                                \
+    {                                                                               \
+        (void)arg;                                                                  \
+        g_bench_sink = g_bench_plain##bits;                                         \
+    }                                                                               \
+    static void bench_plain##bits##_wr(uint32_t arg)                                \
+    {                                                                               \
+        g_bench_plain##bits = (uint##bits##_t)arg;                                  \
+    }                                                                               \
+    static void bench_tmr##bits##_rd(uint32_t arg)                                  \
+    {                                                                               \
+        (void)arg;                                                                  \
+        g_bench_sink = tmr##bits##_read(&g_bench_tmr##bits);                        \
+    }                                                                               \
+    static void bench_tmr##bits##_wr(uint32_t arg)                                  \
+    {                                                                               \
+        tmr##bits##_write(&g_bench_tmr##bits, (uint##bits##_t)arg);                 \
+    }                                                                               \
+    static void bench_tmr##bits##_upset(uint32_t arg)                               \
+    {                                                                               \
+        (void)arg;                                                                  \
+        g_bench_tmr##bits.BENCH_PROT_COPY ^= 1U;                                    \
+    }                                                                               \
+    static void bench_cpl##bits##_rd(uint32_t arg)                                  \
+    {                                                                               \
+        uint##bits##_t value;                                                       \
+        (void)arg;                                                                  \
+        g_bench_sink = cpl##bits##_read(&g_bench_cpl##bits, &value) ? value : 0U;   \
+    }                                                                               \
+    static void bench_cpl##bits##_wr(uint32_t arg)                                  \
+    {                                                                               \
+        cpl##bits##_write(&g_bench_cpl##bits, (uint##bits##_t)arg);                 \
+    }
+
+BENCH_PROT_WIDTH(8)
+BENCH_PROT_WIDTH(16)
+BENCH_PROT_WIDTH(32)
+
+/* Columns of one output row; the repair column runs after the upset */
+enum {
+    BENCH_PROT_PLAIN_RD = 0,
+    BENCH_PROT_PLAIN_WR,
+    BENCH_PROT_TMR_RD,
+    BENCH_PROT_TMR_WR,
+    BENCH_PROT_TMR_FIX,
+    BENCH_PROT_CPL_RD,
+    BENCH_PROT_CPL_WR,
+    BENCH_PROT_COLS
+};
+
+typedef struct {
+    char name[4];
+    bench_fn_t fn[BENCH_PROT_COLS];
+    bench_fn_t upset;
+} bench_prot_row_t;
+
+#define BENCH_PROT_ROW(bits, name)                                          \
+    { name, { bench_plain##bits##_rd, bench_plain##bits##_wr,               \
+              bench_tmr##bits##_rd, bench_tmr##bits##_wr,                   \
+              bench_tmr##bits##_rd,                                         \
+              bench_cpl##bits##_rd, bench_cpl##bits##_wr },                 \
+      bench_tmr##bits##_upset }
+
+static const bench_prot_row_t bench_prot_rows[] PROGMEM = {
+    BENCH_PROT_ROW(8, "u8 "),
+    BENCH_PROT_ROW(16, "u16"),
+    BENCH_PROT_ROW(32, "u32")
+};
+
+static const char bench_prot_cols[BENCH_PROT_COLS][10] PROGMEM = {
+    " plain r=", " w=", " tmr r=", " w=", " fix=", " cpl r=", " w="
+};
+
+static void bench_protect(void)
+{
+    uint8_t i;
+    uint8_t j;
+    
+    for (i = 0; i < sizeof(bench_prot_rows) / sizeof(bench_prot_rows[0]); i++) {
+        const bench_prot_row_t *row = &bench_prot_rows[i];
+        
+        uart_puts_P(str_bench_prot);
+        uart_puts_P(row->name);
+        for (j = 0; j < BENCH_PROT_COLS; j++) {
+            bench_fn_t fn = (bench_fn_t)pgm_read_ptr(&row->fn[j]);
+            
+            if (j == BENCH_PROT_TMR_FIX) {
+                ((bench_fn_t)pgm_read_ptr(&row->upset))(0);
+            }
+            uart_puts_P(bench_prot_cols[j]);
+            uart_put_u16(bench_measure(fn, 0x5AU));
+        }
+        uart_newline();
+    }
+    
+    /* The repairs above were not upsets */
+    protect_reset_counts();
+}
+
+/* ============================================================================
+ * CRC (cycles per byte)
+ * ============================================================================ */
+
+#define BENCH_CRC_LEN       64U
+
+static uint8_t g_bench_crc_buf[BENCH_CRC_LEN];
+
+static const char bench_crc_check_msg[] PROGMEM = "123456789";
+
+static void bench_crc8_bitwise(uint32_t len)
+{
+    g_bench_sink = crc8_bitwise(CRC8_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc8_nibble(uint32_t len)
+{
+    g_bench_sink = crc8_nibble(CRC8_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc8_table(uint32_t len)
+{
+    g_bench_sink = crc8_table(CRC8_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc16_bitwise(uint32_t len)
+{
+    g_bench_sink = crc16_ccitt_bitwise(CRC16_CCITT_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc16_nibble(uint32_t len)
+{
+    g_bench_sink = crc16_ccitt_nibble(CRC16_CCITT_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc16_table(uint32_t len)
+{
+    g_bench_sink = crc16_ccitt_table(CRC16_CCITT_INIT, g_bench_crc_buf, (uint16_t)len);
+}
+
+static void bench_crc32_bitwise(uint32_t len)
+{
+    g_bench_sink = crc32_final(crc32_bitwise(CRC32_INIT, g_bench_crc_buf, (uint16_t)len));
+}
+
+static void bench_crc32_nibble(uint32_t len)
+{
+    g_bench_sink = crc32_final(crc32_nibble(CRC32_INIT, g_bench_crc_buf, (uint16_t)len));
+}
+
+static void bench_crc32_table(uint32_t len)
+{
+    g_bench_sink = crc32_final(crc32_table(CRC32_INIT, g_bench_crc_buf, (uint16_t)len));
+}
+
+typedef struct {
+    char name[14];
+    bench_fn_t fn;
+    uint16_t table_bytes;       /* PROGMEM table; code size from "make crc-size" */
+} bench_crc_t;
+
+static const bench_crc_t bench_crcs[] PROGMEM = {
+    { "crc8  bitwise", bench_crc8_bitwise, 0 },
+    { "crc8  nibble ", bench_crc8_nibble, 16 },
+    { "crc8  table  ", bench_crc8_table, 256 },
+    { "crc16 bitwise", bench_crc16_bitwise, 0 },
+    { "crc16 nibble ", bench_crc16_nibble, 32 },
+    { "crc16 table  ", bench_crc16_table, 512 },
+    { "crc32 bitwise", bench_crc32_bitwise, 0 },
+    { "crc32 nibble ", bench_crc32_nibble, 64 },
+    { "crc32 table  ", bench_crc32_table, 1024 }
+};
+
+static void bench_crc(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < sizeof(bench_crcs) / sizeof(bench_crcs[0]); i++) {
+        const bench_crc_t *row = &bench_crcs[i];
+        bench_fn_t fn = (bench_fn_t)pgm_read_ptr(&row->fn);
+        uint32_t tenths;
+        uint8_t b;
+        
+        for (b = 0; b < BENCH_CRC_LEN; b++) {
+            g_bench_crc_buf[b] = (uint8_t)(b * 37U + 11U);
+        }
+        tenths = (uint32_t)bench_measure(fn, BENCH_CRC_LEN) * 10U / BENCH_CRC_LEN;
+        
+        uart_puts_P(row->name);
+        uart_puts_P(str_bench_cyc_byte);
+        uart_put_u32_pad(tenths / 10U, 4, ' ');
+        uart_putc('.');
+        uart_put_u8((uint8_t)(tenths % 10U));
+        uart_puts_P(str_bench_table);
+        uart_put_u32_pad(pgm_read_word(&row->table_bytes), 4, ' ');
+        
+        /* Standard check value, so a wrong table shows up here */
+        memcpy_P(g_bench_crc_buf, bench_crc_check_msg, sizeof(bench_crc_check_msg) - 1U);
+        fn(sizeof(bench_crc_check_msg) - 1U);
+        uart_puts_P(str_bench_check);
+        uart_put_hex32(g_bench_sink);
+        uart_newline();
+    }
+}
+
+/* ============================================================================
+ * ENTRY POINT
+ * ============================================================================ */
+
+void bench_run(void)
+{
+    g_bench_overhead = 0;
+    g_bench_overhead = bench_measure(bench_empty, 0);
+    
+    uart_puts_P(str_bench_hdr);
+    uart_newline();
+    
+    bench_fmt();
+    bench_fault();
+    bench_protect();
+    bench_crc();
+    
+    uart_newline();
+    uart_flush();
+}
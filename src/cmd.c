@@ -0,0 +1,254 @@
+
+#include "cmd.h"
+#include "settings.h"
+#include "fault_inject.h"
+#include "stats.h"
+#include "timer.h"
+#include "uart.h"
+#include "telemetry.h"
+#include "eeprom_drv.h"
+#include "protect.h"
+#include "config.h"
+#include <avr/pgmspace.h>
+
+
+/*
+ * A command saves at most one journal record. Wait for that much free
+ * EEPROM queue space instead of falling back to a blocking write, which
+ * could outlast the watchdog timeout.
+ */
+#define CMD_EEPROM_BACKLOG      (EEPROM_QUEUE_SIZE - 1U - EEPROM_JOURNAL_SLOT_SIZE)
+
+static char g_cmd_line[CMD_LINE_MAX];
+static uint8_t g_cmd_len = 0;
+static uint8_t g_cmd_overflow = 0;
+static uint8_t g_cmd_ready = 0;             /* Complete line waiting to run */
+
+/* Indexed by fault_mode_t */
+static const char cmd_mode_names[] PROGMEM = "NABCDEFGHIJ";
+
+/* Indexed by fault_arrival_t */
+static const char cmd_arrival_names[] PROGMEM = "PUE";
+
+static const char str_cmd_ok[] PROGMEM = "OK mode=";
+static const char str_cmd_int[] PROGMEM = " int=";
+static const char str_cmd_armed[] PROGMEM = " armed=";
+static const char str_cmd_arrival[] PROGMEM = " arr=";
+static const char str_cmd_counter[] PROGMEM = " counter=";
+static const char str_cmd_faults[] PROGMEM = " faults=";
+static const char str_cmd_crashes[] PROGMEM = " crashes=";
+static const char str_cmd_uptime[] PROGMEM = " uptime=";
+static const char str_cmd_downtime[] PROGMEM = "s downtime=";
+static const char str_cmd_ppm[] PROGMEM = "ms ppm=";
+static const char str_cmd_fixed[] PROGMEM = " fixed=";
+static const char str_cmd_err[] PROGMEM = "ERR";
+
+
+/* ============================================================================
+ * PARSING
+ * ============================================================================ */
+
+static inline char cmd_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+/* First non-blank character after the command letter */
+static const char *cmd_arg(void)
+{
+    const char *p = &g_cmd_line[1];
+    
+    while (*p == ' ') {
+        p++;
+    }
+    
+    return p;
+}
+
+/* Decimal 0-255; returns 0 on anything else */
+static uint8_t cmd_parse_u8(const char *p, uint8_t *out)
+{
+    uint16_t value = 0;
+    
+    if (*p == '\0') {
+        return 0;
+    }
+    
+    while (*p >= '0' && *p <= '9') {
+        value = (uint16_t)(value * 10U + (uint8_t)(*p - '0'));
+        if (value > 255U) {
+            return 0;
+        }
+        p++;
+    }
+    
+    if (*p != '\0') {
+        return 0;
+    }
+    
+    *out = (uint8_t)value;
+    return 1;
+}
+
+/* Single letter out of a PROGMEM name list; its index goes to *out */
+static uint8_t cmd_parse_letter(const char *p, const char *names, uint8_t count, uint8_t *out)
+{
+    uint8_t i;
+    
+    if (p[0] == '\0' || p[1] != '\0') {
+        return 0;
+    }
+    
+    for (i = 0; i < count; i++) {
+        if (cmd_lower(*p) == cmd_lower((char)pgm_read_byte(&names[i]))) {
+            *out = i;
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/* ============================================================================
+ * REPLIES
+ * ============================================================================ */
+
+static void cmd_reply(uint8_t ok, uint8_t query, uint32_t counter)
+{
+    const settings_t *s = settings_get();
+    
+#if TELEMETRY_BINARY
+    telemetry_settings(ok, s->mode, s->interval_sec, s->armed, s->arrival);
+    if (ok && query) {
+        telemetry_summary(stats_get_session_uptime(), counter, fault_get_count(),
+                          stats_get_crash_count(), stats_get_availability_ppm(),
+                          stats_get_total_downtime(), uart_tx_get_dropped());
+    }
+#else
+    if (!ok) {
+        uart_puts_P(str_cmd_err);
+        uart_newline();
+        return;
+    }
+    
+    uart_puts_P(str_cmd_ok);
+    uart_putc((char)pgm_read_byte(&cmd_mode_names[s->mode]));
+    uart_puts_P(str_cmd_int);
+    uart_put_u8(s->interval_sec);
+    uart_puts_P(str_cmd_armed);
+    uart_put_u8(s->armed);
+    uart_puts_P(str_cmd_arrival);
+    uart_putc((char)pgm_read_byte(&cmd_arrival_names[s->arrival]));
+    
+    if (query) {
+        uart_puts_P(str_cmd_counter);
+        uart_put_u32(counter);
+        uart_puts_P(str_cmd_faults);
+        uart_put_u16(fault_get_count());
+        uart_puts_P(str_cmd_crashes);
+        uart_put_u16(stats_get_crash_count());
+        uart_puts_P(str_cmd_uptime);
+        uart_put_u32(stats_get_total_uptime());
+        uart_puts_P(str_cmd_downtime);
+        uart_put_u32(stats_get_total_downtime());
+        uart_puts_P(str_cmd_ppm);
+        uart_put_u32(stats_get_availability_ppm());
+        uart_puts_P(str_cmd_fixed);
+        uart_put_u16(protect_get_corrected());
+    }
+    
+    uart_newline();
+#endif
+}
+
+/* ============================================================================
+ * DISPATCH
+ * ============================================================================ */
+
+static void cmd_execute(uint32_t counter)
+{
+    uint8_t ok = 0;
+    uint8_t query = 0;
+    uint8_t value;
+    
+    switch (cmd_lower(g_cmd_line[0])) {
+    case 'm':
+        ok = cmd_parse_letter(cmd_arg(), cmd_mode_names, FAULT_MODE_COUNT, &value) &&
+             settings_set_mode(value);
+        break;
+        
+    case 's':
+        ok = cmd_parse_letter(cmd_arg(), cmd_arrival_names, FAULT_ARRIVAL_COUNT, &value) &&
+             settings_set_arrival(value);
+        break;
+        
+    case 'i':
+        ok = cmd_parse_u8(cmd_arg(), &value) && settings_set_interval(value);
+        break;
+        
+    case 'a':
+        ok = settings_set_armed(1);
+        break;
+        
+    case 'd':
+        ok = settings_set_armed(0);
+        break;
+        
+    case 'r':
+        stats_reset();
+        fault_reset_count();
+        protect_reset_counts();
+        ok = 1;
+        break;
+        
+    case 'q':
+        ok = 1;
+        query = 1;
+        break;
+        
+    default:
+        break;
+    }
+    
+    cmd_reply(ok, query, counter);
+}
+
+void cmd_poll(uint32_t counter)
+{
+    for (;;) {
+        char c;
+        
+        if (g_cmd_ready) {
+            if (eeprom_pending() > CMD_EEPROM_BACKLOG) {
+                return;             /* Retry on a later pass */
+            }
+            cmd_execute(counter);
+            g_cmd_ready = 0;
+            g_cmd_len = 0;
+        }
+        
+        if (!uart_available()) {
+            return;
+        }
+        
+        c = uart_getc();
+        
+        if (c == '\r' || c == '\n') {
+            if (g_cmd_len != 0) {
+                g_cmd_line[g_cmd_len] = '\0';
+                if (g_cmd_overflow) {
+                    cmd_reply(0, 0, counter);
+                } else {
+                    g_cmd_ready = 1;
+                    continue;
+                }
+            }
+            g_cmd_len = 0;
+            g_cmd_overflow = 0;
+        } else if (g_cmd_len < CMD_LINE_MAX - 1) {
+            g_cmd_line[g_cmd_len++] = c;
+        } else {
+            g_cmd_overflow = 1;
+        }
+    }
+}
@@ -1,58 +1,214 @@
 
 #include "eeprom_drv.h"
 #include "atmega328p.h"
+#include "config.h"
+#include "probe.h"
+#include <avr/interrupt.h>
 
 
-static inline void eeprom_wait_ready(void)
+#if (EEPROM_QUEUE_SIZE & (EEPROM_QUEUE_SIZE - 1)) != 0 || EEPROM_QUEUE_SIZE > 256
+#error "EEPROM_QUEUE_SIZE must be a power of two no larger than 256"
+#endif
+
+#define EEPROM_QUEUE_MASK   ((uint8_t)(EEPROM_QUEUE_SIZE - 1))
+
+/* Pending byte write */
+typedef struct {
+    uint16_t addr;
+    uint8_t  data;
+} eeprom_op_t;
+
+/* Write queue: head is written by callers, tail by the EE_READY ISR */
+static volatile eeprom_op_t g_ee_queue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t g_ee_head = 0;
+static volatile uint8_t g_ee_tail = 0;
+
+
+/* ============================================================================
+ * LOW-LEVEL WRITE ENGINE
+ * ============================================================================ */
+
+/*
+ * Program one byte. Caller guarantees EEPE is clear and interrupts are
+ * disabled (EEMPE -> EEPE must happen within 4 cycles).
+ */
+static inline void eeprom_program(uint16_t addr, uint8_t data)
 {
-    /* Wait for EEPE (EEPROM Program Enable) to clear */
-    while (BIT_GET(REG_EECR, EECR_EEPE)) {
-        /* Spin */
-    }
+    REG_EEARH = HIGH_BYTE(addr);
+    REG_EEARL = LOW_BYTE(addr);
+    REG_EEDR = data;
+    
+    /*
+     * Write sequence (per datasheet):
+     * 1. Set EEMPE (Master Program Enable)
+     * 2. Within 4 cycles, set EEPE (Program Enable)
+     */
+    BIT_SET(REG_EECR, EECR_EEMPE);
+    BIT_SET(REG_EECR, EECR_EEPE);
+}
+
+/* Pop the oldest queued write and start it. Interrupts must be disabled. */
+static inline void eeprom_start_next(void)
+{
+    uint8_t tail = g_ee_tail;
+    
+    eeprom_program(g_ee_queue[tail].addr, g_ee_queue[tail].data);
+    g_ee_tail = (uint8_t)((tail + 1) & EEPROM_QUEUE_MASK);
 }
 
+/*
+ * EE_READY is level-triggered: it fires whenever EERIE is set and EEPE is
+ * clear, so each completed byte immediately starts the next one.
+ */
+ISR(EE_READY_vect)
+{
+    PROBE_ISR_BEGIN(PROBE_EEPROM_ISR);
+    
+    if (g_ee_tail == g_ee_head) {
+        BIT_CLR(REG_EECR, EECR_EERIE);
+    } else {
+        eeprom_start_next();
+    }
+    
+    PROBE_ISR_END(PROBE_EEPROM_ISR);
+}
 
-uint8_t eeprom_read_byte(uint16_t addr)
+/* Queue slot for a write, or 0 if full. Interrupts must be disabled. */
+static inline uint8_t eeprom_push(uint16_t addr, uint8_t data)
 {
-    /* Wait for any previous write to complete */
-    eeprom_wait_ready();
+    uint8_t head = g_ee_head;
+    uint8_t next = (uint8_t)((head + 1) & EEPROM_QUEUE_MASK);
     
-    /* Set address registers */
-    REG_EEARH = HIGH_BYTE(addr);
-    REG_EEARL = LOW_BYTE(addr);
+    if (next == g_ee_tail) {
+        return 0;
+    }
     
-    /* Start read by setting EERE (EEPROM Read Enable) */
-    BIT_SET(REG_EECR, EECR_EERE);
+    g_ee_queue[head].addr = addr;
+    g_ee_queue[head].data = data;
+    g_ee_head = next;
     
-    /* Return data from EEPROM data register */
-    return REG_EEDR;
+    BIT_SET(REG_EECR, EECR_EERIE);
+    return 1;
 }
 
-void eeprom_write_byte(uint16_t addr, uint8_t data)
+/*
+ * Service the queue without the ISR (interrupts globally off): wait for
+ * the current write, then start the next one. Caller ensures not empty.
+ */
+static void eeprom_poll(void)
 {
-    /* Wait for any previous write */
-    eeprom_wait_ready();
+    while (BIT_GET(REG_EECR, EECR_EEPE)) {
+        /* Spin */
+    }
     
-    /* Set address */
-    REG_EEARH = HIGH_BYTE(addr);
-    REG_EEARL = LOW_BYTE(addr);
+    eeprom_start_next();
+}
+
+/* ============================================================================
+ * QUEUE API
+ * ============================================================================ */
+
+uint8_t eeprom_queue_byte(uint16_t addr, uint8_t data)
+{
+    uint8_t ok;
     
-    /* Set data */
-    REG_EEDR = data;
+    CRITICAL_SECTION_BEGIN;
+    ok = eeprom_push(addr, data);
+    CRITICAL_SECTION_END;
+    
+    return ok;
+}
+
+uint8_t eeprom_queue_block(uint16_t addr, const void *src, uint16_t len)
+{
+    const uint8_t *p = (const uint8_t *)src;
+    uint8_t ok = 0;
     
-    /* Disable interrupts during timed write sequence */
     CRITICAL_SECTION_BEGIN;
     
-// ...existing code...
-    /*
-     * Write sequence (per datasheet):
-     * 1. Set EEMPE (Master Program Enable)
-     * 2. Within 4 cycles, set EEPE (Program Enable)
-     */
-    BIT_SET(REG_EECR, EECR_EEMPE);
-    BIT_SET(REG_EECR, EECR_EEPE);
+    /* All or nothing: never leave half a record in the queue */
+    if (len <= (uint16_t)(EEPROM_QUEUE_SIZE - 1 - eeprom_pending())) {
+        while (len--) {
+            eeprom_push(addr++, *p++);
+        }
+        ok = 1;
+    }
     
     CRITICAL_SECTION_END;
+    
+    return ok;
+}
+
+uint8_t eeprom_pending(void)
+{
+    return (uint8_t)((g_ee_head - g_ee_tail) & EEPROM_QUEUE_MASK);
+}
+
+uint8_t eeprom_busy(void)
+{
+    return (g_ee_head != g_ee_tail) || BIT_GET(REG_EECR, EECR_EEPE);
+}
+
+void eeprom_flush(void)
+{
+    while (g_ee_head != g_ee_tail) {
+        if (!BIT_GET(REG_SREG, SREG_I)) {
+            eeprom_poll();
+        }
+    }
+    
+    while (BIT_GET(REG_EECR, EECR_EEPE)) {
+        /* Spin */
+    }
+}
+
+/* ============================================================================
+ * BYTE OPERATIONS
+ * ============================================================================ */
+
+uint8_t eeprom_read_byte(uint16_t addr)
+{
+    uint8_t data;
+    
+    for (;;) {
+        CRITICAL_SECTION_BEGIN;
+        
+        /* Newest queued write to this address wins */
+        uint8_t i = g_ee_head;
+        while (i != g_ee_tail) {
+            i = (uint8_t)((i - 1) & EEPROM_QUEUE_MASK);
+            if (g_ee_queue[i].addr == addr) {
+                data = g_ee_queue[i].data;
+                CRITICAL_SECTION_END;
+                return data;
+            }
+        }
+        
+        /* EEAR must not change while a write is in progress */
+        if (!BIT_GET(REG_EECR, EECR_EEPE)) {
+            REG_EEARH = HIGH_BYTE(addr);
+            REG_EEARL = LOW_BYTE(addr);
+            
+            /* Start read by setting EERE (EEPROM Read Enable) */
+            BIT_SET(REG_EECR, EECR_EERE);
+            data = REG_EEDR;
+            
+            CRITICAL_SECTION_END;
+            return data;
+        }
+        
+        CRITICAL_SECTION_END;
+    }
+}
+
+void eeprom_write_byte(uint16_t addr, uint8_t data)
+{
+    /* Queue the write; only wait if the queue is full */
+    while (!eeprom_queue_byte(addr, data)) {
+        if (!BIT_GET(REG_SREG, SREG_I)) {
+            eeprom_poll();
+        }
+    }
 }
 
 /* ============================================================================
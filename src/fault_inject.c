@@ -1,13 +1,72 @@
 
 #include "fault_inject.h"
 #include "timer.h"
+#include "probe.h"
 #include "config.h"
 #include "atmega328p.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
 
+/* Any nonzero xorshift32 state */
+#define FAULT_PRNG_SEED         0x2545F491UL
+
+/* ln(2) in Q4.12 */
+#define FAULT_LN2_Q12           2839U
+
+/* Timer2 compare value for the storm period (CTC at clk/8) */
+#define FAULT_STORM_OCR         ((uint8_t)(FAULT_STORM_PERIOD_US * (F_CPU / 8000000UL) - 1U))
+
+#if FAULT_STORM_PERIOD_US < 1 || FAULT_STORM_PERIOD_US > 127
+#error "FAULT_STORM_PERIOD_US must be 1-127"
+#endif
+
 /* Pointer to victim's critical data */
 static volatile uint32_t *g_victim_ptr = (volatile uint32_t *)0;
 
+/* Read by the fault ISR */
+static volatile uint8_t g_fault_mode = FAULT_MODE_DEFAULT;
+static volatile uint8_t g_fault_arrival = FAULT_ARRIVAL_DEFAULT;
+
+static uint32_t g_fault_prng = FAULT_PRNG_SEED;
+
+/* Stuck-at state (see fault_stuck_hold) */
+volatile uint32_t *volatile g_fault_stuck_ptr = (volatile uint32_t *)0;
+volatile uint32_t g_fault_stuck_clr = 0;
+volatile uint32_t g_fault_stuck_set = 0;
+
+/* XOR masks for the interrupted context, applied by TIMER1_COMPB */
+static volatile uint8_t g_fault_ctx_sreg = 0;
+static volatile uint8_t g_fault_ctx_ret_hi = 0;
+static volatile uint8_t g_fault_ctx_ret_lo = 0;
+
+/* Storm interrupts still to come */
+static volatile uint16_t g_fault_storm_left = 0;
+
+/* -ln((64 + i + 0.5) / 128) in Q4.12: the mantissa part of -ln(u) */
+static const uint16_t fault_neg_ln[64] PROGMEM = {
+     2807,  2744,  2682,  2621,  2561,  2501,  2443,  2385,
+     2328,  2272,  2217,  2162,  2108,  2055,  2003,  1951,
+     1900,  1849,  1799,  1750,  1701,  1653,  1605,  1558,
+     1512,  1466,  1420,  1375,  1330,  1286,  1243,  1200,
+     1157,  1115,  1073,  1032,   991,   950,   910,   870,
+      831,   792,   753,   715,   677,   639,   602,   565,
+      529,   492,   457,   421,   386,   351,   316,   281,
+      247,   213,   180,   147,   114,    81,    48,    16
+};
+
+/* Single-byte registers only: a lone write to half of a 16-bit one lands in TEMP */
+static const uint8_t fault_periph_regs[8] PROGMEM = {
+    0xC4,                       /* UBRR0L */
+    0xC5,                       /* UBRR0H */
+    0xC1,                       /* UCSR0B */
+    0x47,                       /* OCR0A */
+    0x45,                       /* TCCR0B */
+    0x6E,                       /* TIMSK0 */
+    0x81,                       /* TCCR1B */
+    0x6F                        /* TIMSK1 */
+};
+
 
 volatile uint32_t* fault_get_victim_ptr(void)
 {
@@ -19,6 +78,113 @@ void fault_set_victim_ptr(volatile uint32_t *ptr)
     g_victim_ptr = ptr;
 }
 
+void fault_set_mode(uint8_t mode)
+{
+    if (mode >= FAULT_MODE_COUNT || mode == g_fault_mode) {
+        return;
+    }
+    
+    /* A new model releases the stuck bits of the last one */
+    CRITICAL_SECTION_BEGIN;
+    g_fault_mode = mode;
+    g_fault_stuck_ptr = (volatile uint32_t *)0;
+    g_fault_stuck_clr = 0;
+    g_fault_stuck_set = 0;
+    CRITICAL_SECTION_END;
+}
+
+uint8_t fault_get_mode(void)
+{
+    return g_fault_mode;
+}
+
+void fault_set_arrival(uint8_t arrival)
+{
+    if (arrival < FAULT_ARRIVAL_COUNT) {
+        g_fault_arrival = arrival;
+    }
+}
+
+uint8_t fault_get_arrival(void)
+{
+    return g_fault_arrival;
+}
+
+/* ============================================================================
+ * ARRIVAL PROCESS
+ * ============================================================================ */
+
+void fault_seed(uint32_t seed)
+{
+    CRITICAL_SECTION_BEGIN;
+    g_fault_prng = seed ? seed : FAULT_PRNG_SEED;
+    CRITICAL_SECTION_END;
+}
+
+uint32_t fault_random(void)
+{
+    /* Marsaglia xorshift32: shifts and XORs only, period 2^32 - 1 */
+    uint32_t x = g_fault_prng;
+    
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_fault_prng = x;
+    
+    return x;
+}
+
+/*
+ * -ln(u / 65536) in Q4.12 for u = 1..65535. Normalising u to [0.5, 1)
+ * takes at most 15 shifts (each adds ln 2); the rest is a table read.
+ * Worst-case error is about 0.008, against a mean of 1.
+ */
+static uint16_t fault_neg_ln_q12(uint16_t u)
+{
+    uint16_t q = 0;
+    
+    while (!(u & 0x8000U)) {
+        u <<= 1;
+        q += FAULT_LN2_Q12;
+    }
+    
+    return (uint16_t)(q + pgm_read_word(&fault_neg_ln[(u >> 9) & 63U]));
+}
+
+uint32_t fault_arrival_gap(uint32_t mean_ticks)
+{
+    /* Mean in 64-tick units: below 2^16 for 255 s, so 16x16 multiplies */
+    uint16_t mean64 = (uint16_t)(mean_ticks >> 6);
+    uint16_t r;
+    uint32_t gap;
+    
+    switch (g_fault_arrival) {
+    case FAULT_ARRIVAL_UNIFORM:
+        r = (uint16_t)fault_random();
+        gap = ((uint32_t)mean64 * r) >> 9;
+        break;
+        
+    case FAULT_ARRIVAL_EXPONENTIAL:
+        r = (uint16_t)fault_random();
+        gap = ((uint32_t)mean64 * fault_neg_ln_q12(r ? r : 1U)) >> 6;
+        break;
+        
+    default:
+        gap = mean_ticks;
+        break;
+    }
+    
+    return (gap < FAULT_GAP_MIN_TICKS) ? FAULT_GAP_MIN_TICKS : gap;
+}
+
+/* ============================================================================
+ * FAULT MODELS
+ * ============================================================================ */
+
+static void attack_none(void)
+{
+    /* No attack - safe mode */
+}
 
 static void attack_bitflip(void)
 {
@@ -82,36 +248,233 @@ static void attack_hang(void)
      * When this runs:
      *   1. Main loop stops executing
      *   2. Heartbeat stops printing
-     *   3. wdt_kick() is never called
-     *   4. After WDT timeout (2s), hardware forces reset
+     *   3. supervisor_poll() never kicks the watchdog again
+     *   4. After the WDT timeout (tens of ms), hardware forces reset
      *   5. System reboots and recovers!
      * 
      * Without WDT: System would be permanently frozen
      * With WDT: System automatically recovers
      */
+#if WDT_CRASH_CAPTURE
+    /*
+     * Hang with interrupts on (a stuck task rather than a stuck ISR) so the
+     * watchdog interrupt can capture where we are. With interrupts off the
+     * capture is skipped and the reset only comes on the second timeout.
+     */
+    INTERRUPTS_ENABLE();
+#endif
     for (;;) {
         /* Trapped forever... unless WDT saves us */
         NOP();
     }
 }
 
+/* Multi-bit upset: 2-4 adjacent bits of one victim byte */
+static void attack_multibit(void)
+{
+    volatile uint8_t *byte_ptr = (volatile uint8_t *)g_victim_ptr;
+    uint32_t r = fault_random();
+    uint8_t width;
+    uint8_t shift;
+    uint8_t mask;
+    
+    if (byte_ptr == (volatile uint8_t *)0) {
+        return;
+    }
+    
+    width = (uint8_t)(2U + (((uint8_t)r * 3U) >> 8));
+    shift = (uint8_t)(r >> 8) & 7U;
+    mask = (uint8_t)((1U << width) - 1U);
+    
+    /* Rotate within the byte so the run may wrap from bit 7 to bit 0 */
+    mask = (uint8_t)((mask << shift) | (mask >> (8U - shift)));
+    byte_ptr[(uint8_t)(r >> 16) & 3U] ^= mask;
+}
+
+static void attack_stuck(uint8_t level)
+{
+    uint32_t bit;
+    
+    if (g_victim_ptr == (volatile uint32_t *)0) {
+        return;
+    }
+    
+    bit = (uint32_t)1 << ((uint8_t)fault_random() & 31U);
+    
+    if (level) {
+        g_fault_stuck_set |= bit;
+        g_fault_stuck_clr &= ~bit;
+    } else {
+        g_fault_stuck_clr |= bit;
+        g_fault_stuck_set &= ~bit;
+    }
+    
+    g_fault_stuck_ptr = g_victim_ptr;
+    fault_stuck_hold();
+}
+
+static void attack_stuck0(void)
+{
+    attack_stuck(0);
+}
+
+static void attack_stuck1(void)
+{
+    attack_stuck(1);
+}
+
+/*
+ * The interrupted context sits under this ISR's frame at an offset that
+ * depends on the compiler's register saves. Instead, fire TIMER1_COMPB
+ * (a naked handler) two Timer1 ticks after this one: it sees the context
+ * it interrupts exactly.
+ */
+static void fault_context_arm(uint8_t sreg_mask, uint16_t ret_mask)
+{
+    g_fault_ctx_sreg = sreg_mask;
+    g_fault_ctx_ret_hi = HIGH_BYTE(ret_mask);
+    g_fault_ctx_ret_lo = LOW_BYTE(ret_mask);
+    
+    REG_OCR1B = (uint16_t)(REG_TCNT1 + 2U);
+    REG_TIFR1 = BIT(TIFR1_OCF1B);               /* Writing 1 clears it */
+    BIT_SET(REG_TIMSK1, TIMSK1_OCIE1B);
+}
+
+/* Return-address corruption: one bit of the 14-bit word address */
+static void attack_retaddr(void)
+{
+    uint8_t bit = (uint8_t)(((uint8_t)fault_random() * 14U) >> 8);
+    
+    fault_context_arm(0, (uint16_t)BIT(bit));
+}
+
+/* Status-flag corruption: one of C..T (reti sets I regardless) */
+static void attack_sreg(void)
+{
+    uint8_t bit = (uint8_t)(((uint8_t)fault_random() * 7U) >> 8);
+    
+    fault_context_arm((uint8_t)BIT(bit), 0);
+}
+
+/* Peripheral corruption: one bit of a timer or USART setup register */
+static void attack_periph(void)
+{
+    uint16_t r = (uint16_t)fault_random();
+    uint8_t addr = pgm_read_byte(&fault_periph_regs[r & 7U]);
+    
+    MMIO8(addr) ^= (uint8_t)BIT((r >> 8) & 7U);
+}
+
+/* Interrupt storm: Timer2 fires every FAULT_STORM_PERIOD_US, LENGTH times */
+static void attack_storm(void)
+{
+    g_fault_storm_left = FAULT_STORM_LENGTH;
+    
+    REG_TCCR2B = 0;
+    REG_TCCR2A = BIT(TCCR2A_WGM21);
+    REG_TCNT2 = 0;
+    REG_OCR2A = FAULT_STORM_OCR;
+    REG_TIFR2 = BIT(TIFR2_OCF2A);
+    REG_TIMSK2 = BIT(TIMSK2_OCIE2A);
+    REG_TCCR2B = BIT(TCCR2B_CS21);              /* clk/8 */
+}
+
 /* ============================================================================
  * FAULT EXECUTION (called from ISR)
  * ============================================================================ */
 
+typedef void (*fault_model_fn)(void);
+
+/* Indexed by fault_mode_t: a new model is one enum value and one entry */
+static const fault_model_fn fault_models[FAULT_MODE_COUNT] PROGMEM = {
+    attack_none,
+    attack_bitflip,
+    attack_pc_reset,
+    attack_hang,
+    attack_multibit,
+    attack_stuck0,
+    attack_stuck1,
+    attack_retaddr,
+    attack_sreg,
+    attack_periph,
+    attack_storm
+};
+
 void fault_inject_execute(void)
 {
-#if defined(ATTACK_MODE_A)
-    attack_bitflip();
+    fault_model_fn model = (fault_model_fn)pgm_read_ptr(&fault_models[g_fault_mode]);
     
-#elif defined(ATTACK_MODE_B)
-    attack_pc_reset();
-    
-#elif defined(ATTACK_MODE_C)
-    attack_hang();
+    model();
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+    if (--g_fault_storm_left == 0) {
+        REG_TCCR2B = 0;
+        REG_TIMSK2 = 0;
+        probe_timer_start();                    /* Hand Timer2 back */
+    }
+}
+
+#ifdef FIRA_HOST
+ISR(TIMER1_COMPB_vect)
+{
+    BIT_CLR(REG_TIMSK1, TIMSK1_OCIE1B);
     
+    /*
+     * No AVR call stack on the host and the flags are the host CPU's:
+     * a corrupted return address becomes a wild jump, and only the
+     * simulated SREG copy changes.
+     */
+    REG_SREG ^= g_fault_ctx_sreg;
+    if (g_fault_ctx_ret_hi | g_fault_ctx_ret_lo) {
+        attack_pc_reset();
+    }
+}
 #else
-    /* No attack - safe mode */
-    (void)0;
-#endif
+ISR(TIMER1_COMPB_vect, ISR_NAKED)
+{
+    /*
+     * Entered with the interrupted context untouched: its SREG is live
+     * (minus I) and its return address is on top of the stack. Apply the
+     * masks, disarm, and return into the corrupted context. After the
+     * five pushes: SP+1 r31, +2 r30, +3 new SREG, +4 r25, +5 r24,
+     * +6 PC high, +7 PC low.
+     */
+    __asm__ __volatile__ (
+        "push r24"                  "\n\t"
+        "in   r24, __SREG__"        "\n\t"
+        "push r25"                  "\n\t"
+        "lds  r25, %[sreg]"         "\n\t"
+        "eor  r24, r25"             "\n\t"
+        "push r24"                  "\n\t"
+        "push r30"                  "\n\t"
+        "push r31"                  "\n\t"
+        "in   r30, __SP_L__"        "\n\t"
+        "in   r31, __SP_H__"        "\n\t"
+        "ldd  r24, Z+6"             "\n\t"
+        "lds  r25, %[ret_hi]"       "\n\t"
+        "eor  r24, r25"             "\n\t"
+        "std  Z+6, r24"             "\n\t"
+        "ldd  r24, Z+7"             "\n\t"
+        "lds  r25, %[ret_lo]"       "\n\t"
+        "eor  r24, r25"             "\n\t"
+        "std  Z+7, r24"             "\n\t"
+        "lds  r24, %[timsk]"        "\n\t"
+        "andi r24, %[keep]"         "\n\t"
+        "sts  %[timsk], r24"        "\n\t"
+        "pop  r31"                  "\n\t"
+        "pop  r30"                  "\n\t"
+        "pop  r24"                  "\n\t"
+        "out  __SREG__, r24"        "\n\t"
+        "pop  r25"                  "\n\t"
+        "pop  r24"                  "\n\t"
+        "reti"                      "\n\t"
+        :: [sreg] "i" (&g_fault_ctx_sreg),
+           [ret_hi] "i" (&g_fault_ctx_ret_hi),
+           [ret_lo] "i" (&g_fault_ctx_ret_lo),
+           [timsk] "n" (0x6F),
+           [keep] "M" ((uint8_t)~BIT(TIMSK1_OCIE1B))
+    );
 }
+#endif
@@ -0,0 +1,124 @@
+
+#include "flashcheck.h"
+#include "crc.h"
+#include "timer.h"
+#include "probe.h"
+#include "atmega328p.h"
+#include <avr/pgmspace.h>
+
+
+/* Bytes read from flash before each CRC update */
+#define FLASHCHECK_BUF          16U
+
+/*
+ * About 50 cycles per byte (lpm plus the nibble-table CRC-32); one call
+ * must stay within an eighth of the shortest watchdog period (16 ms).
+ */
+#define FLASHCHECK_BYTE_CYCLES  60UL
+
+#if FLASHCHECK_CHUNK_BYTES < 1 || FLASHCHECK_CHUNK_BYTES * FLASHCHECK_BYTE_CYCLES > F_CPU / 500UL
+#error "FLASHCHECK_CHUNK_BYTES does not fit the per-loop cycle budget"
+#endif
+
+/* Erased-flash values until fira_flashcrc.py fills them in */
+#define FLASH_IMAGE_UNSET_CRC   0xFFFFFFFFUL
+#define FLASH_IMAGE_UNSET_LEN   0xFFFFU
+
+/* Not static: the post-link step finds it by name */
+const flash_image_t g_flash_image PROGMEM __attribute__((used)) = {
+    FLASH_IMAGE_UNSET_CRC, FLASH_IMAGE_UNSET_LEN
+};
+
+static flashcheck_info_t g_flashcheck;
+
+/* Sweep in progress */
+static uint16_t g_flashcheck_addr = 0;
+static uint32_t g_flashcheck_crc = CRC32_INIT;
+static uint32_t g_flashcheck_start = 0;
+static uint8_t g_flashcheck_event = 0;
+
+
+void flashcheck_init(void)
+{
+    uint16_t length = pgm_read_word(&g_flash_image.length);
+    uint32_t expected = pgm_read_dword(&g_flash_image.crc);
+    
+    g_flashcheck.length = 0;
+    g_flashcheck.sweeps = 0;
+    g_flashcheck.bad = 0;
+    g_flashcheck.period_ms = 0;
+    
+    if (length == FLASH_IMAGE_UNSET_LEN && expected == FLASH_IMAGE_UNSET_CRC) {
+        return;
+    }
+    
+    g_flashcheck.length = length;
+    g_flashcheck.expected = expected;
+    g_flashcheck_addr = 0;
+    g_flashcheck_crc = CRC32_INIT;
+    g_flashcheck_start = systick_get_ms();
+}
+
+static void flashcheck_finish(void)
+{
+    uint32_t now = systick_get_ms();
+    
+    if (crc32_final(g_flashcheck_crc) != g_flashcheck.expected) {
+        if (g_flashcheck.bad != 0xFFFF) {
+            g_flashcheck.bad++;
+        }
+        g_flashcheck_event = 1;
+    }
+    if (g_flashcheck.sweeps != 0xFFFF) {
+        g_flashcheck.sweeps++;
+    }
+    g_flashcheck.period_ms = now - g_flashcheck_start;
+    
+    g_flashcheck_addr = 0;
+    g_flashcheck_crc = CRC32_INIT;
+    g_flashcheck_start = now;
+}
+
+void flashcheck_poll(void)
+{
+    uint16_t slot = (uint16_t)(uintptr_t)&g_flash_image;
+    uint16_t left = FLASHCHECK_CHUNK_BYTES;
+    uint8_t buf[FLASHCHECK_BUF];
+    
+    if (g_flashcheck.length == 0) {
+        return;
+    }
+    
+    PROBE_BEGIN(PROBE_FLASHCHECK);
+    while (left != 0 && g_flashcheck_addr < g_flashcheck.length) {
+        uint8_t n = 0;
+        
+        while (n < FLASHCHECK_BUF && left != 0 && g_flashcheck_addr < g_flashcheck.length) {
+            /* The slot holds the result, so it is not part of it */
+            if ((uint16_t)(g_flashcheck_addr - slot) >= sizeof(flash_image_t)) {
+                buf[n++] = pgm_read_byte((const uint8_t *)(uintptr_t)g_flashcheck_addr);
+            }
+            g_flashcheck_addr++;
+            left--;
+        }
+        g_flashcheck_crc = crc32_nibble(g_flashcheck_crc, buf, n);
+    }
+    
+    if (g_flashcheck_addr >= g_flashcheck.length) {
+        flashcheck_finish();
+    }
+    PROBE_END(PROBE_FLASHCHECK);
+}
+
+uint8_t flashcheck_take_event(void)
+{
+    uint8_t event = g_flashcheck_event;
+    
+    g_flashcheck_event = 0;
+    return event;
+}
+
+void flashcheck_get_info(flashcheck_info_t *info)
+{
+    *info = g_flashcheck;
+}
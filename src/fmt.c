@@ -0,0 +1,189 @@
+
+#include "fmt.h"
+#include <avr/pgmspace.h>
+
+
+/* Powers of ten used by the subtraction loops (largest first) */
+static const uint32_t fmt_pow10_u32[] PROGMEM = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL
+};
+
+static const uint16_t fmt_pow10_u16[] PROGMEM = {
+    10000U, 1000U, 100U, 10U
+};
+
+
+/* ============================================================================
+ * DECIMAL
+ * ============================================================================ */
+
+uint8_t fmt_u8(char *buf, uint8_t num)
+{
+    char *p = buf;
+    char d;
+    
+    if (num >= 100) {
+        d = '0';
+        while (num >= 100) { num -= 100; d++; }
+        *p++ = d;
+        d = '0';
+        while (num >= 10) { num -= 10; d++; }
+        *p++ = d;
+    } else if (num >= 10) {
+        d = '0';
+        while (num >= 10) { num -= 10; d++; }
+        *p++ = d;
+    }
+    
+    *p++ = (char)('0' + num);
+    *p = '\0';
+    
+    return (uint8_t)(p - buf);
+}
+
+uint8_t fmt_u16(char *buf, uint16_t num)
+{
+    char *p = buf;
+    uint8_t started = 0;
+    uint8_t i;
+    
+    if (num < 256) {
+        return fmt_u8(buf, (uint8_t)num);
+    }
+    
+    for (i = 0; i < sizeof(fmt_pow10_u16) / sizeof(fmt_pow10_u16[0]); i++) {
+        uint16_t pow = pgm_read_word(&fmt_pow10_u16[i]);
+        char d = '0';
+        
+        while (num >= pow) {
+            num -= pow;
+            d++;
+        }
+        
+        if (started || d != '0') {
+            *p++ = d;
+            started = 1;
+        }
+    }
+    
+    *p++ = (char)('0' + num);
+    *p = '\0';
+    
+    return (uint8_t)(p - buf);
+}
+
+uint8_t fmt_u32(char *buf, uint32_t num)
+{
+    char *p = buf;
+    uint8_t started = 0;
+    uint8_t i;
+    
+    if (num <= 0xFFFFUL) {
+        return fmt_u16(buf, (uint16_t)num);
+    }
+    
+    /* Peel off the digits above 10^4 with 32-bit subtractions */
+    for (i = 0; i < sizeof(fmt_pow10_u32) / sizeof(fmt_pow10_u32[0]); i++) {
+        uint32_t pow = pgm_read_dword(&fmt_pow10_u32[i]);
+        char d = '0';
+        
+        while (num >= pow) {
+            num -= pow;
+            d++;
+        }
+        
+        if (started || d != '0') {
+            *p++ = d;
+            started = 1;
+        }
+    }
+    
+    /* Remainder is < 10000: finish with 16-bit arithmetic, zero-padded */
+    {
+        uint16_t low = (uint16_t)num;
+        
+        for (i = 1; i < sizeof(fmt_pow10_u16) / sizeof(fmt_pow10_u16[0]); i++) {
+            uint16_t pow = pgm_read_word(&fmt_pow10_u16[i]);
+            char d = '0';
+            
+            while (low >= pow) {
+                low -= pow;
+                d++;
+            }
+            *p++ = d;
+        }
+        
+        *p++ = (char)('0' + low);
+    }
+    
+    *p = '\0';
+    
+    return (uint8_t)(p - buf);
+}
+
+uint8_t fmt_i32(char *buf, int32_t num)
+{
+    if (num < 0) {
+        buf[0] = '-';
+        /* Negate in unsigned arithmetic so INT32_MIN is well defined */
+        return (uint8_t)(1 + fmt_u32(buf + 1, 0UL - (uint32_t)num));
+    }
+    
+    return fmt_u32(buf, (uint32_t)num);
+}
+
+uint8_t fmt_u32_pad(char *buf, uint32_t num, uint8_t width, char pad)
+{
+    char tmp[FMT_U32_LEN];
+    uint8_t len = fmt_u32(tmp, num);
+    uint8_t i = 0;
+    uint8_t j;
+    
+    if (width > FMT_U32_LEN - 1) {
+        width = FMT_U32_LEN - 1;
+    }
+    
+    while ((uint8_t)(i + len) < width) {
+        buf[i++] = pad;
+    }
+    
+    for (j = 0; j <= len; j++) {
+        buf[i + j] = tmp[j];
+    }
+    
+    return (uint8_t)(i + len);
+}
+
+/* ============================================================================
+ * HEXADECIMAL
+ * ============================================================================ */
+
+static inline char fmt_nibble(uint8_t n)
+{
+    return (char)((n < 10) ? ('0' + n) : ('A' - 10 + n));
+}
+
+uint8_t fmt_hex8(char *buf, uint8_t num)
+{
+    buf[0] = fmt_nibble(num >> 4);
+    buf[1] = fmt_nibble(num & 0x0F);
+    buf[2] = '\0';
+    
+    return 2;
+}
+
+uint8_t fmt_hex16(char *buf, uint16_t num)
+{
+    fmt_hex8(buf, (uint8_t)(num >> 8));
+    fmt_hex8(buf + 2, (uint8_t)num);
+    
+    return 4;
+}
+
+uint8_t fmt_hex32(char *buf, uint32_t num)
+{
+    fmt_hex16(buf, (uint16_t)(num >> 16));
+    fmt_hex16(buf + 4, (uint16_t)num);
+    
+    return 8;
+}
@@ -6,12 +6,53 @@
 #include "eeprom_drv.h"
 #include "fault_inject.h"
 #include "stats.h"
+#include "telemetry.h"
+#include "bench.h"
+#include "probe.h"
+#include "supervisor.h"
+#include "settings.h"
+#include "cmd.h"
+#include "protect.h"
+#include "scrub.h"
+#include "flashcheck.h"
+#include "stack.h"
+#include "sched.h"
+#include "power.h"
 #include <avr/pgmspace.h>
 
-static volatile uint32_t g_critical_counter = 0;
+/* Last-task markers reported in watchdog crash records; also supervisor ids */
+enum {
+    TASK_IDLE       = 0,
+    TASK_HEARTBEAT  = 1,
+    TASK_SUMMARY    = 2,
+    TASK_CHECKPOINT = 3,
+    TASK_COMMAND    = 4,
+    TASK_SCRUB      = 5,
+    TASK_FLASHCHECK = 6,
+    TASK_SUPERVISOR = 7,
+    TASK_REPORT     = 8         /* Marker only, not supervised */
+};
+
+/* Scheduler priorities: lower runs first when several tasks are ready */
+enum {
+    PRIO_SUPERVISOR = 0,
+    PRIO_HEARTBEAT  = 1,
+    PRIO_COMMAND    = 2,
+    PRIO_CHECKPOINT = 3,
+    PRIO_SCRUB      = 4,
+    PRIO_FLASHCHECK = 5,
+    PRIO_SUMMARY    = 6,
+    PRIO_REPORT     = 7
+};
+
+/* Fault models A, D, E and F hit the first copy; the vote repairs it */
+static volatile tmr32_t g_critical_counter;
 static uint32_t g_last_valid_counter = 0;
-static uint32_t g_heartbeat_tick = 0;
-static uint32_t g_summary_tick = 0;
+static uint16_t g_last_corrected = 0;
+
+/* Crash record left by the watchdog interrupt before the last reset */
+static wdt_crash_record_t g_last_gasp;
+static uint8_t g_have_last_gasp = 0;
 
 static const char str_banner1[] PROGMEM = "============================================================";
 static const char str_banner2[] PROGMEM = "    FIRA - Fault Injection & Recovery Analysis";
@@ -34,18 +75,46 @@ static const char str_reboot_msg[] PROGMEM = "I crashed but the Watchdog brought
 
 static const char str_crash_box1[] PROGMEM = "+------------------------------------------+";
 static const char str_crash_msg[] PROGMEM = "| Oops! I crashed. Total crashes so far: ";
+static const char str_gasp_pc[] PROGMEM = "| Last gasp: PC=";
+static const char str_gasp_sp[] PROGMEM = " SP=";
+static const char str_gasp_sreg[] PROGMEM = " SREG=0x";
+static const char str_gasp_tick[] PROGMEM = "|   at ";
+static const char str_gasp_faults[] PROGMEM = "ms, attacks ";
+static const char str_gasp_task[] PROGMEM = ", task ";
+static const char str_gasp_stalled[] PROGMEM = ", stalled 0x";
+static const char str_gasp_hang[] PROGMEM = "|   cause: hang (watchdog)";
+static const char str_gasp_stack[] PROGMEM = "|   cause: STACK OVERFLOW (guard hit)";
 
 static const char str_eeprom_crash[] PROGMEM = "Times I've crashed: ";
 static const char str_eeprom_uptime[] PROGMEM = "Total time running: ";
+static const char str_eeprom_downtime[] PROGMEM = "Total time down: ";
+static const char str_journal_slot[] PROGMEM = "Stats journal: slot ";
+static const char str_journal_seq[] PROGMEM = ", seq ";
+static const char str_journal_wear[] PROGMEM = ", ~writes/cell ";
+static const char str_journal_bad[] PROGMEM = ", bad ";
+static const char str_journal_scan[] PROGMEM = ", scan ";
+static const char str_cycles[] PROGMEM = " cycles";
 
 static const char str_config[] PROGMEM = "Attack mode: ";
 static const char str_mode_a[] PROGMEM = "A - Flipping random bits (data corruption)";
 static const char str_mode_b[] PROGMEM = "B - Resetting program counter (code jump)";
 static const char str_mode_c[] PROGMEM = "C - Infinite loop (testing watchdog rescue)";
+static const char str_mode_d[] PROGMEM = "D - Flipping 2-4 adjacent bits (multi-bit upset)";
+static const char str_mode_e[] PROGMEM = "E - Bits stuck at 0";
+static const char str_mode_f[] PROGMEM = "F - Bits stuck at 1";
+static const char str_mode_g[] PROGMEM = "G - Corrupting a return address";
+static const char str_mode_h[] PROGMEM = "H - Corrupting status flags (SREG)";
+static const char str_mode_i[] PROGMEM = "I - Corrupting peripheral registers";
+static const char str_mode_j[] PROGMEM = "J - Interrupt storm";
 static const char str_mode_safe[] PROGMEM = "Safe mode (no attacks)";
+static const char str_arrival_cfg[] PROGMEM = "Fault arrivals: ";
+static const char str_arrival_p[] PROGMEM = "periodic";
+static const char str_arrival_u[] PROGMEM = "uniform (mean = interval)";
+static const char str_arrival_e[] PROGMEM = "Poisson (mean = interval)";
 static const char str_heartbeat_cfg[] PROGMEM = "Heartbeat every: ";
 static const char str_fault_cfg[] PROGMEM = "Injecting faults every: ";
-static const char str_wdt_cfg[] PROGMEM = "Watchdog timeout: 2s";
+static const char str_disarmed[] PROGMEM = " (disarmed)";
+static const char str_wdt_cfg[] PROGMEM = "Watchdog timeout: ";
 
 static const char str_init_systick[] PROGMEM = "Starting my internal clock...";
 static const char str_init_fault[] PROGMEM = "Arming the fault injector (the saboteur)...";
@@ -54,9 +123,14 @@ static const char str_entering[] PROGMEM = "Alright, here we go! Starting the ma
 
 static const char str_running[] PROGMEM = "Counter: ";
 static const char str_bitflip[] PROGMEM = " << CORRUPTION DETECTED! Jumped by ";
+static const char str_repaired[] PROGMEM = " << Upset DETECTED and voted out, total ";
+static const char str_scrubbed[] PROGMEM = " << RAM scrub DETECTED upset, regions 0x";
+static const char str_flash_bad[] PROGMEM = " << FLASH CRC mismatch DETECTED";
 static const char str_uptime[] PROGMEM = " | Running: ";
 static const char str_faults[] PROGMEM = "s | Attacks: ";
 static const char str_close[] PROGMEM = " |";
+static const char str_recovered[] PROGMEM = ">>> Back up after ";
+static const char str_recovered_end[] PROGMEM = "ms of downtime";
 static const char str_ms[] PROGMEM = "ms";
 static const char str_sec[] PROGMEM = "s";
 
@@ -66,7 +140,40 @@ static const char str_counter[] PROGMEM = "| Counter value: ";
 static const char str_fault_cnt[] PROGMEM = "| Faults injected: ";
 static const char str_crash_cnt[] PROGMEM = "| Total crashes: ";
 static const char str_avail[] PROGMEM = "| System uptime: ";
-static const char str_percent[] PROGMEM = "%";
+static const char str_percent[] PROGMEM = "% (";
+static const char str_nines[] PROGMEM = " nines)";
+static const char str_downtime[] PROGMEM = "| Total downtime: ";
+static const char str_uart_drops[] PROGMEM = "| UART drops: ";
+static const char str_upsets[] PROGMEM = "| Upsets fixed/detected: ";
+static const char str_slash[] PROGMEM = " / ";
+static const char str_scrub_region[] PROGMEM = "| Scrub region ";
+static const char str_scrub_worst[] PROGMEM = ": worst ";
+static const char str_scrub_fixed[] PROGMEM = "ms, fixed ";
+static const char str_scrub_lost[] PROGMEM = ", lost ";
+static const char str_flash[] PROGMEM = "| Flash CRC: ";
+static const char str_flash_none[] PROGMEM = "not embedded";
+static const char str_flash_sweeps[] PROGMEM = " sweeps, period ";
+static const char str_flash_bad_cnt[] PROGMEM = "ms, bad ";
+static const char str_stack[] PROGMEM = "| Stack: peak ";
+static const char str_stack_of[] PROGMEM = " of ";
+static const char str_stack_static[] PROGMEM = " B, static ";
+static const char str_stack_none[] PROGMEM = "| Stack: not tracked";
+static const char str_task[] PROGMEM = "| Task ";
+static const char str_task_every[] PROGMEM = " every ";
+static const char str_task_bg[] PROGMEM = " background";
+static const char str_task_runs[] PROGMEM = ": runs ";
+static const char str_task_miss[] PROGMEM = ", miss ";
+static const char str_task_max[] PROGMEM = ", max ";
+static const char str_task_avg[] PROGMEM = "us, avg ";
+static const char str_sched[] PROGMEM = "| Scheduler: ";
+static const char str_sched_idle[] PROGMEM = " dispatches, ";
+static const char str_sched_cost[] PROGMEM = " passes, cost avg ";
+static const char str_us[] PROGMEM = "us";
+static const char str_jitter[] PROGMEM = "|   start lateness, log2 from 16us:";
+static const char str_load[] PROGMEM = "| CPU load: ";
+static const char str_load_sleeps[] PROGMEM = "% awake, ";
+static const char str_load_asleep[] PROGMEM = " sleeps, ";
+static const char str_load_of[] PROGMEM = "ms asleep of ";
 static const char str_box_end[] PROGMEM = "+-------------------------------+";
 
 static void print_banner(void) {
@@ -116,8 +223,29 @@ static void print_crash_notification(void) {
         uart_puts_P(str_crash_msg);
         uart_put_u16(stats_get_crash_count());
         uart_newline();
+        if (g_have_last_gasp) {
+            uart_puts_P(str_gasp_pc);
+            uart_put_hex16(g_last_gasp.pc);
+            uart_puts_P(str_gasp_sp);
+            uart_put_hex16(g_last_gasp.sp);
+            uart_puts_P(str_gasp_sreg);
+            uart_put_hex8(g_last_gasp.sreg);
+            uart_newline();
+            uart_puts_P(str_gasp_tick);
+            uart_put_u32(g_last_gasp.systick_ms);
+            uart_puts_P(str_gasp_faults);
+            uart_put_u16(g_last_gasp.faults);
+            uart_puts_P(str_gasp_task);
+            uart_put_u8(g_last_gasp.task);
+            uart_puts_P(str_gasp_stalled);
+            uart_put_hex8(g_last_gasp.stalled);
+            uart_newline();
+            uart_puts_P(g_last_gasp.cause == WDT_CAUSE_STACK ? str_gasp_stack : str_gasp_hang);
+            uart_newline();
+        }
         uart_puts_P(str_crash_box1); uart_newline();
         uart_newline();
+        uart_flush();
     }
 }
 
@@ -127,22 +255,69 @@ static void print_eeprom_stats(void) {
     uart_newline();
     
     uart_puts_P(str_eeprom_uptime);
-    uart_put_u32(stats_get_total_uptime() / 1000);
+    uart_put_u32(stats_get_total_uptime());
     uart_puts_P(str_sec);
     uart_newline();
+    
+    uart_puts_P(str_eeprom_downtime);
+    uart_put_u32(stats_get_total_downtime());
+    uart_puts_P(str_ms);
+    uart_newline();
+    
+    const stats_journal_t *journal = stats_get_journal();
+    uart_puts_P(str_journal_slot);
+    uart_put_u8(journal->slot);
+    uart_puts_P(str_journal_seq);
+    uart_put_u32(journal->seq);
+    uart_puts_P(str_journal_wear);
+    uart_put_u32(journal->seq / EEPROM_JOURNAL_SLOTS + 1);
+    uart_puts_P(str_journal_bad);
+    uart_put_u8(journal->bad_slots);
+    uart_puts_P(str_journal_scan);
+    uart_put_u32(journal->scan_cycles);
+    uart_puts_P(str_cycles);
+    uart_newline();
 }
 
 static void print_config(void) {
+    const settings_t *settings = settings_get();
+    
     uart_puts_P(str_config);
-#if defined(ATTACK_MODE_A)
-    uart_puts_P(str_mode_a);
-#elif defined(ATTACK_MODE_B)
-    uart_puts_P(str_mode_b);
-#elif defined(ATTACK_MODE_C)
-    uart_puts_P(str_mode_c);
-#else
-    uart_puts_P(str_mode_safe);
-#endif
+    switch (settings->mode) {
+    case FAULT_MODE_BITFLIP:
+        uart_puts_P(str_mode_a);
+        break;
+    case FAULT_MODE_PC_RESET:
+        uart_puts_P(str_mode_b);
+        break;
+    case FAULT_MODE_HANG:
+        uart_puts_P(str_mode_c);
+        break;
+    case FAULT_MODE_MULTIBIT:
+        uart_puts_P(str_mode_d);
+        break;
+    case FAULT_MODE_STUCK0:
+        uart_puts_P(str_mode_e);
+        break;
+    case FAULT_MODE_STUCK1:
+        uart_puts_P(str_mode_f);
+        break;
+    case FAULT_MODE_RETADDR:
+        uart_puts_P(str_mode_g);
+        break;
+    case FAULT_MODE_SREG:
+        uart_puts_P(str_mode_h);
+        break;
+    case FAULT_MODE_PERIPH:
+        uart_puts_P(str_mode_i);
+        break;
+    case FAULT_MODE_STORM:
+        uart_puts_P(str_mode_j);
+        break;
+    default:
+        uart_puts_P(str_mode_safe);
+        break;
+    }
     uart_newline();
     
     uart_puts_P(str_heartbeat_cfg);
@@ -151,32 +326,91 @@ static void print_config(void) {
     uart_newline();
     
     uart_puts_P(str_fault_cfg);
-    uart_put_u16(FAULT_INJECT_INTERVAL_SEC);
+    uart_put_u8(settings->interval_sec);
     uart_puts_P(str_sec);
+    if (!settings->armed) {
+        uart_puts_P(str_disarmed);
+    }
     uart_newline();
     
-    uart_puts_P(str_wdt_cfg);
+    uart_puts_P(str_arrival_cfg);
+    switch (settings->arrival) {
+    case FAULT_ARRIVAL_UNIFORM:
+        uart_puts_P(str_arrival_u);
+        break;
+    case FAULT_ARRIVAL_EXPONENTIAL:
+        uart_puts_P(str_arrival_e);
+        break;
+    default:
+        uart_puts_P(str_arrival_p);
+        break;
+    }
     uart_newline();
+    
     uart_newline();
 }
 
 static void heartbeat(void) {
-    if (!systick_elapsed(&g_heartbeat_tick, HEARTBEAT_INTERVAL_MS)) {
-        return;
+    int32_t delta = 0;
+    uint32_t downtime;
+    uint32_t counter;
+    uint16_t corrected;
+    uint8_t scrubbed;
+    uint8_t flash_bad;
+    
+    PROBE_BEGIN(PROBE_HEARTBEAT);
+    supervisor_checkin(TASK_HEARTBEAT);
+    downtime = stats_heartbeat();
+    counter = tmr32_read(&g_critical_counter) + 1U;
+    tmr32_write(&g_critical_counter, counter);
+    corrected = protect_get_corrected();
+    scrubbed = scrub_take_events();
+    stack_check();
+    flash_bad = flashcheck_take_event();
+    
+    /* Second line of defence: an upset the vote could not out-vote */
+    if (fault_check_flag()) {
+        delta = (int32_t)counter - (int32_t)g_last_valid_counter - 1;
     }
     
-    g_critical_counter++;
+#if TELEMETRY_BINARY
+    /* No telemetry record type for these yet */
+    (void)scrubbed;
+    (void)flash_bad;
+    if (delta > 1 || delta < -1) {
+        telemetry_fault(counter, delta, fault_get_count());
+    }
+    if (downtime != 0) {
+        telemetry_recovery(downtime, stats_get_total_downtime());
+    }
+    telemetry_heartbeat(counter, stats_get_session_uptime(), fault_get_count());
+#else
+    if (downtime != 0) {
+        uart_puts_P(str_recovered);
+        uart_put_u32(downtime);
+        uart_puts_P(str_recovered_end);
+        uart_newline();
+    }
     
     uart_puts_P(str_running);
-    uart_put_u32(g_critical_counter);
+    uart_put_u32(counter);
     
-    if (fault_check_flag()) {
-        int32_t delta = (int32_t)g_critical_counter - (int32_t)g_last_valid_counter - 1;
-        if (delta > 1 || delta < -1) {
-            uart_puts_P(str_bitflip);
-            uart_put_i32(delta);
-            uart_puts_P(PSTR(" ***"));
-        }
+    if (delta > 1 || delta < -1) {
+        uart_puts_P(str_bitflip);
+        uart_put_i32(delta);
+        uart_puts_P(PSTR(" ***"));
+    } else if (corrected != g_last_corrected) {
+        uart_puts_P(str_repaired);
+        uart_put_u16(corrected);
+    }
+    
+    if (scrubbed != 0) {
+        uart_puts_P(str_scrubbed);
+        uart_put_hex8(scrubbed);
+    }
+    
+    if (flash_bad) {
+        uart_puts_P(str_flash_bad);
     }
     
     uart_puts_P(str_uptime);
@@ -185,47 +419,360 @@ static void heartbeat(void) {
     uart_put_u16(fault_get_count());
     uart_puts_P(str_close);
     uart_newline();
+#endif
     
-    g_last_valid_counter = g_critical_counter;
+    g_last_valid_counter = counter;
+    g_last_corrected = corrected;
+    PROBE_END(PROBE_HEARTBEAT);
 }
 
 #if ENABLE_RESEARCH_SUMMARY
-static void research_summary(void) {
-    if (!systick_elapsed(&g_summary_tick, RESEARCH_SUMMARY_INTERVAL)) {
-        return;
-    }
+#if !TELEMETRY_BINARY
+/* Lines of the status report, sent one per summary_poll() */
+enum {
+    SUMMARY_OPEN = 0,
+    SUMMARY_SESSION,
+    SUMMARY_COUNTER,
+    SUMMARY_FAULTS,
+    SUMMARY_CRASHES,
+    SUMMARY_AVAIL,
+    SUMMARY_DOWNTIME,
+    SUMMARY_DROPS,
+    SUMMARY_UPSETS,
+    SUMMARY_SCRUB,              /* One per scrub region */
+    SUMMARY_FLASH,
+    SUMMARY_STACK,
+    SUMMARY_TASK,               /* One per task... */
+    SUMMARY_JITTER,             /* ...and one more per periodic task */
+    SUMMARY_LOAD,
+    SUMMARY_SCHED,
+    SUMMARY_CLOSE,
+    SUMMARY_IDLE
+};
+
+static uint8_t g_summary_line = SUMMARY_IDLE;
+static uint8_t g_summary_item = 0;         /* Scrub region or task priority */
+
+static void print_scrub_line(uint8_t region) {
+    scrub_info_t info;
     
+    scrub_get_info(region, &info);
+    uart_puts_P(str_scrub_region);
+    uart_put_u8(region);
+    uart_puts_P(str_scrub_worst);
+    uart_put_u16(info.worst_ms);
+    uart_putc('/');
+    uart_put_u16(info.latency_ms);
+    uart_puts_P(str_scrub_fixed);
+    uart_put_u16(info.repaired);
+    uart_puts_P(str_scrub_lost);
+    uart_put_u16(info.lost);
     uart_newline();
-    uart_puts_P(str_research); uart_newline();
+}
+
+static void print_flash_line(void) {
+    flashcheck_info_t flash;
     
-    uart_puts_P(str_session);
-    uart_put_u32(stats_get_session_uptime() / 1000);
-    uart_puts_P(str_sec);
+    flashcheck_get_info(&flash);
+    uart_puts_P(str_flash);
+    if (flash.length == 0) {
+        uart_puts_P(str_flash_none);
+    } else {
+        uart_put_u16(flash.sweeps);
+        uart_puts_P(str_flash_sweeps);
+        uart_put_u32(flash.period_ms);
+        uart_puts_P(str_flash_bad_cnt);
+        uart_put_u16(flash.bad);
+    }
     uart_newline();
+}
+
+static void print_stack_line(void) {
+    stack_info_t stack;
     
-    uart_puts_P(str_counter);
-    uart_put_u32(g_critical_counter);
+    stack_get_info(&stack);
+    if (stack.size == 0) {
+        uart_puts_P(str_stack_none);
+    } else {
+        uart_puts_P(str_stack);
+        uart_put_u16(stack.peak);
+        uart_puts_P(str_stack_of);
+        uart_put_u16(stack.size);
+        uart_puts_P(str_stack_static);
+        uart_put_u16(stack.static_bytes);
+        uart_putc('B');
+    }
     uart_newline();
-    
-    uart_puts_P(str_fault_cnt);
-    uart_put_u16(fault_get_count());
+}
+
+static void print_task_line(const sched_stats_t *task) {
+    uart_puts_P(str_task);
+    uart_put_u8(task->mark);
+    if (task->period_ms != 0) {
+        uart_puts_P(str_task_every);
+        uart_put_u16(task->period_ms);
+        uart_puts_P(str_ms);
+    } else {
+        uart_puts_P(str_task_bg);
+    }
+    uart_puts_P(str_task_runs);
+    uart_put_u32(task->runs);
+    uart_puts_P(str_task_miss);
+    uart_put_u16(task->misses);
+    uart_puts_P(str_task_max);
+    uart_put_u32(task->max_us);
+    uart_puts_P(str_task_avg);
+    uart_put_u32(task->runs ? task->total_us / task->runs : 0);
+    uart_puts_P(str_us);
     uart_newline();
+}
+
+static void print_jitter_line(const periodic_t *timer) {
+    uint8_t b;
     
-    uart_puts_P(str_crash_cnt);
-    uart_put_u16(stats_get_crash_count());
+    uart_puts_P(str_jitter);
+    for (b = 0; b < PERIODIC_HIST_BUCKETS; b++) {
+        uart_putc(' ');
+        uart_put_u16(timer->hist[b]);
+    }
     uart_newline();
+}
+
+/* CPU load over the last window */
+static void print_load_line(void) {
+    power_info_t power;
     
-    uart_puts_P(str_avail);
-    uart_put_u8(stats_get_availability());
-    uart_puts_P(str_percent);
+    power_get_info(&power);
+    uart_puts_P(str_load);
+    uart_put_u16(power.load_permille / 10U);
+    uart_putc('.');
+    uart_put_u8((uint8_t)(power.load_permille % 10U));
+    uart_puts_P(str_load_sleeps);
+    uart_put_u32(power.sleeps);
+    uart_puts_P(str_load_asleep);
+    uart_put_u32(power.sleep_us / 1000U);
+    uart_puts_P(str_load_of);
+    uart_put_u32(power.window_us / 1000U);
+    uart_puts_P(str_ms);
     uart_newline();
+}
+
+/* The scheduler's own cost over the last window */
+static void print_sched_line(void) {
+    sched_info_t info;
     
-    uart_puts_P(str_box_end);
-    uart_newline();
+    sched_get_info(&info);
+    uart_puts_P(str_sched);
+    uart_put_u32(info.dispatches);
+    uart_puts_P(str_sched_idle);
+    uart_put_u32(info.idle);
+    uart_puts_P(str_sched_cost);
+    uart_put_u32(info.dispatches ? info.overhead_us / info.dispatches : 0);
+    uart_putc('/');
+    uart_put_u16(info.overhead_max_us);
+    uart_puts_P(str_us);
     uart_newline();
 }
+
+/* Next task line (or the step after the tasks) from g_summary_item on */
+static void summary_task_line(void) {
+    sched_stats_t task;
+    
+    while (g_summary_item < SCHED_MAX_TASKS && !sched_get_stats(g_summary_item, &task)) {
+        g_summary_item++;
+    }
+    
+    if (g_summary_item == SCHED_MAX_TASKS) {
+        g_summary_line = SUMMARY_LOAD;
+        return;
+    }
+    
+    print_task_line(&task);
+    if (sched_get_timer(g_summary_item) != 0) {
+        g_summary_line = SUMMARY_JITTER;
+    } else {
+        g_summary_item++;
+    }
+}
+
+/*
+ * Send the next line of the status report started by research_summary().
+ * A line only goes into an empty TX ring, where it always fits, so this
+ * never waits on the UART. Returns 0 once the report is done.
+ */
+static uint8_t summary_poll(void) {
+    uint8_t line = g_summary_line;
+    uint32_t ppm;
+    
+    if (line == SUMMARY_IDLE) {
+        return 0;
+    }
+    if (uart_tx_pending() != 0) {
+        return 1;
+    }
+    
+    switch (line) {
+    case SUMMARY_OPEN:
+        uart_newline();
+        uart_puts_P(str_research); uart_newline();
+        break;
+    case SUMMARY_SESSION:
+        uart_puts_P(str_session);
+        uart_put_u32(stats_get_session_uptime() / 1000);
+        uart_puts_P(str_sec);
+        uart_newline();
+        break;
+    case SUMMARY_COUNTER:
+        uart_puts_P(str_counter);
+        uart_put_u32(tmr32_read(&g_critical_counter));
+        uart_newline();
+        break;
+    case SUMMARY_FAULTS:
+        uart_puts_P(str_fault_cnt);
+        uart_put_u16(fault_get_count());
+        uart_newline();
+        break;
+    case SUMMARY_CRASHES:
+        uart_puts_P(str_crash_cnt);
+        uart_put_u16(stats_get_crash_count());
+        uart_newline();
+        break;
+    case SUMMARY_AVAIL:
+        ppm = stats_get_availability_ppm();
+        uart_puts_P(str_avail);
+        uart_put_u32(ppm / 10000U);
+        uart_putc('.');
+        uart_put_u32_pad(ppm % 10000U, 4, '0');
+        uart_puts_P(str_percent);
+        uart_put_u8(stats_availability_nines(ppm));
+        uart_puts_P(str_nines);
+        uart_newline();
+        break;
+    case SUMMARY_DOWNTIME:
+        uart_puts_P(str_downtime);
+        uart_put_u32(stats_get_total_downtime());
+        uart_puts_P(str_ms);
+        uart_newline();
+        break;
+    case SUMMARY_DROPS:
+        uart_puts_P(str_uart_drops);
+        uart_put_u16(uart_tx_get_dropped());
+        uart_newline();
+        break;
+    case SUMMARY_UPSETS:
+        uart_puts_P(str_upsets);
+        uart_put_u16(protect_get_corrected());
+        uart_puts_P(str_slash);
+        uart_put_u16(protect_get_detected());
+        uart_newline();
+        g_summary_item = 0;
+        break;
+    case SUMMARY_SCRUB:
+        if (g_summary_item < scrub_region_count()) {
+            print_scrub_line(g_summary_item++);
+            return 1;
+        }
+        break;
+    case SUMMARY_FLASH:
+        print_flash_line();
+        break;
+    case SUMMARY_STACK:
+        print_stack_line();
+        g_summary_item = 0;
+        break;
+    case SUMMARY_TASK:
+        summary_task_line();
+        return 1;
+    case SUMMARY_JITTER:
+        print_jitter_line(sched_get_timer(g_summary_item));
+        g_summary_item++;
+        g_summary_line = SUMMARY_TASK;
+        return 1;
+    case SUMMARY_LOAD:
+        print_load_line();
+        break;
+    case SUMMARY_SCHED:
+        print_sched_line();
+        
+        /* Everything per window is out: start the next one */
+        sched_reset_stats();
+        power_reset_stats();
+        break;
+    default:
+        uart_puts_P(str_box_end);
+        uart_newline();
+        uart_newline();
+        break;
+    }
+    
+    g_summary_line = (uint8_t)(line + 1U);
+    return 1;
+}
+#endif
+
+static void research_summary(void) {
+#if TELEMETRY_BINARY
+    uint8_t i;
+#endif
+    
+    PROBE_BEGIN(PROBE_SUMMARY);
+    supervisor_checkin(TASK_SUMMARY);
+#if TELEMETRY_BINARY
+    telemetry_summary(stats_get_session_uptime(), tmr32_read(&g_critical_counter),
+                      fault_get_count(), stats_get_crash_count(),
+                      stats_get_availability_ppm(),
+                      stats_get_total_downtime(), uart_tx_get_dropped());
+    for (i = 0; i < SCHED_MAX_TASKS; i++) {
+        sched_stats_t task;
+        const periodic_t *timer = sched_get_timer(i);
+        
+        if (timer != 0 && sched_get_stats(i, &task)) {
+            telemetry_jitter(task.mark, timer);
+        }
+    }
+    sched_reset_stats();
+    power_reset_stats();
+#else
+    /* The box takes ~100 ms to send: report_task() sends it a line at a time */
+    if (g_summary_line == SUMMARY_IDLE) {
+        g_summary_item = 0;
+        g_summary_line = SUMMARY_OPEN;
+    }
+#endif
+    PROBE_END(PROBE_SUMMARY);
+}
 #endif
 
+static void command_task(void) {
+    cmd_poll(tmr32_read(&g_critical_counter));
+}
+
+#if (ENABLE_RESEARCH_SUMMARY || ENABLE_PROBES) && !TELEMETRY_BINARY
+/* Long text reports, a line at a time as the TX ring empties */
+static void report_task(void) {
+    static uint8_t probing = 0;
+    
+    /* One report at a time, so their lines do not interleave */
+#if ENABLE_RESEARCH_SUMMARY
+    if (!probing && summary_poll()) {
+        return;
+    }
+#endif
+    probing = probe_report_poll();
+}
+#endif
+
+/* End of every scheduler pass: proves no task is hogging the loop */
+static void idle_task(void) {
+    WDT_TASK_MARK(TASK_IDLE);
+    supervisor_checkin(TASK_IDLE);
+    
+    /* Nothing left this pass: wait for the next interrupt (systick at the latest) */
+    if (!sched_due()) {
+        power_idle();
+    }
+}
+
 static void system_init(void) {
     uart_init(UART_BAUD_RATE);
     
@@ -234,10 +781,18 @@ static void system_init(void) {
     
     stats_init();
     
+    g_have_last_gasp = wdt_crash_record_take(&g_last_gasp);
+    
     if (wdt_was_reset()) {
-        stats_record_crash();
+        stats_record_crash(g_have_last_gasp ? &g_last_gasp : 0);
     }
     
+    /* Attack mode and interval as last set over the UART */
+    settings_load();
+    
+    /* A different arrival sequence after every reset, reproducible from the stats */
+    fault_seed(stats_get_total_uptime() ^ ((uint32_t)stats_get_crash_count() << 16));
+    
     print_crash_notification();
     print_eeprom_stats();
     print_config();
@@ -245,22 +800,54 @@ static void system_init(void) {
     uart_puts_P(str_init_systick);
     uart_newline();
     systick_init();
+    probe_timer_start();
+    flashcheck_init();
+    
+#if ENABLE_BOOT_BENCHMARK
+    /* Borrows Timer1, so must run before the fault timer is armed */
+    bench_run();
+#endif
     
     uart_puts_P(str_init_fault);
     uart_newline();
-    fault_timer_init(FAULT_INJECT_INTERVAL_SEC);
+    settings_apply();
     
-    fault_set_victim_ptr(&g_critical_counter);
+    fault_set_victim_ptr(&g_critical_counter.a);
     
     uart_puts_P(str_init_wdt);
     uart_newline();
-    wdt_init(WDT_2S);
+    supervisor_register(TASK_IDLE, SUPERVISOR_LOOP_DEADLINE_MS);
+    supervisor_register(TASK_HEARTBEAT, SUPERVISOR_HEARTBEAT_DEADLINE_MS);
+#if ENABLE_RESEARCH_SUMMARY
+    supervisor_register(TASK_SUMMARY, SUPERVISOR_SUMMARY_DEADLINE_MS);
+#endif
+    supervisor_start();
+    
+    uart_puts_P(str_wdt_cfg);
+    uart_put_u16(supervisor_timeout_ms(supervisor_get_timeout()));
+    uart_puts_P(str_ms);
+    uart_newline();
+    
+    /* Everything the main loop runs, by priority */
+    sched_add(PRIO_SUPERVISOR, TASK_SUPERVISOR, supervisor_poll, SUPERVISOR_KICK_INTERVAL_MS);
+    sched_add(PRIO_HEARTBEAT, TASK_HEARTBEAT, heartbeat, HEARTBEAT_INTERVAL_MS);
+    sched_add(PRIO_COMMAND, TASK_COMMAND, command_task, 0);
+    sched_add(PRIO_CHECKPOINT, TASK_CHECKPOINT, stats_checkpoint_poll, 0);
+    sched_add(PRIO_SCRUB, TASK_SCRUB, scrub_poll, 0);
+    sched_add(PRIO_FLASHCHECK, TASK_FLASHCHECK, flashcheck_poll, 0);
+#if ENABLE_RESEARCH_SUMMARY
+    sched_add(PRIO_SUMMARY, TASK_SUMMARY, research_summary, RESEARCH_SUMMARY_INTERVAL);
+#endif
+#if (ENABLE_RESEARCH_SUMMARY || ENABLE_PROBES) && !TELEMETRY_BINARY
+    sched_add(PRIO_REPORT, TASK_REPORT, report_task, 0);
+#endif
+    sched_set_idle(idle_task);
     
     INTERRUPTS_ENABLE();
     
     stats_session_start();
-    g_heartbeat_tick = systick_get_ms();
-    g_summary_tick = systick_get_ms();
+    sched_start();
+    power_reset_stats();
     
     uart_newline();
     uart_puts_P(str_entering);
@@ -268,19 +855,28 @@ static void system_init(void) {
     uart_puts_P(str_banner1);
     uart_newline();
     uart_newline();
+    uart_flush();
+    
+#if TELEMETRY_BINARY
+    /* Everything after this point is COBS-framed */
+    telemetry_begin();
+    telemetry_crash(stats_get_crash_count(), wdt_get_reset_reason());
+    if (g_have_last_gasp) {
+        telemetry_crash_info(g_last_gasp.pc, g_last_gasp.sp, g_last_gasp.sreg,
+                             g_last_gasp.systick_ms, g_last_gasp.faults,
+                             g_last_gasp.task, g_last_gasp.stalled,
+                             g_last_gasp.cause);
+    }
+#endif
 }
 
 int main(void) {
     system_init();
     
     for (;;) {
-        heartbeat();
-        
-#if ENABLE_RESEARCH_SUMMARY
-        research_summary();
-#endif
-        
-        wdt_kick();
+        PROBE_BEGIN(PROBE_LOOP);
+        sched_dispatch();
+        PROBE_END(PROBE_LOOP);
     }
     
     return 0;
@@ -0,0 +1,59 @@
+
+#include "power.h"
+#include "timer.h"
+#include "atmega328p.h"
+
+
+/* The longest possible sleep is one Timer0 overflow period */
+#if (256UL * SYSTICK_TICK_US) > (SUPERVISOR_LOOP_DEADLINE_MS * 1000UL / 2UL)
+#error "A systick period this long could let idle sleep outlast the loop deadline"
+#endif
+
+static uint32_t g_power_window_start = 0;
+static uint32_t g_power_sleep_ticks = 0;
+static uint32_t g_power_sleeps = 0;
+
+
+void power_idle(void)
+{
+#if ENABLE_IDLE_SLEEP
+    uint32_t t0;
+    
+    /*
+     * Interrupts off from the timestamp to the sleep: an ISR in between
+     * would otherwise be counted as sleep, or its wake-up missed.
+     */
+    INTERRUPTS_DISABLE();
+    t0 = systick_get_ticks();
+    REG_SMCR = BIT(SMCR_SE);                    /* Idle mode (SM = 000) */
+    SEI_SLEEP();
+    REG_SMCR = 0;
+    
+    g_power_sleep_ticks += systick_get_ticks() - t0;
+    g_power_sleeps++;
+#endif
+}
+
+void power_get_info(power_info_t *info)
+{
+    uint32_t window = systick_get_ticks() - g_power_window_start;
+    uint32_t awake = window - g_power_sleep_ticks;
+    
+    info->window_us = window * SYSTICK_TICK_US;
+    info->sleep_us = g_power_sleep_ticks * SYSTICK_TICK_US;
+    info->sleeps = g_power_sleeps;
+    
+    /* Scaled down first so awake * 1000 cannot overflow */
+    while (window > 0x3FFFFFUL) {
+        window >>= 1;
+        awake >>= 1;
+    }
+    info->load_permille = window ? (uint16_t)(awake * 1000UL / window) : 1000U;
+}
+
+void power_reset_stats(void)
+{
+    g_power_window_start = systick_get_ticks();
+    g_power_sleep_ticks = 0;
+    g_power_sleeps = 0;
+}
@@ -0,0 +1,175 @@
+#include "probe.h"
+
+#if ENABLE_PROBES
+
+#include "uart.h"
+#include <avr/pgmspace.h>
+
+
+typedef struct {
+    uint32_t count;
+    uint32_t total;             /* Cycles; the table is reset every report */
+    uint32_t min;
+    uint32_t max;
+    uint16_t hist[PROBE_HIST_BUCKETS];
+} probe_stats_t;
+
+static probe_stats_t g_probes[PROBE_COUNT];
+static const probe_stats_t g_probe_zero = { 0, 0, 0, 0, { 0 } };
+
+/* Set while a report line prints, so it does not profile itself */
+static volatile uint8_t g_probe_paused = 0;
+
+static uint32_t g_probe_report_tick = 0;
+
+/* Next line of the report in progress: header, probe rows, trailer */
+#define PROBE_ROW_HEADER        0xFEU
+#define PROBE_ROW_IDLE          0xFFU
+static uint8_t g_probe_row = PROBE_ROW_IDLE;
+
+/* Padded to one column width */
+static const char probe_names[PROBE_COUNT][12] PROGMEM = {
+    "loop       ",
+    "heartbeat  ",
+    "summary    ",
+    "uart_puts  ",
+    "isr eeprom ",
+    "isr systick",
+    "isr fault  ",
+    "checkpoint ",
+    "scrub      ",
+    "flashcheck "
+};
+
+static const char str_probe_hdr[] PROGMEM = "+------ PROFILE (cycles) ------+";
+static const char str_probe_cols[] PROGMEM = "| probe             n     min     avg     max total_ms | log2 hist from 16";
+static const char str_probe_bar[] PROGMEM = "| ";
+static const char str_probe_sep[] PROGMEM = " |";
+
+
+/* ============================================================================
+ * TIMER / RECORDING
+ * ============================================================================ */
+
+void probe_timer_start(void)
+{
+    REG_TCCR2B = 0;
+    REG_TIMSK2 = 0;
+    REG_TCCR2A = 0;                             /* Normal mode, wraps at 256 */
+    REG_TCCR2B = BIT(TCCR2B_CS20);              /* clk/1 */
+}
+
+void probe_record(uint8_t id, uint32_t cycles)
+{
+    probe_stats_t *p = &g_probes[id];
+    uint8_t bucket = 0;
+    uint32_t t = cycles >> PROBE_HIST_SHIFT;
+
+    if (g_probe_paused) {
+        return;
+    }
+
+    while (t != 0 && bucket < PROBE_HIST_BUCKETS - 1) {
+        bucket++;
+        t >>= 1;
+    }
+
+    if (p->count == 0 || cycles < p->min) {
+        p->min = cycles;
+    }
+    if (cycles > p->max) {
+        p->max = cycles;
+    }
+    p->count++;
+    p->total += cycles;
+    if (p->hist[bucket] != 0xFFFF) {
+        p->hist[bucket]++;
+    }
+}
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================ */
+
+/* Print and reset one probe row */
+static void probe_report_row(uint8_t id)
+{
+    probe_stats_t p;
+    uint8_t b;
+
+    /* ISR probes keep updating: take a consistent copy */
+    CRITICAL_SECTION_BEGIN;
+    p = g_probes[id];
+    g_probes[id] = g_probe_zero;
+    CRITICAL_SECTION_END;
+
+    uart_puts_P(str_probe_bar);
+    uart_puts_P(probe_names[id]);
+    uart_putc(' ');
+    uart_put_u32_pad(p.count, 7, ' ');
+    uart_putc(' ');
+    uart_put_u32_pad(p.min, 7, ' ');
+    uart_putc(' ');
+    uart_put_u32_pad(p.total / p.count, 7, ' ');
+    uart_putc(' ');
+    uart_put_u32_pad(p.max, 7, ' ');
+    uart_putc(' ');
+    uart_put_u32_pad(p.total / (F_CPU / 1000UL), 8, ' ');
+    uart_puts_P(str_probe_sep);
+    for (b = 0; b < PROBE_HIST_BUCKETS; b++) {
+        uart_putc(' ');
+        uart_put_u16(p.hist[b]);
+    }
+    uart_newline();
+}
+
+/* Print the next line; returns the line after it */
+static uint8_t probe_report_line(uint8_t row)
+{
+    if (row == PROBE_ROW_HEADER) {
+        uart_newline();
+        uart_puts_P(str_probe_hdr); uart_newline();
+        uart_puts_P(str_probe_cols); uart_newline();
+        return 0;
+    }
+
+    /* Probes that saw nothing are left out */
+    while (row < PROBE_COUNT && g_probes[row].count == 0) {
+        row++;
+    }
+
+    if (row < PROBE_COUNT) {
+        probe_report_row(row);
+        return (uint8_t)(row + 1U);
+    }
+
+    uart_newline();
+    return PROBE_ROW_IDLE;
+}
+
+uint8_t probe_report_poll(void)
+{
+    if (g_probe_row == PROBE_ROW_IDLE) {
+        if (!systick_elapsed(&g_probe_report_tick, PROBE_REPORT_INTERVAL)) {
+            return 0;
+        }
+        g_probe_row = PROBE_ROW_HEADER;
+    }
+
+    /*
+     * One line per call, and only into an empty TX ring, so the report
+     * never blocks the caller (the whole table takes longer than the
+     * watchdog timeout to send at 115200 baud).
+     */
+    if (uart_tx_pending() != 0) {
+        return 1;
+    }
+
+    g_probe_paused = 1;
+    g_probe_row = probe_report_line(g_probe_row);
+    g_probe_paused = 0;
+
+    return g_probe_row != PROBE_ROW_IDLE;
+}
+
+#endif /* ENABLE_PROBES */
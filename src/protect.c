@@ -0,0 +1,111 @@
+
+#include "protect.h"
+#include "atmega328p.h"
+
+
+/* Written from ISRs too (the systick is protected) */
+static volatile uint16_t g_protect_corrected = 0;
+static volatile uint16_t g_protect_detected = 0;
+
+
+static void protect_count(volatile uint16_t *counter)
+{
+    CRITICAL_SECTION_BEGIN;
+    if (*counter != 0xFFFF) {
+        (*counter)++;
+    }
+    CRITICAL_SECTION_END;
+}
+
+/* ============================================================================
+ * REPAIR (slow paths)
+ * ============================================================================ */
+
+/*
+ * Bitwise 2-of-3 vote: each bit takes the value held by at least two
+ * copies, so upsets in different bits of different copies still vote out.
+ */
+#if ENABLE_PROTECTED_VARS
+
+uint8_t protect_tmr8_repair(volatile tmr8_t *t)
+{
+    uint8_t a = t->a;
+    uint8_t b = t->b;
+    uint8_t c = t->c;
+    uint8_t v = (uint8_t)((a & b) | (a & c) | (b & c));
+    
+    tmr8_write(t, v);
+    protect_count(&g_protect_corrected);
+    return v;
+}
+
+uint16_t protect_tmr16_repair(volatile tmr16_t *t)
+{
+    uint16_t a = t->a;
+    uint16_t b = t->b;
+    uint16_t c = t->c;
+    uint16_t v = (uint16_t)((a & b) | (a & c) | (b & c));
+    
+    tmr16_write(t, v);
+    protect_count(&g_protect_corrected);
+    return v;
+}
+
+uint32_t protect_tmr32_repair(volatile tmr32_t *t)
+{
+    uint32_t a = t->a;
+    uint32_t b = t->b;
+    uint32_t c = t->c;
+    uint32_t v = (a & b) | (a & c) | (b & c);
+    
+    tmr32_write(t, v);
+    protect_count(&g_protect_corrected);
+    return v;
+}
+
+#else
+
+uint8_t protect_tmr8_repair(volatile tmr8_t *t) { return t->a; }
+uint16_t protect_tmr16_repair(volatile tmr16_t *t) { return t->a; }
+uint32_t protect_tmr32_repair(volatile tmr32_t *t) { return t->a; }
+
+#endif /* ENABLE_PROTECTED_VARS */
+
+void protect_cpl_detected(void)
+{
+    protect_count(&g_protect_detected);
+}
+
+/* ============================================================================
+ * COUNTERS
+ * ============================================================================ */
+
+uint16_t protect_get_corrected(void)
+{
+    uint16_t count;
+    
+    CRITICAL_SECTION_BEGIN;
+    count = g_protect_corrected;
+    CRITICAL_SECTION_END;
+    
+    return count;
+}
+
+uint16_t protect_get_detected(void)
+{
+    uint16_t count;
+    
+    CRITICAL_SECTION_BEGIN;
+    count = g_protect_detected;
+    CRITICAL_SECTION_END;
+    
+    return count;
+}
+
+void protect_reset_counts(void)
+{
+    CRITICAL_SECTION_BEGIN;
+    g_protect_corrected = 0;
+    g_protect_detected = 0;
+    CRITICAL_SECTION_END;
+}
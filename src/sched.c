@@ -0,0 +1,259 @@
+
+#include "sched.h"
+#include "timer.h"
+#include "wdt.h"
+#include "atmega328p.h"
+#include <avr/pgmspace.h>
+
+
+#if SCHED_MAX_TASKS > 8
+#error "SCHED_MAX_TASKS must fit the 8-bit ready mask"
+#endif
+
+typedef struct {
+    sched_fn_t fn;
+    uint8_t timer;              /* Index into g_sched_timers, SCHED_NONE = background */
+    sched_stats_t stats;
+} sched_task_t;
+
+static sched_task_t g_sched_tasks[SCHED_MAX_TASKS];
+static periodic_t g_sched_timers[SCHED_MAX_PERIODIC];
+static uint8_t g_sched_timer_count = 0;
+
+/* Task masks by kind, and the tasks released but not run yet */
+static uint8_t g_sched_periodic = 0;
+static uint8_t g_sched_background = 0;
+static uint8_t g_sched_ready = 0;
+
+/* Earliest due time over the periodic tasks not released yet */
+static uint32_t g_sched_next_us = 0;
+
+static sched_fn_t g_sched_idle = 0;
+static sched_info_t g_sched_info;
+
+/* Lowest set bit of a nibble (entry 0 unused) */
+static const uint8_t sched_lsb[16] PROGMEM = {
+    0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+
+static inline uint8_t sched_first(uint8_t mask)
+{
+    if (mask & 0x0FU) {
+        return pgm_read_byte(&sched_lsb[mask & 0x0FU]);
+    }
+    return (uint8_t)(4U + pgm_read_byte(&sched_lsb[mask >> 4]));
+}
+
+/* Overhead only: task run times are kept in full */
+static inline uint16_t sched_ticks_us(uint32_t ticks)
+{
+    uint32_t us = ticks * SYSTICK_TICK_US;
+    
+    return (us > 0xFFFFUL) ? 0xFFFFU : (uint16_t)us;
+}
+
+/* ============================================================================
+ * REGISTRATION
+ * ============================================================================ */
+
+void sched_add(uint8_t prio, uint8_t mark, sched_fn_t fn, uint16_t period_ms)
+{
+    sched_task_t *t;
+    
+    if (prio >= SCHED_MAX_TASKS || fn == 0) {
+        return;
+    }
+    
+    t = &g_sched_tasks[prio];
+    t->timer = SCHED_NONE;
+    
+    if (period_ms == 0) {
+        g_sched_background |= (uint8_t)BIT(prio);
+    } else if (g_sched_timer_count < SCHED_MAX_PERIODIC) {
+        t->timer = g_sched_timer_count++;
+        g_sched_periodic |= (uint8_t)BIT(prio);
+    } else {
+        return;
+    }
+    
+    t->fn = fn;
+    t->stats.period_ms = period_ms;
+    t->stats.mark = mark;
+}
+
+void sched_set_idle(sched_fn_t fn)
+{
+    g_sched_idle = fn;
+}
+
+void sched_start(void)
+{
+    uint8_t i;
+    
+    g_sched_next_us = systick_get_us() + 0x7FFFFFFFUL;
+    for (i = 0; i < SCHED_MAX_TASKS; i++) {
+        if (g_sched_periodic & BIT(i)) {
+            periodic_t *p = &g_sched_timers[g_sched_tasks[i].timer];
+            
+            periodic_start(p, g_sched_tasks[i].stats.period_ms);
+            if ((int32_t)(p->due_us - g_sched_next_us) < 0) {
+                g_sched_next_us = p->due_us;
+            }
+        }
+    }
+    
+    g_sched_ready = g_sched_background;
+    sched_reset_stats();
+}
+
+/* ============================================================================
+ * DISPATCH
+ * ============================================================================ */
+
+/* Release every periodic task that is due and find the next due time */
+static void sched_release(uint32_t now_us)
+{
+    uint32_t next = now_us + 0x7FFFFFFFUL;
+    uint8_t i;
+    
+    for (i = 0; i < SCHED_MAX_TASKS; i++) {
+        uint8_t mask = (uint8_t)BIT(i);
+        periodic_t *p;
+        
+        /* A released task's timer only moves on when it runs */
+        if (!(g_sched_periodic & mask) || (g_sched_ready & mask)) {
+            continue;
+        }
+        
+        p = &g_sched_timers[g_sched_tasks[i].timer];
+        if (periodic_expired(p, now_us)) {
+            g_sched_ready |= mask;
+        } else if ((int32_t)(p->due_us - next) < 0) {
+            next = p->due_us;
+        }
+    }
+    
+    g_sched_next_us = next;
+}
+
+void sched_dispatch(void)
+{
+    uint32_t t0 = systick_get_ticks();
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t run_us;
+    uint16_t us;
+    sched_task_t *t;
+    uint8_t prio;
+    
+    if ((int32_t)(t0 * SYSTICK_TICK_US - g_sched_next_us) >= 0) {
+        sched_release(t0 * SYSTICK_TICK_US);
+    }
+    
+    if (g_sched_ready == 0) {
+        /* End of pass */
+        g_sched_ready = g_sched_background;
+        g_sched_info.idle++;
+        t = 0;
+        t1 = systick_get_ticks();
+        if (g_sched_idle) {
+            g_sched_idle();
+        }
+    } else {
+        prio = sched_first(g_sched_ready);
+        g_sched_ready &= (uint8_t)~BIT(prio);
+        t = &g_sched_tasks[prio];
+        
+        t1 = systick_get_ticks();
+        if (t->timer != SCHED_NONE) {
+            periodic_t *p = &g_sched_timers[t->timer];
+            
+            /* Record how late this start is; the next period joins the due times */
+            periodic_advance(p, t1 * SYSTICK_TICK_US);
+            if ((int32_t)(p->due_us - g_sched_next_us) < 0) {
+                g_sched_next_us = p->due_us;
+            }
+        }
+        WDT_TASK_MARK(t->stats.mark);
+        t->fn();
+    }
+    t2 = systick_get_ticks();
+    
+    if (t != 0) {
+        run_us = (t2 - t1) * SYSTICK_TICK_US;
+        t->stats.runs++;
+        t->stats.total_us += run_us;
+        if (run_us > t->stats.max_us) {
+            t->stats.max_us = run_us;
+        }
+    }
+    
+    /* Everything but the task (or idle hook) itself */
+    us = sched_ticks_us((t1 - t0) + (systick_get_ticks() - t2));
+    g_sched_info.dispatches++;
+    g_sched_info.overhead_us += us;
+    if (us > g_sched_info.overhead_max_us) {
+        g_sched_info.overhead_max_us = us;
+    }
+}
+
+uint8_t sched_due(void)
+{
+    return (int32_t)(systick_get_us() - g_sched_next_us) >= 0;
+}
+
+/* ============================================================================
+ * REPORTING
+ * ============================================================================ */
+
+uint8_t sched_get_stats(uint8_t prio, sched_stats_t *stats)
+{
+    const sched_task_t *t;
+    
+    if (prio >= SCHED_MAX_TASKS || g_sched_tasks[prio].fn == 0) {
+        return 0;
+    }
+    
+    t = &g_sched_tasks[prio];
+    *stats = t->stats;
+    stats->misses = (t->timer != SCHED_NONE) ? g_sched_timers[t->timer].skipped : 0;
+    return 1;
+}
+
+const periodic_t *sched_get_timer(uint8_t prio)
+{
+    if (prio >= SCHED_MAX_TASKS || g_sched_tasks[prio].fn == 0 ||
+        g_sched_tasks[prio].timer == SCHED_NONE) {
+        return 0;
+    }
+    
+    return &g_sched_timers[g_sched_tasks[prio].timer];
+}
+
+void sched_get_info(sched_info_t *info)
+{
+    *info = g_sched_info;
+}
+
+void sched_reset_stats(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < SCHED_MAX_TASKS; i++) {
+        sched_stats_t *s = &g_sched_tasks[i].stats;
+        
+        s->runs = 0;
+        s->max_us = 0;
+        s->total_us = 0;
+    }
+    
+    for (i = 0; i < g_sched_timer_count; i++) {
+        periodic_reset_stats(&g_sched_timers[i]);
+    }
+    
+    g_sched_info.dispatches = 0;
+    g_sched_info.idle = 0;
+    g_sched_info.overhead_us = 0;
+    g_sched_info.overhead_max_us = 0;
+}
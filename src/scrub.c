@@ -0,0 +1,271 @@
+
+#include "scrub.h"
+#include "crc.h"
+#include "timer.h"
+#include "probe.h"
+#include "atmega328p.h"
+
+
+/*
+ * Worst case of one scrub_poll(): a chunk, then at most one repair
+ * (shadow check plus copy, or a fresh CRC) of the largest region. At a
+ * conservative SCRUB_BYTE_CYCLES per byte it must stay within
+ * SCRUB_BUDGET_CYCLES, an eighth of the shortest watchdog period (16 ms).
+ */
+#define SCRUB_BYTE_CYCLES       120UL
+#define SCRUB_BUDGET_CYCLES     (F_CPU / 500UL)
+#define SCRUB_POLL_MAX_CYCLES   ((SCRUB_CHUNK_BYTES + 2UL * SCRUB_REGION_MAX) * SCRUB_BYTE_CYCLES)
+
+#if SCRUB_CHUNK_BYTES < 1 || SCRUB_CHUNK_BYTES > 255
+#error "SCRUB_CHUNK_BYTES must be 1-255"
+#endif
+
+#if SCRUB_POLL_MAX_CYCLES > SCRUB_BUDGET_CYCLES
+#error "SCRUB_CHUNK_BYTES does not fit the per-loop cycle budget"
+#endif
+
+#if SCRUB_MAX_REGIONS > 8
+#error "SCRUB_MAX_REGIONS must fit the 8-bit event mask"
+#endif
+
+typedef struct {
+    volatile uint8_t *addr;
+    uint8_t *shadow;
+    uint8_t len;
+    uint8_t gen;                /* Bumped by every commit */
+    uint16_t crc;               /* CRC-16/CCITT of the committed contents */
+    uint32_t last_start;        /* Start tick of the last completed pass */
+    scrub_info_t info;
+} scrub_region_t;
+
+static scrub_region_t g_scrub_regions[SCRUB_MAX_REGIONS];
+static uint8_t g_scrub_count = 0;
+
+/* Regions with an upset since the last scrub_take_events() */
+static uint8_t g_scrub_events = 0;
+
+/* Pass in progress: one region at a time */
+static uint8_t g_scrub_active = SCRUB_NONE;
+static uint8_t g_scrub_pos = 0;
+static uint8_t g_scrub_gen = 0;
+static uint16_t g_scrub_crc = 0;
+static uint32_t g_scrub_start = 0;
+
+
+static uint16_t scrub_crc(const volatile uint8_t *p, uint8_t len)
+{
+    uint16_t crc = CRC16_CCITT_INIT;
+    
+    while (len--) {
+        crc = crc16_ccitt_update(crc, *p++);
+    }
+    
+    return crc;
+}
+
+static inline void scrub_count(uint16_t *counter)
+{
+    if (*counter != 0xFFFF) {
+        (*counter)++;
+    }
+}
+
+/* ============================================================================
+ * REGISTRY
+ * ============================================================================ */
+
+uint8_t scrub_register(volatile void *addr, void *shadow, uint8_t len, uint16_t latency_ms)
+{
+    scrub_region_t *r;
+    uint8_t id = g_scrub_count;
+    
+    if (id >= SCRUB_MAX_REGIONS || len == 0 || len > SCRUB_REGION_MAX) {
+        return SCRUB_NONE;
+    }
+    
+    r = &g_scrub_regions[id];
+    r->addr = (volatile uint8_t *)addr;
+    r->shadow = (uint8_t *)shadow;
+    r->len = len;
+    r->gen = 0;
+    r->last_start = systick_get_ms();
+    r->info.latency_ms = latency_ms;
+    r->info.worst_ms = 0;
+    r->info.passes = 0;
+    r->info.repaired = 0;
+    r->info.lost = 0;
+    g_scrub_count++;
+    
+    scrub_commit(id);
+    return id;
+}
+
+void scrub_commit(uint8_t id)
+{
+    scrub_region_t *r;
+    uint8_t i;
+    
+    if (id >= g_scrub_count) {
+        return;
+    }
+    
+    r = &g_scrub_regions[id];
+    
+    /* Atomic against ISR-side commits and the end-of-pass check */
+    CRITICAL_SECTION_BEGIN;
+    r->crc = scrub_crc(r->addr, r->len);
+    if (r->shadow) {
+        for (i = 0; i < r->len; i++) {
+            r->shadow[i] = r->addr[i];
+        }
+    }
+    r->gen++;
+    CRITICAL_SECTION_END;
+}
+
+/* ============================================================================
+ * SCRUBBING
+ * ============================================================================ */
+
+/*
+ * Start a pass on the region furthest past its start time (half its
+ * latency after the last pass started). Returns 0 if none is due.
+ */
+static uint8_t scrub_start(uint32_t now)
+{
+    uint32_t most = 0;
+    uint8_t pick = SCRUB_NONE;
+    uint8_t i;
+    
+    for (i = 0; i < g_scrub_count; i++) {
+        scrub_region_t *r = &g_scrub_regions[i];
+        uint32_t elapsed = now - r->last_start;
+        uint16_t half = r->info.latency_ms / 2U;
+        
+        if (elapsed >= half && (pick == SCRUB_NONE || elapsed - half > most)) {
+            most = elapsed - half;
+            pick = i;
+        }
+    }
+    
+    if (pick == SCRUB_NONE) {
+        return 0;
+    }
+    
+    g_scrub_active = pick;
+    g_scrub_pos = 0;
+    g_scrub_gen = g_scrub_regions[pick].gen;
+    g_scrub_crc = CRC16_CCITT_INIT;
+    g_scrub_start = now;
+    return 1;
+}
+
+/* Mismatch on a region that was not written during the pass (interrupts off) */
+static void scrub_repair(scrub_region_t *r, uint8_t id)
+{
+    uint8_t i;
+    
+    if (r->shadow && scrub_crc(r->shadow, r->len) == r->crc) {
+        for (i = 0; i < r->len; i++) {
+            r->addr[i] = r->shadow[i];
+        }
+        scrub_count(&r->info.repaired);
+    } else {
+        /* Nothing good to restore: report once, then track the new contents */
+        r->crc = scrub_crc(r->addr, r->len);
+        if (r->shadow) {
+            for (i = 0; i < r->len; i++) {
+                r->shadow[i] = r->addr[i];
+            }
+        }
+        r->gen++;
+        scrub_count(&r->info.lost);
+    }
+    
+    g_scrub_events |= (uint8_t)BIT(id);
+}
+
+static void scrub_finish(scrub_region_t *r, uint32_t now)
+{
+    uint8_t id = g_scrub_active;
+    uint8_t stale;
+    uint32_t latency;
+    
+    g_scrub_active = SCRUB_NONE;
+    
+    CRITICAL_SECTION_BEGIN;
+    stale = (g_scrub_gen != r->gen);
+    if (!stale && g_scrub_crc != r->crc) {
+        scrub_repair(r, id);
+    }
+    CRITICAL_SECTION_END;
+    
+    if (stale) {
+        return;                 /* Committed mid-pass: still due, starts over */
+    }
+    
+    /* A byte checked early in the last pass is next checked by now */
+    latency = now - r->last_start;
+    if (latency > 0xFFFFUL) {
+        latency = 0xFFFFUL;
+    }
+    if (latency > r->info.worst_ms) {
+        r->info.worst_ms = (uint16_t)latency;
+    }
+    
+    r->last_start = g_scrub_start;
+    scrub_count(&r->info.passes);
+}
+
+void scrub_poll(void)
+{
+    uint32_t now = systick_get_ms();
+    uint8_t budget = SCRUB_CHUNK_BYTES;
+    
+    PROBE_BEGIN(PROBE_SCRUB);
+    while (budget != 0) {
+        scrub_region_t *r;
+        
+        if (g_scrub_active == SCRUB_NONE && !scrub_start(now)) {
+            break;
+        }
+        
+        r = &g_scrub_regions[g_scrub_active];
+        while (budget != 0 && g_scrub_pos < r->len) {
+            g_scrub_crc = crc16_ccitt_update(g_scrub_crc, r->addr[g_scrub_pos]);
+            g_scrub_pos++;
+            budget--;
+        }
+        
+        /* At most one repair per call keeps the worst case bounded */
+        if (g_scrub_pos == r->len) {
+            scrub_finish(r, now);
+            break;
+        }
+    }
+    PROBE_END(PROBE_SCRUB);
+}
+
+/* ============================================================================
+ * REPORTING
+ * ============================================================================ */
+
+uint8_t scrub_take_events(void)
+{
+    uint8_t events = g_scrub_events;
+    
+    g_scrub_events = 0;
+    return events;
+}
+
+uint8_t scrub_region_count(void)
+{
+    return g_scrub_count;
+}
+
+void scrub_get_info(uint8_t id, scrub_info_t *info)
+{
+    if (id < g_scrub_count) {
+        *info = g_scrub_regions[id].info;
+    }
+}
@@ -0,0 +1,118 @@
+
+#include "settings.h"
+#include "fault_inject.h"
+#include "eeprom_drv.h"
+#include "timer.h"
+#include "crc.h"
+#include "config.h"
+
+
+#define SETTINGS_CRC_LEN        (sizeof(settings_t) - sizeof(uint16_t))
+#define SETTINGS_DEFAULTS       ((uint16_t)((FAULT_ARRIVAL_DEFAULT << 12) | \
+                                            (FAULT_MODE_DEFAULT << 8) | \
+                                            FAULT_INJECT_INTERVAL_SEC))
+
+#if EEPROM_ADDR_SETTINGS + 8 > EEPROM_JOURNAL_START
+#error "Settings overlap the stats journal"
+#endif
+
+static settings_t g_settings;
+
+
+static void settings_defaults(void)
+{
+    g_settings.mode = FAULT_MODE_DEFAULT;
+    g_settings.interval_sec = FAULT_INJECT_INTERVAL_SEC;
+    g_settings.armed = 1;
+    g_settings.arrival = FAULT_ARRIVAL_DEFAULT;
+    g_settings.defaults = SETTINGS_DEFAULTS;
+}
+
+static void settings_save(void)
+{
+    g_settings.crc = crc16_ccitt(&g_settings, SETTINGS_CRC_LEN);
+    
+    if (!eeprom_queue_block(EEPROM_ADDR_SETTINGS, &g_settings, sizeof(g_settings))) {
+        eeprom_write_block(EEPROM_ADDR_SETTINGS, &g_settings, sizeof(g_settings));
+    }
+}
+
+void settings_load(void)
+{
+    eeprom_read_block(EEPROM_ADDR_SETTINGS, &g_settings, sizeof(g_settings));
+    
+    if (crc16_ccitt(&g_settings, SETTINGS_CRC_LEN) != g_settings.crc ||
+        g_settings.defaults != SETTINGS_DEFAULTS ||
+        g_settings.mode >= FAULT_MODE_COUNT ||
+        g_settings.arrival >= FAULT_ARRIVAL_COUNT ||
+        g_settings.interval_sec == 0) {
+        settings_defaults();
+    }
+}
+
+void settings_apply(void)
+{
+    fault_set_mode(g_settings.mode);
+    fault_set_arrival(g_settings.arrival);
+    fault_timer_init(g_settings.interval_sec);
+    
+    if (!g_settings.armed) {
+        fault_timer_disable();
+    }
+}
+
+const settings_t *settings_get(void)
+{
+    return &g_settings;
+}
+
+uint8_t settings_set_mode(uint8_t mode)
+{
+    if (mode >= FAULT_MODE_COUNT) {
+        return 0;
+    }
+    
+    g_settings.mode = mode;
+    fault_set_mode(mode);
+    settings_save();
+    return 1;
+}
+
+uint8_t settings_set_interval(uint8_t interval_sec)
+{
+    if (interval_sec == 0) {
+        return 0;
+    }
+    
+    g_settings.interval_sec = interval_sec;
+    settings_apply();
+    settings_save();
+    return 1;
+}
+
+uint8_t settings_set_arrival(uint8_t arrival)
+{
+    if (arrival >= FAULT_ARRIVAL_COUNT) {
+        return 0;
+    }
+    
+    /* Restart Timer1 so the next gap already follows the new distribution */
+    g_settings.arrival = arrival;
+    settings_apply();
+    settings_save();
+    return 1;
+}
+
+uint8_t settings_set_armed(uint8_t armed)
+{
+    g_settings.armed = armed ? 1 : 0;
+    
+    if (g_settings.armed) {
+        fault_timer_enable();
+    } else {
+        fault_timer_disable();
+    }
+    
+    settings_save();
+    return 1;
+}
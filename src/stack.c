@@ -0,0 +1,69 @@
+
+#include "stack.h"
+#include "atmega328p.h"
+
+
+#if STACK_GUARD_BYTES < STACK_FRAME_BUDGET
+#error "STACK_GUARD_BYTES is smaller than one worst-case interrupt frame"
+#endif
+#if STACK_GUARD_BYTES > 64
+#error "STACK_GUARD_BYTES must be at most 64 (checked on every systick)"
+#endif
+
+static stack_info_t g_stack_info;
+
+
+#ifndef FIRA_HOST
+
+/* Start of RAM after the registers and I/O space (start of .data) */
+extern uint8_t __data_start;
+
+/*
+ * Runs from .init3 with no stack in use yet (the init sections fall
+ * through, nothing is called), so everything up to the top can be painted.
+ */
+void stack_paint(void) __attribute__((naked, used, section(".init3")));
+void stack_paint(void)
+{
+    uint8_t *p = &_end;
+    
+    while (p <= &__stack) {
+        *p++ = STACK_PAINT;
+    }
+}
+
+uint16_t stack_check(void)
+{
+    const volatile uint8_t *p = &_end + STACK_GUARD_BYTES;
+    const uint8_t *top = &__stack;
+    uint16_t free_bytes;
+    uint16_t used;
+    
+    while (p <= top && *p == STACK_PAINT) {
+        p++;
+    }
+    
+    free_bytes = (uint16_t)(p - (&_end + STACK_GUARD_BYTES));
+    used = (uint16_t)(top - p + 1);
+    if (used > g_stack_info.peak) {
+        g_stack_info.peak = used;
+    }
+    
+    g_stack_info.size = (uint16_t)(top - (&_end + STACK_GUARD_BYTES) + 1);
+    g_stack_info.static_bytes = (uint16_t)(&_end - &__data_start);
+    return free_bytes;
+}
+
+#else
+
+uint16_t stack_check(void)
+{
+    return 0;
+}
+
+#endif
+
+void stack_get_info(stack_info_t *info)
+{
+    *info = g_stack_info;
+}
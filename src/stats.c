@@ -3,57 +3,423 @@
 #include "eeprom_drv.h"
 #include "timer.h"
 #include "config.h"
+#include "crc.h"
+#include "probe.h"
+#include "scrub.h"
+#include "atmega328p.h"
 
 
+#define STATS_RECORD_CRC_LEN    (sizeof(stats_record_t) - sizeof(uint16_t))
+#define STATS_RECORD_VERSION    2U
+#define STATS_SEQ_ERASED        0xFFFFFFFFUL
+#define STATS_CHECKPOINT_MS     (3600000UL / STATS_CHECKPOINT_PER_HOUR)
+
+/* wdt_last_gasp() re-arms the watchdog for 16 ms before the reset */
+#define STATS_GASP_TAIL_MS      16UL
+
+/* No last-gasp timestamp: assume the supervisor let the heartbeat deadline run out */
+#define STATS_HANG_ESTIMATE_MS  ((uint32_t)SUPERVISOR_HEARTBEAT_DEADLINE_MS)
+
+/* A rebased mark (see stats_mark_t) never reaches back further than this */
+#define STATS_CARRY_MAX_MS      3600000UL
+
+/* Assumed per crash when migrating entries that predate measured downtime */
+#define STATS_LEGACY_DOWNTIME_MS 2000UL
+
+/* Timer1 at clk/64 times the boot scan: 4.19 M cycles before it wraps */
+#define STATS_SCAN_PRESCALE     64U
+
+#if EEPROM_JOURNAL_SLOT_SIZE < 16
+#error "EEPROM_JOURNAL_SLOT_SIZE must hold a stats_record_t"
+#endif
+
 static system_stats_t g_stats;
+static stats_journal_t g_journal;
+
+/* Scrubber region over g_stats, and its repair copy */
+static system_stats_t g_stats_shadow;
+static uint8_t g_stats_scrub = SCRUB_NONE;
+
+/* Tick of the last periodic checkpoint */
+static uint32_t g_checkpoint_tick = 0;
+
+/* A journal record found the EEPROM queue full and is still owed */
+static uint8_t g_journal_deferred = 0;
+
+/* Most bytes the EEPROM queue may hold and still take a whole record */
+#define STATS_QUEUE_ROOM        (EEPROM_QUEUE_SIZE - 1U - sizeof(stats_record_t))
+
+/*
+ * Last heartbeat, in the current boot's timebase, with the uptime reached
+ * at that point. Survives a reset: the crash boot takes the uptime from
+ * here instead of the last checkpoint, and rebases heartbeat_ms to minus
+ * the time already down, so the gap keeps growing through a reset loop
+ * until a heartbeat finally closes it.
+ */
+typedef struct {
+    uint32_t heartbeat_ms;
+    uint32_t uptime_s;          /* total_uptime_s at the heartbeat */
+    uint32_t uptime_ms;         /* Plus session uptime not folded in yet */
+    uint32_t check;             /* ~(xor of the above) */
+} stats_mark_t;
+
+static stats_mark_t g_mark NOINIT;
+
+
+/* ============================================================================
+ * JOURNAL
+ * ============================================================================ */
+
+static inline uint16_t stats_slot_addr(uint8_t slot)
+{
+    return (uint16_t)(EEPROM_JOURNAL_START + (uint16_t)slot * EEPROM_JOURNAL_SLOT_SIZE);
+}
+
+/*
+ * Version 2 entries fold the layout version into the CRC, so entries
+ * written before the uptime unit changed are still told apart.
+ * Returns the entry's version, 0 if erased or corrupt.
+ */
+static uint8_t stats_record_version(const stats_record_t *rec)
+{
+    uint16_t crc;
+    
+    if (rec->seq == STATS_SEQ_ERASED) {
+        return 0;
+    }
+    
+    crc = crc16_ccitt(rec, STATS_RECORD_CRC_LEN);
+    
+    if (crc16_ccitt_update(crc, STATS_RECORD_VERSION) == rec->crc) {
+        return STATS_RECORD_VERSION;
+    }
+    
+    return (crc == rec->crc) ? 1 : 0;
+}
+
+/*
+ * Find the newest valid entry. Pass 1 reads only the 4-byte sequence
+ * numbers; the best candidate is then CRC-checked and, if torn or
+ * corrupt, the next-newest is tried. A healthy ring costs 60 header reads
+ * plus one full entry.
+ */
+static void stats_journal_scan(void)
+{
+    uint32_t bound = STATS_SEQ_ERASED;
+    stats_record_t rec;
+    uint8_t version;
+    
+    g_journal.seq = STATS_SEQ_ERASED;
+    g_journal.slot = EEPROM_JOURNAL_SLOTS - 1;
+    g_journal.bad_slots = 0;
+    
+    for (;;) {
+        uint32_t best = STATS_SEQ_ERASED;
+        uint8_t best_slot = 0;
+        uint8_t i;
+        
+        for (i = 0; i < EEPROM_JOURNAL_SLOTS; i++) {
+            uint32_t seq = eeprom_read_dword(stats_slot_addr(i));
+            
+            if (seq < bound && (best == STATS_SEQ_ERASED || seq > best)) {
+                best = seq;
+                best_slot = i;
+            }
+        }
+        
+        if (best == STATS_SEQ_ERASED) {
+            return;                 /* Empty journal */
+        }
+        
+        eeprom_read_block(stats_slot_addr(best_slot), &rec, sizeof(rec));
+        
+        version = stats_record_version(&rec);
+        
+        if (version == STATS_RECORD_VERSION) {
+            g_journal.seq = rec.seq;
+            g_journal.slot = best_slot;
+            tmr16_write(&g_stats.crash_count, rec.crash_count);
+            tmr32_write(&g_stats.total_uptime_s, rec.total_uptime_s);
+            tmr32_write(&g_stats.total_downtime_ms, rec.total_downtime_ms);
+            return;
+        }
+        
+        if (version == 1) {
+            /* Uptime was in ms and downtime was assumed, not measured */
+            g_journal.seq = rec.seq;
+            g_journal.slot = best_slot;
+            tmr16_write(&g_stats.crash_count, rec.crash_count);
+            tmr32_write(&g_stats.total_uptime_s, rec.total_uptime_s / 1000U);
+            tmr32_write(&g_stats.total_downtime_ms,
+                        (uint32_t)rec.crash_count * STATS_LEGACY_DOWNTIME_MS);
+            return;
+        }
+        
+        g_journal.bad_slots++;
+        bound = best;
+    }
+}
+
+/*
+ * Never blocks: with no room in the EEPROM queue the record is deferred
+ * and stats_checkpoint_poll() writes a fresh one once there is.
+ * Returns 1 if the record was queued.
+ */
+static uint8_t stats_journal_append(void)
+{
+    stats_record_t rec;
+    uint8_t slot;
+    
+    slot = (uint8_t)(g_journal.slot + 1);
+    if (slot >= EEPROM_JOURNAL_SLOTS) {
+        slot = 0;
+    }
+    
+    rec.seq = (g_journal.seq == STATS_SEQ_ERASED) ? 0 : g_journal.seq + 1;
+    rec.crash_count = tmr16_read(&g_stats.crash_count);
+    rec.total_uptime_s = tmr32_read(&g_stats.total_uptime_s);
+    rec.total_downtime_ms = tmr32_read(&g_stats.total_downtime_ms);
+    rec.crc = crc16_ccitt_update(crc16_ccitt(&rec, STATS_RECORD_CRC_LEN),
+                                 STATS_RECORD_VERSION);
+    
+    /* Whole entry goes into the background queue, or not at all */
+    if (!eeprom_queue_block(stats_slot_addr(slot), &rec, sizeof(rec))) {
+        g_journal_deferred = 1;
+        return 0;
+    }
+    
+    g_journal.seq = rec.seq;
+    g_journal.slot = slot;
+    g_journal_deferred = 0;
+    return 1;
+}
+
+/* Boot only, before supervisor_start(): waits for room instead */
+static void stats_journal_append_boot(void)
+{
+    if (!stats_journal_append()) {
+        eeprom_flush();
+        stats_journal_append();
+    }
+}
+
+/* ============================================================================
+ * UPTIME / DOWNTIME
+ * ============================================================================ */
+
+/* Whole seconds of session uptime not yet folded into the total */
+static uint32_t stats_unfolded_s(uint32_t now, uint32_t *consumed_ms)
+{
+    uint32_t elapsed = now - g_stats.uptime_tick;
+    uint32_t secs = elapsed / 1000U;
+    
+    *consumed_ms = secs * 1000U;
+    return secs;
+}
+
+/*
+ * Move whole seconds of the session into total_uptime_s. Called at every
+ * checkpoint, so the ms timebase wrapping after 49 days never matters.
+ */
+static void stats_fold_uptime(void)
+{
+    uint32_t consumed;
+    uint32_t secs = stats_unfolded_s(systick_get_ms(), &consumed);
+    
+    tmr32_write(&g_stats.total_uptime_s, tmr32_read(&g_stats.total_uptime_s) + secs);
+    g_stats.uptime_tick += consumed;
+    scrub_commit(g_stats_scrub);
+}
+
+static inline void stats_mark_set(uint32_t ms, uint32_t uptime_ms)
+{
+    uint32_t uptime_s = tmr32_read(&g_stats.total_uptime_s);
+    
+    g_mark.heartbeat_ms = ms;
+    g_mark.uptime_s = uptime_s;
+    g_mark.uptime_ms = uptime_ms;
+    g_mark.check = ~(ms ^ uptime_s ^ uptime_ms);
+}
+
+static inline uint8_t stats_mark_valid(void)
+{
+    return g_mark.check == ~(g_mark.heartbeat_ms ^ g_mark.uptime_s ^ g_mark.uptime_ms);
+}
+
+/*
+ * floor(part * 10^6 / whole), part <= whole. Decimal long division: six
+ * rounds of multiply-by-10 and repeated subtraction, no 32-bit divide.
+ * Large operands are scaled down until r * 10 cannot overflow.
+ */
+static uint32_t stats_ppm(uint32_t part, uint32_t whole)
+{
+    uint32_t ppm = 0;
+    uint32_t r;
+    uint8_t i;
+    
+    if (whole == 0) {
+        return 0;
+    }
+    
+    while (whole > 400000000UL) {
+        whole >>= 1;
+        part >>= 1;
+    }
+    
+    r = part;
+    for (i = 0; i < 6; i++) {
+        uint8_t digit = 0;
+        
+        r *= 10U;
+        while (r >= whole) {
+            r -= whole;
+            digit++;
+        }
+        ppm = ppm * 10U + digit;
+    }
+    
+    return ppm;
+}
 
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
 
 void stats_init(void)
 {
-    uint16_t magic;
+    tmr16_write(&g_stats.crash_count, 0);
+    tmr32_write(&g_stats.total_uptime_s, 0);
+    tmr32_write(&g_stats.total_downtime_ms, 0);
+    g_stats.gap_open = 0;
+    g_stats.uptime_carry_ms = 0;
+    
+    /* .noinit holds garbage after power-on; a gap only spans WDT resets */
+    if (!wdt_was_reset()) {
+        g_mark.check = ~g_mark.check;
+    }
+    
+    /* Runs before fault_timer_init(), so Timer1 is free for timing */
+    REG_TCCR1A = 0;
+    REG_TCCR1B = 0;
+    REG_TCNT1 = 0;
+    REG_TIFR1 = BIT(TIFR1_TOV1);                /* Writing 1 clears TOV1 */
+    REG_TCCR1B = BIT(TCCR1B_CS11) | BIT(TCCR1B_CS10);
     
-    /* Check for magic number (first boot detection) */
-    magic = eeprom_read_word(EEPROM_ADDR_MAGIC);
+    stats_journal_scan();
     
-    if (magic != EEPROM_MAGIC_VALUE) {
-        /* First boot - initialize EEPROM */
-        g_stats.crash_count = 0;
-        g_stats.total_uptime_ms = 0;
+    g_journal.scan_cycles = (uint32_t)REG_TCNT1 * STATS_SCAN_PRESCALE;
+    REG_TCCR1B = 0;
+    if (BIT_GET(REG_TIFR1, TIFR1_TOV1)) {
+        g_journal.scan_cycles = 0xFFFFFFFFUL;
+    }
+    
+    if (g_journal.seq == STATS_SEQ_ERASED) {
+        /* Empty journal: migrate the old fixed-address layout if present */
+        if (eeprom_read_word(EEPROM_ADDR_MAGIC) == EEPROM_MAGIC_VALUE) {
+            tmr16_write(&g_stats.crash_count, eeprom_read_word(EEPROM_ADDR_CRASH_COUNT));
+            tmr32_write(&g_stats.total_uptime_s, eeprom_read_dword(EEPROM_ADDR_TOTAL_UPTIME) / 1000U);
+            tmr32_write(&g_stats.total_downtime_ms,
+                        (uint32_t)tmr16_read(&g_stats.crash_count) * STATS_LEGACY_DOWNTIME_MS);
+        }
         
-        eeprom_write_word(EEPROM_ADDR_CRASH_COUNT, 0);
-        eeprom_write_dword(EEPROM_ADDR_TOTAL_UPTIME, 0);
-        eeprom_write_word(EEPROM_ADDR_MAGIC, EEPROM_MAGIC_VALUE);
-    } else {
-        /* Load existing statistics */
-        g_stats.crash_count = eeprom_read_word(EEPROM_ADDR_CRASH_COUNT);
-        g_stats.total_uptime_ms = eeprom_read_dword(EEPROM_ADDR_TOTAL_UPTIME);
+        stats_journal_append_boot();
     }
     
     g_stats.session_start = 0;
+    g_stats.uptime_tick = 0;
+    
+    g_stats_scrub = scrub_register(&g_stats, &g_stats_shadow, sizeof(g_stats),
+                                   SCRUB_STATS_LATENCY_MS);
+}
+
+void stats_record_crash(const wdt_crash_record_t *gasp)
+{
+    uint32_t down = STATS_HANG_ESTIMATE_MS;
+    
+    g_stats.uptime_carry_ms = 0;
+    
+    if (stats_mark_valid()) {
+        uint32_t last = g_mark.heartbeat_ms;
+        
+        /* Uptime since the last checkpoint would be lost otherwise */
+        if (g_mark.uptime_s >= tmr32_read(&g_stats.total_uptime_s)) {
+            tmr32_write(&g_stats.total_uptime_s, g_mark.uptime_s + g_mark.uptime_ms / 1000U);
+            g_stats.uptime_carry_ms = g_mark.uptime_ms % 1000U;
+        }
+        
+        if (gasp != 0) {
+            down = gasp->systick_ms + STATS_GASP_TAIL_MS - last;
+        } else if ((0UL - last) < STATS_CARRY_MAX_MS) {
+            /* Died again before a heartbeat: keep what is already down */
+            down = STATS_HANG_ESTIMATE_MS - last;
+        }
+    }
+    
+    /* The new timebase starts near 0: the last heartbeat was 'down' ago */
+    stats_mark_set(0UL - down, g_stats.uptime_carry_ms);
+    g_stats.gap_open = 1;
+    
+    tmr16_write(&g_stats.crash_count, (uint16_t)(tmr16_read(&g_stats.crash_count) + 1U));
+    scrub_commit(g_stats_scrub);
+    stats_journal_append_boot();
 }
 
-void stats_record_crash(void)
+uint32_t stats_heartbeat(void)
 {
-    g_stats.crash_count++;
-    eeprom_update_word(EEPROM_ADDR_CRASH_COUNT, g_stats.crash_count);
+    uint32_t now = systick_get_ms();
+    uint32_t down = 0;
+    
+    if (g_stats.gap_open) {
+        g_stats.gap_open = 0;
+        down = now - g_mark.heartbeat_ms;
+        tmr32_write(&g_stats.total_downtime_ms, tmr32_read(&g_stats.total_downtime_ms) + down);
+        
+        /* Time before this heartbeat is in the gap, not in uptime */
+        g_stats.uptime_tick = now - g_stats.uptime_carry_ms;
+        scrub_commit(g_stats_scrub);
+        stats_journal_append();
+    }
+    
+    stats_mark_set(now, now - g_stats.uptime_tick);
+    
+    return down;
 }
 
 void stats_update_uptime(void)
 {
-    uint32_t session_uptime = systick_get_ms() - g_stats.session_start;
-    g_stats.total_uptime_ms += session_uptime;
-    eeprom_update_dword(EEPROM_ADDR_TOTAL_UPTIME, g_stats.total_uptime_ms);
+    stats_fold_uptime();
+    stats_journal_append();
+    g_checkpoint_tick = systick_get_ms();
+}
+
+void stats_checkpoint_poll(void)
+{
+    uint8_t due = g_journal_deferred ||
+                  (systick_get_ms() - g_checkpoint_tick) >= STATS_CHECKPOINT_MS;
+    
+    /* Wait for room: under the watchdog a full queue must not block */
+    if (due && eeprom_pending() <= STATS_QUEUE_ROOM) {
+        PROBE_BEGIN(PROBE_CHECKPOINT);
+        stats_update_uptime();
+        PROBE_END(PROBE_CHECKPOINT);
+    }
 }
 
 uint16_t stats_get_crash_count(void)
-// ...existing code...
 {
-    return g_stats.crash_count;
+    return tmr16_read(&g_stats.crash_count);
 }
 
 uint32_t stats_get_total_uptime(void)
 {
-    return g_stats.total_uptime_ms;
+    uint32_t consumed;
+    
+    return tmr32_read(&g_stats.total_uptime_s) + stats_unfolded_s(systick_get_ms(), &consumed);
+}
+
+uint32_t stats_get_total_downtime(void)
+{
+    return tmr32_read(&g_stats.total_downtime_ms);
 }
 
 uint32_t stats_get_session_uptime(void)
@@ -61,36 +427,66 @@ uint32_t stats_get_session_uptime(void)
     return systick_get_ms() - g_stats.session_start;
 }
 
-uint8_t stats_get_availability(void)
+uint32_t stats_get_availability_ppm(void)
 {
-    uint32_t total_uptime;
-    uint32_t total_downtime;
-    uint32_t total_time;
+    uint32_t consumed;
+    uint32_t up_s;
+    uint32_t down_ms = tmr32_read(&g_stats.total_downtime_ms);
+    uint32_t down_s;
+    
+    if (down_ms == 0) {
+        return STATS_PPM_ONE;
+    }
     
-    total_uptime = g_stats.total_uptime_ms + stats_get_session_uptime();
+    up_s = tmr32_read(&g_stats.total_uptime_s) + stats_unfolded_s(systick_get_ms(), &consumed);
     
-    if (total_uptime == 0 || g_stats.crash_count == 0) {
-        return 100;
+    /* Millisecond resolution while it fits in 32 bits, seconds after that */
+    if (up_s < 400000UL && down_ms < 400000000UL) {
+        return STATS_PPM_ONE - stats_ppm(down_ms, up_s * 1000U + down_ms);
     }
     
-    /* Assume 2 second recovery per crash (WDT timeout) */
-    total_downtime = (uint32_t)g_stats.crash_count * 2000UL;
-    total_time = total_uptime + total_downtime;
+    down_s = down_ms / 1000U;
+    return STATS_PPM_ONE - stats_ppm(down_s, up_s + down_s);
+}
+
+uint8_t stats_availability_nines(uint32_t ppm)
+{
+    uint32_t unavail = STATS_PPM_ONE - ppm;
+    uint32_t limit = 1;
+    uint8_t nines = 0;
+    uint8_t i;
+    
+    /* 1 nine at <= 10^5 ppm unavailable, 6 at <= 1 ppm */
+    for (i = 0; i < 6; i++) {
+        if (unavail <= limit) {
+            nines++;
+        }
+        limit *= 10U;
+    }
     
-    /* Calculate percentage */
-    return (uint8_t)((total_uptime * 100UL) / total_time);
+    return nines;
 }
 
 void stats_reset(void)
 {
-    g_stats.crash_count = 0;
-    g_stats.total_uptime_ms = 0;
+    tmr16_write(&g_stats.crash_count, 0);
+    tmr32_write(&g_stats.total_uptime_s, 0);
+    tmr32_write(&g_stats.total_downtime_ms, 0);
+    g_stats.uptime_tick = systick_get_ms();
+    scrub_commit(g_stats_scrub);
     
-    eeprom_write_word(EEPROM_ADDR_CRASH_COUNT, 0);
-    eeprom_write_dword(EEPROM_ADDR_TOTAL_UPTIME, 0);
+    stats_journal_append();
 }
 
 void stats_session_start(void)
 {
     g_stats.session_start = systick_get_ms();
+    g_stats.uptime_tick = g_stats.session_start;
+    scrub_commit(g_stats_scrub);
+    g_checkpoint_tick = g_stats.session_start;
+}
+
+const stats_journal_t *stats_get_journal(void)
+{
+    return &g_journal;
 }
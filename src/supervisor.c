@@ -0,0 +1,137 @@
+
+#include "supervisor.h"
+#include "atmega328p.h"
+#include "timer.h"
+
+
+typedef struct {
+    uint16_t deadline_ms;
+    uint32_t last_ms;           /* Tick of the last check-in seen by poll */
+} sup_task_t;
+
+static sup_task_t g_sup_tasks[SUPERVISOR_MAX_TASKS];
+
+/* Registered tasks, and the subset currently supervised */
+static uint8_t g_sup_registered = 0;
+static uint8_t g_sup_live = 0;
+
+/* Check-in bits set since the last poll (written from ISRs too) */
+static volatile uint8_t g_sup_checkins = 0;
+
+static wdt_timeout_t g_sup_timeout = WDT_2S;
+
+
+/* ============================================================================
+ * REGISTRATION
+ * ============================================================================ */
+
+void supervisor_register(uint8_t task, uint16_t deadline_ms)
+{
+    if (task >= SUPERVISOR_MAX_TASKS) {
+        return;
+    }
+    
+    g_sup_tasks[task].deadline_ms = deadline_ms;
+    g_sup_tasks[task].last_ms = systick_get_ms();
+    g_sup_registered |= (uint8_t)BIT(task);
+    g_sup_live |= (uint8_t)BIT(task);
+}
+
+void supervisor_set_live(uint8_t task, uint8_t live)
+{
+    uint8_t mask = (uint8_t)BIT(task);
+    
+    if (!(g_sup_registered & mask)) {
+        return;
+    }
+    
+    if (live) {
+        g_sup_tasks[task].last_ms = systick_get_ms();
+        g_sup_live |= mask;
+    } else {
+        g_sup_live &= (uint8_t)~mask;
+    }
+}
+
+uint16_t supervisor_timeout_ms(wdt_timeout_t timeout)
+{
+    return (uint16_t)(16U << timeout);
+}
+
+void supervisor_start(void)
+{
+    uint16_t tightest = 0xFFFF;
+    uint32_t now = systick_get_ms();
+    uint8_t i;
+    
+    for (i = 0; i < SUPERVISOR_MAX_TASKS; i++) {
+        if (g_sup_registered & BIT(i)) {
+            g_sup_tasks[i].last_ms = now;
+            if (g_sup_tasks[i].deadline_ms < tightest) {
+                tightest = g_sup_tasks[i].deadline_ms;
+            }
+        }
+    }
+    
+    /* Longest period that still fits the tightest deadline (16 ms minimum) */
+    g_sup_timeout = WDT_16MS;
+    while (g_sup_timeout < WDT_8S &&
+           supervisor_timeout_ms((wdt_timeout_t)(g_sup_timeout + 1)) <= tightest) {
+        g_sup_timeout = (wdt_timeout_t)(g_sup_timeout + 1);
+    }
+    
+    g_sup_checkins = 0;
+    g_wdt_stalled = 0;
+    wdt_init(g_sup_timeout);
+}
+
+wdt_timeout_t supervisor_get_timeout(void)
+{
+    return g_sup_timeout;
+}
+
+/* ============================================================================
+ * RUNTIME
+ * ============================================================================ */
+
+void supervisor_checkin(uint8_t task)
+{
+    /* Read-modify-write: an ISR check-in must not land in between */
+    CRITICAL_SECTION_BEGIN;
+    g_sup_checkins |= (uint8_t)BIT(task);
+    CRITICAL_SECTION_END;
+}
+
+void supervisor_poll(void)
+{
+    uint32_t now = systick_get_ms();
+    uint8_t checkins;
+    uint8_t stalled = 0;
+    uint8_t i;
+    
+    CRITICAL_SECTION_BEGIN;
+    checkins = g_sup_checkins;
+    g_sup_checkins = 0;
+    CRITICAL_SECTION_END;
+    
+    for (i = 0; i < SUPERVISOR_MAX_TASKS; i++) {
+        uint8_t mask = (uint8_t)BIT(i);
+        
+        if (!(g_sup_live & mask)) {
+            continue;
+        }
+        
+        if (checkins & mask) {
+            g_sup_tasks[i].last_ms = now;
+        } else if ((now - g_sup_tasks[i].last_ms) > g_sup_tasks[i].deadline_ms) {
+            stalled |= mask;
+        }
+    }
+    
+    /* Reported in the crash record if the watchdog fires */
+    g_wdt_stalled = stalled;
+    
+    if (stalled == 0) {
+        wdt_kick();
+    }
+}
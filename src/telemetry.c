@@ -0,0 +1,188 @@
+
+#include "telemetry.h"
+#include "uart.h"
+#include "crc.h"
+
+
+/* Raw frame being assembled (type + payload + CRC) */
+static uint8_t g_frame[TLM_MAX_FRAME];
+static uint8_t g_frame_len = 0;
+
+
+/* ============================================================================
+ * COBS ENCODER
+ * ============================================================================ */
+
+/*
+ * Consistent Overhead Byte Stuffing: every zero in the frame is replaced by
+ * the distance to the next zero, so 0x00 only ever appears as the delimiter.
+ * Frames are shorter than 254 bytes, so no 0xFF block splitting is needed.
+ */
+static void tlm_cobs_send(const uint8_t *src, uint8_t len)
+{
+    uint8_t i = 0;
+    uint8_t k;
+    
+    for (;;) {
+        uint8_t run = 0;
+        
+        while ((uint8_t)(i + run) < len && src[i + run] != 0) {
+            run++;
+        }
+        
+        uart_putc((char)(run + 1));
+        for (k = 0; k < run; k++) {
+            uart_putc((char)src[i + k]);
+        }
+        
+        i += run;
+        if (i >= len) {
+            break;
+        }
+        
+        /* Skip the zero that ended this block */
+        i++;
+    }
+    
+    uart_putc('\0');
+}
+
+/* ============================================================================
+ * FRAME BUILDER
+ * ============================================================================ */
+
+void telemetry_begin(void)
+{
+    uart_putc('\0');
+}
+
+void tlm_frame_begin(uint8_t type)
+{
+    g_frame[0] = type;
+    g_frame_len = 1;
+}
+
+void tlm_frame_put_u8(uint8_t value)
+{
+    /* Leave room for the CRC */
+    if (g_frame_len < TLM_MAX_FRAME - 2) {
+        g_frame[g_frame_len++] = value;
+    }
+}
+
+void tlm_frame_put_u16(uint16_t value)
+{
+    tlm_frame_put_u8((uint8_t)value);
+    tlm_frame_put_u8((uint8_t)(value >> 8));
+}
+
+void tlm_frame_put_u32(uint32_t value)
+{
+    tlm_frame_put_u16((uint16_t)value);
+    tlm_frame_put_u16((uint16_t)(value >> 16));
+}
+
+void tlm_frame_end(void)
+{
+    uint16_t crc = crc16_ccitt(g_frame, g_frame_len);
+    
+    g_frame[g_frame_len++] = (uint8_t)crc;
+    g_frame[g_frame_len++] = (uint8_t)(crc >> 8);
+    
+    tlm_cobs_send(g_frame, g_frame_len);
+}
+
+/* ============================================================================
+ * RECORDS
+ * ============================================================================ */
+
+void telemetry_heartbeat(uint32_t counter, uint32_t uptime_ms, uint16_t faults)
+{
+    tlm_frame_begin(TLM_REC_HEARTBEAT);
+    tlm_frame_put_u32(counter);
+    tlm_frame_put_u32(uptime_ms);
+    tlm_frame_put_u16(faults);
+    tlm_frame_end();
+}
+
+void telemetry_fault(uint32_t counter, int32_t delta, uint16_t faults)
+{
+    tlm_frame_begin(TLM_REC_FAULT);
+    tlm_frame_put_u32(counter);
+    tlm_frame_put_u32((uint32_t)delta);
+    tlm_frame_put_u16(faults);
+    tlm_frame_end();
+}
+
+void telemetry_crash(uint16_t crashes, uint8_t reset_reason)
+{
+    tlm_frame_begin(TLM_REC_CRASH);
+    tlm_frame_put_u16(crashes);
+    tlm_frame_put_u8(reset_reason);
+    tlm_frame_end();
+}
+
+void telemetry_crash_info(uint16_t pc, uint16_t sp, uint8_t sreg,
+                          uint32_t systick_ms, uint16_t faults, uint8_t task,
+                          uint8_t stalled, uint8_t cause)
+{
+    tlm_frame_begin(TLM_REC_CRASH_INFO);
+    tlm_frame_put_u16(pc);
+    tlm_frame_put_u16(sp);
+    tlm_frame_put_u8(sreg);
+    tlm_frame_put_u32(systick_ms);
+    tlm_frame_put_u16(faults);
+    tlm_frame_put_u8(task);
+    tlm_frame_put_u8(stalled);
+    tlm_frame_put_u8(cause);
+    tlm_frame_end();
+}
+
+void telemetry_recovery(uint32_t downtime_ms, uint32_t total_downtime_ms)
+{
+    tlm_frame_begin(TLM_REC_RECOVERY);
+    tlm_frame_put_u32(downtime_ms);
+    tlm_frame_put_u32(total_downtime_ms);
+    tlm_frame_end();
+}
+
+void telemetry_settings(uint8_t ok, uint8_t mode, uint8_t interval_sec, uint8_t armed,
+                        uint8_t arrival)
+{
+    tlm_frame_begin(TLM_REC_SETTINGS);
+    tlm_frame_put_u8(ok);
+    tlm_frame_put_u8(mode);
+    tlm_frame_put_u8(interval_sec);
+    tlm_frame_put_u8(armed);
+    tlm_frame_put_u8(arrival);
+    tlm_frame_end();
+}
+
+void telemetry_jitter(uint8_t task, const periodic_t *timer)
+{
+    uint8_t b;
+    
+    tlm_frame_begin(TLM_REC_JITTER);
+    tlm_frame_put_u8(task);
+    tlm_frame_put_u16((uint16_t)(timer->interval_us / 1000UL));
+    tlm_frame_put_u16(timer->skipped);
+    for (b = 0; b < PERIODIC_HIST_BUCKETS; b++) {
+        tlm_frame_put_u16(timer->hist[b]);
+    }
+    tlm_frame_end();
+}
+
+void telemetry_summary(uint32_t uptime_ms, uint32_t counter, uint16_t faults,
+                       uint16_t crashes, uint32_t avail_ppm,
+                       uint32_t downtime_ms, uint16_t drops)
+{
+    tlm_frame_begin(TLM_REC_SUMMARY);
+    tlm_frame_put_u32(uptime_ms);
+    tlm_frame_put_u32(counter);
+    tlm_frame_put_u16(faults);
+    tlm_frame_put_u16(crashes);
+    tlm_frame_put_u32(avail_ppm);
+    tlm_frame_put_u32(downtime_ms);
+    tlm_frame_put_u16(drops);
+    tlm_frame_end();
+}
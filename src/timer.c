@@ -2,20 +2,92 @@
 #include "timer.h"
 #include "atmega328p.h"
 #include "config.h"
+#include "probe.h"
+#include "fault_inject.h"
+#include "protect.h"
+#include "scrub.h"
+#include "stack.h"
+#include "wdt.h"
 #include <avr/interrupt.h>
 
 
-/* System tick counter (1ms resolution) */
-static volatile uint32_t g_systick_ms = 0;
+/*
+ * Timebase: Timer0 free-running in normal mode, extended in software by an
+ * overflow ISR. The ISR fires every 256 ticks instead of every millisecond,
+ * and also carries a millisecond count (whole ms + leftover microseconds)
+ * so systick_get_ms() never has to divide a 32-bit value.
+ */
+#if SYSTICK_PRESCALER == 64
+#define SYSTICK_CS          (BIT(TCCR0B_CS01) | BIT(TCCR0B_CS00))
+#elif SYSTICK_PRESCALER == 256
+#define SYSTICK_CS          BIT(TCCR0B_CS02)
+#elif SYSTICK_PRESCALER == 1024
+#define SYSTICK_CS          (BIT(TCCR0B_CS02) | BIT(TCCR0B_CS00))
+#else
+#error "SYSTICK_PRESCALER must be 64, 256 or 1024"
+#endif
+
+#define SYSTICK_OVF_US      (256UL * SYSTICK_TICK_US)
+#define SYSTICK_OVF_MS      (SYSTICK_OVF_US / 1000U)
+#define SYSTICK_OVF_FRAC_US (SYSTICK_OVF_US % 1000U)
+
+/*
+ * Triplicated: every timeout, deadline and uptime figure derives from
+ * these, and a flipped high bit would otherwise stay for the whole session.
+ */
+
+/* Software extension of TCNT0 (counts overflows) */
+static volatile tmr32_t g_systick_ovf;
+
+/* Milliseconds at the last overflow, plus the microseconds left over */
+static volatile tmr32_t g_systick_ms;
+static volatile tmr16_t g_systick_frac_us;
 
 /* Fault injection statistics */
 static volatile uint16_t g_fault_count = 0;
 static volatile uint8_t g_fault_flag = 0;
 
+/*
+ * Timer1 free-runs at /1024 (64 us ticks) and OCR1A is advanced by each
+ * gap drawn by fault_arrival_gap(), so arrival times never drift with ISR
+ * latency. Gaps are served in steps that fit the 16-bit compare;
+ * g_fault_left holds the ticks still to go after the current step.
+ */
+static uint32_t g_fault_mean = 0;
+static uint32_t g_fault_left = 0;
+static uint16_t g_fault_compare = 0;
+
+/* Scrubber regions over g_fault_count and g_fault_mean, with repair copies */
+static uint16_t g_fault_count_shadow;
+static uint32_t g_fault_mean_shadow;
+static uint8_t g_fault_count_scrub = SCRUB_NONE;
+static uint8_t g_fault_mean_scrub = SCRUB_NONE;
+
+#define FAULT_TIMER_HZ          (F_CPU / 1024UL)
 
-ISR(TIMER0_COMPA_vect)
+
+ISR(TIMER0_OVF_vect)
 {
-    g_systick_ms++;
+    PROBE_ISR_BEGIN(PROBE_SYSTICK_ISR);
+    uint16_t frac = tmr16_read(&g_systick_frac_us) + SYSTICK_OVF_FRAC_US;
+    uint32_t ms = tmr32_read(&g_systick_ms) + SYSTICK_OVF_MS;
+    
+    if (frac >= 1000U) {
+        frac -= 1000U;
+        ms++;
+    }
+    
+    tmr16_write(&g_systick_frac_us, frac);
+    tmr32_write(&g_systick_ms, ms);
+    tmr32_write(&g_systick_ovf, tmr32_read(&g_systick_ovf) + 1U);
+    
+    fault_stuck_hold();
+    
+    /* Every tick, so an overflow is caught before it reaches .noinit and .bss */
+    if (!stack_guard_intact()) {
+        wdt_stack_overflow(REG_SP);
+    }
+    PROBE_ISR_END(PROBE_SYSTICK_ISR);
 }
 
 
@@ -25,43 +97,85 @@ void systick_init(void)
     REG_TCCR0A = 0;
     REG_TCCR0B = 0;
     REG_TCNT0 = 0;
+    BIT_SET(REG_TIFR0, TIFR0_TOV0);
     
     /*
-     * CTC Mode (Clear Timer on Compare Match)
-     * WGM01 = 1, WGM00 = 0, WGM02 = 0
+     * Normal mode (WGM0 = 0): counts 0..255 and wraps, setting TOV0.
+     * Timer frequency = F_CPU / SYSTICK_PRESCALER (250 kHz at /64)
      */
-    BIT_SET(REG_TCCR0A, TCCR0A_WGM01);
+    REG_TCCR0B = SYSTICK_CS;
     
-    /*
-     * Prescaler = 64
-     * CS01 = 1, CS00 = 1
-     * Timer frequency = 16MHz / 64 = 250kHz
-     */
-    BIT_SET(REG_TCCR0B, TCCR0B_CS01);
-    BIT_SET(REG_TCCR0B, TCCR0B_CS00);
+    /* Enable Overflow interrupt */
+    BIT_SET(REG_TIMSK0, TIMSK0_TOIE0);
     
-    /*
-     * Compare value for 1ms interrupt
-     * OCR0A = (F_CPU / Prescaler / 1000Hz) - 1
-// ...existing code...
-     * OCR0A = (16000000 / 64 / 1000) - 1 = 249
-     */
-    REG_OCR0A = 249;
+    /* The fault timer is set up again on every settings change: register here, once */
+    g_fault_count_scrub = scrub_register(&g_fault_count, &g_fault_count_shadow,
+                                         sizeof(g_fault_count), SCRUB_FAULT_LATENCY_MS);
+    g_fault_mean_scrub = scrub_register(&g_fault_mean, &g_fault_mean_shadow,
+                                        sizeof(g_fault_mean), SCRUB_FAULT_LATENCY_MS);
+}
+
+/*
+ * Consistent (overflow count, TCNT0) pair. Interrupts must be disabled.
+ * An overflow that happened after interrupts went off is still pending in
+ * TOV0; it belongs to this reading if TCNT0 has wrapped (small value).
+ */
+static inline uint8_t systick_sample(uint32_t *ovf)
+{
+    uint8_t tcnt = REG_TCNT0;
     
-    /* Enable Compare Match A interrupt */
-    BIT_SET(REG_TIMSK0, TIMSK0_OCIE0A);
+    *ovf = tmr32_read(&g_systick_ovf);
+    if (BIT_GET(REG_TIFR0, TIFR0_TOV0) && tcnt < 128U) {
+        (*ovf)++;
+    }
+    
+    return tcnt;
+}
+
+uint32_t systick_get_ticks(void)
+{
+    uint32_t ovf;
+    uint8_t tcnt;
+    
+    CRITICAL_SECTION_BEGIN;
+    tcnt = systick_sample(&ovf);
+    CRITICAL_SECTION_END;
+    
+    return (ovf << 8) | tcnt;
+}
+
+uint32_t systick_get_us(void)
+{
+    return systick_get_ticks() * SYSTICK_TICK_US;
 }
 
 uint32_t systick_get_ms(void)
 {
-    uint32_t ticks;
+    uint32_t ms;
+    uint32_t ovf;
+    uint16_t us;
+    uint8_t tcnt;
     
-    /* Atomic read of 32-bit value */
+    /* Atomic read of the ISR's millisecond state plus the live counter */
     CRITICAL_SECTION_BEGIN;
-    ticks = g_systick_ms;
+    tcnt = systick_sample(&ovf);
+    ms = tmr32_read(&g_systick_ms);
+    us = tmr16_read(&g_systick_frac_us);
+    /* .a was voted by systick_sample(): no second vote needed */
+    if (ovf != g_systick_ovf.a) {
+        us += SYSTICK_OVF_FRAC_US;
+        ms += SYSTICK_OVF_MS;
+    }
     CRITICAL_SECTION_END;
     
-    return ticks;
+    /* us < 2000 + one overflow period: at most 18 steps (at /1024) */
+    us += (uint16_t)tcnt * SYSTICK_TICK_US;
+    while (us >= 1000U) {
+        us -= 1000U;
+        ms++;
+    }
+    
+    return ms;
 }
 
 uint8_t systick_elapsed(uint32_t *last_tick, uint32_t interval_ms)
@@ -84,24 +198,108 @@ void delay_ms(uint16_t ms)
     }
 }
 
+/* ============================================================================
+ * PERIODIC TIMERS
+ * ============================================================================ */
+
+void periodic_start(periodic_t *p, uint16_t interval_ms)
+{
+    p->interval_us = (uint32_t)interval_ms * 1000UL;
+    p->due_us = systick_get_us() + p->interval_us;
+    periodic_reset_stats(p);
+}
+
+void periodic_advance(periodic_t *p, uint32_t now_us)
+{
+    int32_t late = (int32_t)(now_us - p->due_us);
+    uint32_t v;
+    uint8_t b = 0;
+    
+    if (late < 0) {
+        late = 0;
+    }
+    
+    for (v = (uint32_t)late >> 4; v != 0 && b < PERIODIC_HIST_BUCKETS - 1U; v >>= 1) {
+        b++;
+    }
+    if (p->hist[b] != 0xFFFF) {
+        p->hist[b]++;
+    }
+    
+    p->due_us += p->interval_us;
+    
+    /* Whole periods already gone: skip them, keeping the phase */
+    if ((uint32_t)late >= p->interval_us) {
+        uint32_t gone = (uint32_t)late / p->interval_us;
+        
+        p->due_us += gone * p->interval_us;
+        p->skipped = (gone >= 0xFFFFUL - p->skipped) ? 0xFFFFU : (uint16_t)(p->skipped + gone);
+    }
+}
+
+uint8_t periodic_elapsed(periodic_t *p)
+{
+    uint32_t now = systick_get_us();
+    
+    if (!periodic_expired(p, now)) {
+        return 0;
+    }
+    
+    periodic_advance(p, now);
+    return 1;
+}
+
+void periodic_reset_stats(periodic_t *p)
+{
+    uint8_t b;
+    
+    p->skipped = 0;
+    for (b = 0; b < PERIODIC_HIST_BUCKETS; b++) {
+        p->hist[b] = 0;
+    }
+}
+
 /* ============================================================================
  * TIMER1 - FAULT INJECTION FUNCTIONS
  * ============================================================================ */
 
+/*
+ * Move the compare point on by the next step. Gaps of 65536 ticks or more
+ * go in 32768-tick steps, so the last step is never short and OCR1A stays
+ * well ahead of TCNT1.
+ */
+static void fault_timer_load(void)
+{
+    uint32_t left = g_fault_left;
+    uint16_t step = (left > 65535UL) ? 32768U : (uint16_t)left;
+    
+    g_fault_left = left - step;
+    g_fault_compare = (uint16_t)(g_fault_compare + step);
+    REG_OCR1A = g_fault_compare;
+}
+
 void fault_timer_init(uint8_t interval_sec)
 {
+    if (interval_sec == 0) {
+        interval_sec = 1;
+    }
+    
     /* Reset Timer1 */
     REG_TCCR1A = 0;
     REG_TCCR1B = 0;
     REG_TCNT1 = 0;
+    REG_TIMSK1 = 0;
+    REG_TIFR1 = BIT(TIFR1_OCF1A) | BIT(TIFR1_OCF1B);
     
-    /*
-     * CTC Mode
-     * WGM12 = 1 (CTC mode, TOP = OCR1A)
-     */
-    BIT_SET(REG_TCCR1B, TCCR1B_WGM12);
+    /* The timer is stopped, so the ISR cannot see a half-written gap */
+    g_fault_mean = FAULT_TIMER_HZ * interval_sec;
+    scrub_commit(g_fault_mean_scrub);
+    g_fault_left = fault_arrival_gap(g_fault_mean);
+    g_fault_compare = 0;
+    fault_timer_load();
     
     /*
+     * Normal mode (WGM1 = 0): free-running 0..0xFFFF
      * Prescaler = 1024
      * CS12 = 1, CS10 = 1
      * Timer frequency = 16MHz / 1024 = 15625 Hz
@@ -109,14 +307,6 @@ void fault_timer_init(uint8_t interval_sec)
     BIT_SET(REG_TCCR1B, TCCR1B_CS12);
     BIT_SET(REG_TCCR1B, TCCR1B_CS10);
     
-    /*
-     * Compare value for N second interval
-     * OCR1A = (15625 * interval_sec) - 1
-     */
-    uint16_t compare_val = (uint16_t)(15625UL * interval_sec) - 1;
-    REG_OCR1AH = HIGH_BYTE(compare_val);
-    REG_OCR1AL = LOW_BYTE(compare_val);
-    
     /* Enable Compare Match A interrupt */
     BIT_SET(REG_TIMSK1, TIMSK1_OCIE1A);
 }
@@ -147,6 +337,14 @@ uint16_t fault_get_count(void)
     return count;
 }
 
+void fault_reset_count(void)
+{
+    CRITICAL_SECTION_BEGIN;
+    g_fault_count = 0;
+    scrub_commit(g_fault_count_scrub);
+    CRITICAL_SECTION_END;
+}
+
 uint8_t fault_check_flag(void)
 {
     uint8_t flag;
@@ -163,14 +361,27 @@ uint8_t fault_check_flag(void)
  * TIMER1 - FAULT INJECTION ISR
  * ============================================================================ */
 
-/* Forward declaration - implemented in fault_inject.c */
-extern void fault_inject_execute(void);
-
 ISR(TIMER1_COMPA_vect)
 {
+    PROBE_ISR_BEGIN(PROBE_FAULT_ISR);
+    if (g_fault_left != 0) {
+        /* Still inside a long gap */
+        fault_timer_load();
+        PROBE_ISR_END(PROBE_FAULT_ISR);
+        return;
+    }
+    
+    /*
+     * Schedule the next arrival first: some models do not return
+     */
+    g_fault_left = fault_arrival_gap(g_fault_mean);
+    fault_timer_load();
+    
     g_fault_count++;
+    scrub_commit(g_fault_count_scrub);
     g_fault_flag = 1;
     
     /* Execute fault injection attack */
     fault_inject_execute();
+    PROBE_ISR_END(PROBE_FAULT_ISR);
 }
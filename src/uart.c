@@ -2,11 +2,126 @@
 #include "uart.h"
 #include "atmega328p.h"
 #include "config.h"
+#include "fmt.h"
+#include "probe.h"
 #include <avr/pgmspace.h>
+#include <avr/interrupt.h>
 
 
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0 || UART_TX_BUFFER_SIZE > 256
+#error "UART_TX_BUFFER_SIZE must be a power of two no larger than 256"
+#endif
+
+#if (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0 || UART_RX_BUFFER_SIZE > 256
+#error "UART_RX_BUFFER_SIZE must be a power of two no larger than 256"
+#endif
+
+#define UART_TX_MASK    ((uint8_t)(UART_TX_BUFFER_SIZE - 1))
+#define UART_RX_MASK    ((uint8_t)(UART_RX_BUFFER_SIZE - 1))
+
 /* Conversion buffer for number printing */
-static char uart_conv_buf[12];
+static char uart_conv_buf[FMT_I32_LEN];
+
+/* TX ring buffer: head is written by the producer, tail by the UDRE ISR */
+static volatile char g_tx_buf[UART_TX_BUFFER_SIZE];
+static volatile uint8_t g_tx_head = 0;
+static volatile uint8_t g_tx_tail = 0;
+
+/* Set once a byte has been written to UDR0 (TXC0 is meaningful from then on) */
+static volatile uint8_t g_tx_started = 0;
+
+/* Bytes discarded because the ring was full */
+static uint16_t g_tx_dropped = 0;
+
+/* RX ring buffer: head is written by the RX ISR, tail by the consumer */
+static volatile char g_rx_buf[UART_RX_BUFFER_SIZE];
+static volatile uint8_t g_rx_head = 0;
+static volatile uint8_t g_rx_tail = 0;
+
+/* Bytes lost because the RX ring was full */
+static volatile uint16_t g_rx_overruns = 0;
+
+
+/* ============================================================================
+ * TX ENGINE
+ * ============================================================================ */
+
+ISR(USART_UDRE_vect)
+{
+    uint8_t tail = g_tx_tail;
+
+    if (tail == g_tx_head) {
+        /* Ring drained - stop data register empty interrupts */
+        BIT_CLR(REG_UCSR0B, UCSR0B_UDRIE0);
+        return;
+    }
+
+    REG_UDR0 = g_tx_buf[tail];
+    /* Writing 1 clears TXC0; FE0/DOR0/UPE0 must be written as 0 */
+    REG_UCSR0A = (uint8_t)((REG_UCSR0A & BIT(UCSR0A_U2X0)) | BIT(UCSR0A_TXC0));
+    g_tx_tail = (uint8_t)((tail + 1) & UART_TX_MASK);
+    g_tx_started = 1;
+}
+
+/*
+ * Move one byte from the ring to the data register by polling.
+ * Used when global interrupts are off (boot, crash path), where the
+ * UDRE ISR cannot drain the ring for us. Caller ensures ring is not empty.
+ */
+static void uart_tx_poll(void)
+{
+    uint8_t tail = g_tx_tail;
+
+    while (!BIT_GET(REG_UCSR0A, UCSR0A_UDRE0)) {
+        /* Spin */
+    }
+
+    REG_UDR0 = g_tx_buf[tail];
+    REG_UCSR0A = (uint8_t)((REG_UCSR0A & BIT(UCSR0A_U2X0)) | BIT(UCSR0A_TXC0));
+    g_tx_tail = (uint8_t)((tail + 1) & UART_TX_MASK);
+    g_tx_started = 1;
+}
+
+/* ============================================================================
+ * RX ENGINE
+ * ============================================================================ */
+
+static inline void uart_rx_store(char c)
+{
+    uint8_t head = g_rx_head;
+    uint8_t next = (uint8_t)((head + 1) & UART_RX_MASK);
+
+    if (next == g_rx_tail) {
+        g_rx_overruns++;
+        return;
+    }
+
+    g_rx_buf[head] = c;
+    g_rx_head = next;
+}
+
+ISR(USART_RX_vect)
+{
+    uart_rx_store((char)REG_UDR0);
+}
+
+/* Interrupts off: move a waiting byte into the ring ourselves */
+static void uart_rx_poll(void)
+{
+    if (BIT_GET(REG_UCSR0A, UCSR0A_RXC0)) {
+        uart_rx_store((char)REG_UDR0);
+    }
+}
+
+static inline uint8_t uart_tx_enqueue(char c, uint8_t next)
+{
+    g_tx_buf[g_tx_head] = c;
+    g_tx_head = next;
+
+    /* Kick the ISR; it disables itself once the ring is empty */
+    BIT_SET(REG_UCSR0B, UCSR0B_UDRIE0);
+    return 1;
+}
 
 
 void uart_init(uint32_t baud_rate)
@@ -20,8 +135,8 @@ void uart_init(uint32_t baud_rate)
     REG_UBRR0H = HIGH_BYTE(ubrr_value);
     REG_UBRR0L = LOW_BYTE(ubrr_value);
     
-    /* Enable transmitter and receiver */
-    REG_UCSR0B = BIT(UCSR0B_TXEN0) | BIT(UCSR0B_RXEN0);
+    /* Enable transmitter and receiver (RX is interrupt-fed) */
+    REG_UCSR0B = BIT(UCSR0B_TXEN0) | BIT(UCSR0B_RXEN0) | BIT(UCSR0B_RXCIE0);
     
     /* Frame format: 8 data bits, 1 stop bit, no parity */
     REG_UCSR0C = BIT(UCSR0C_UCSZ01) | BIT(UCSR0C_UCSZ00);
@@ -29,13 +144,63 @@ void uart_init(uint32_t baud_rate)
 
 void uart_putc(char c)
 {
-    /* Wait for transmit buffer to be empty */
-    while (!BIT_GET(REG_UCSR0A, UCSR0A_UDRE0)) {
-        /* Spin */
+#if UART_TX_BLOCKING
+    uint8_t next = (uint8_t)((g_tx_head + 1) & UART_TX_MASK);
+
+    /* Ring full: wait for the ISR (or poll it out ourselves) */
+    while (next == g_tx_tail) {
+        if (!BIT_GET(REG_SREG, SREG_I)) {
+            uart_tx_poll();
+        }
     }
-    
-    /* Write data to transmit buffer */
-    REG_UDR0 = c;
+
+    uart_tx_enqueue(c, next);
+#else
+    (void)uart_try_putc(c);
+#endif
+}
+
+uint8_t uart_try_putc(char c)
+{
+    uint8_t next = (uint8_t)((g_tx_head + 1) & UART_TX_MASK);
+
+    if (next == g_tx_tail) {
+        if (BIT_GET(REG_SREG, SREG_I)) {
+            g_tx_dropped++;
+            return 0;
+        }
+        /* Interrupts off: nobody else will drain the ring */
+        uart_tx_poll();
+    }
+
+    return uart_tx_enqueue(c, next);
+}
+
+void uart_flush(void)
+{
+    /* Wait for the ring to drain */
+    while (g_tx_head != g_tx_tail) {
+        if (!BIT_GET(REG_SREG, SREG_I)) {
+            uart_tx_poll();
+        }
+    }
+
+    /* Wait for the last byte to leave the shift register */
+    if (g_tx_started) {
+        while (!BIT_GET(REG_UCSR0A, UCSR0A_TXC0)) {
+            /* Spin */
+        }
+    }
+}
+
+uint8_t uart_tx_pending(void)
+{
+    return (uint8_t)((g_tx_head - g_tx_tail) & UART_TX_MASK);
+}
+
+uint16_t uart_tx_get_dropped(void)
+{
+    return g_tx_dropped;
 }
 
 void uart_puts(const char *str)
@@ -48,63 +213,62 @@ void uart_puts(const char *str)
 void uart_puts_P(const char *str)
 // ...existing code...
 {
+    PROBE_BEGIN(PROBE_UART_PUTS);
     char c;
     while ((c = pgm_read_byte(str++)) != '\0') {
         uart_putc(c);
     }
+    PROBE_END(PROBE_UART_PUTS);
 }
 
 void uart_put_u8(uint8_t num)
 {
-    uart_put_u32((uint32_t)num);
+    fmt_u8(uart_conv_buf, num);
+    uart_puts(uart_conv_buf);
 }
 
 void uart_put_u16(uint16_t num)
 {
-    uart_put_u32((uint32_t)num);
+    fmt_u16(uart_conv_buf, num);
+    uart_puts(uart_conv_buf);
 }
 
 void uart_put_u32(uint32_t num)
 {
-    char *p = uart_conv_buf + sizeof(uart_conv_buf) - 1;
-    *p = '\0';
-    
-    if (num == 0) {
-        uart_putc('0');
-        return;
-    }
-    
-    while (num > 0) {
-        *--p = '0' + (num % 10);
-        num /= 10;
-    }
-    
-    uart_puts(p);
+    fmt_u32(uart_conv_buf, num);
+    uart_puts(uart_conv_buf);
+}
+
+void uart_put_u32_pad(uint32_t num, uint8_t width, char pad)
+{
+    fmt_u32_pad(uart_conv_buf, num, width, pad);
+    uart_puts(uart_conv_buf);
 }
 
 void uart_put_i32(int32_t num)
 {
-    if (num < 0) {
-        uart_putc('-');
-        num = -num;
-    }
-    uart_put_u32((uint32_t)num);
+    fmt_i32(uart_conv_buf, num);
+    uart_puts(uart_conv_buf);
+}
+
+void uart_put_hex8(uint8_t num)
+{
+    fmt_hex8(uart_conv_buf, num);
+    uart_puts(uart_conv_buf);
+}
+
+void uart_put_hex16(uint16_t num)
+{
+    fmt_hex16(uart_conv_buf, num);
+    uart_puts("0x");
+    uart_puts(uart_conv_buf);
 }
 
 void uart_put_hex32(uint32_t num)
 {
-    static const char hex_chars[] = "0123456789ABCDEF";
-    char buf[9];
-    uint8_t i;
-    
-    for (i = 0; i < 8; i++) {
-        buf[7 - i] = hex_chars[num & 0x0F];
-        num >>= 4;
-    }
-    buf[8] = '\0';
-    
+    fmt_hex32(uart_conv_buf, num);
     uart_puts("0x");
-    uart_puts(buf);
+    uart_puts(uart_conv_buf);
 }
 
 void uart_newline(void)
@@ -115,15 +279,36 @@ void uart_newline(void)
 
 uint8_t uart_available(void)
 {
-    return BIT_GET(REG_UCSR0A, UCSR0A_RXC0);
+    if (!BIT_GET(REG_SREG, SREG_I)) {
+        uart_rx_poll();
+    }
+    
+    return (uint8_t)((g_rx_head - g_rx_tail) & UART_RX_MASK);
 }
 
 char uart_getc(void)
 {
+    uint8_t tail = g_rx_tail;
+    char c;
+    
     /* Wait for data */
     while (!uart_available()) {
         /* Spin */
     }
     
-    return REG_UDR0;
+    c = g_rx_buf[tail];
+    g_rx_tail = (uint8_t)((tail + 1) & UART_RX_MASK);
+    
+    return c;
+}
+
+uint16_t uart_rx_get_overruns(void)
+{
+    uint16_t count;
+    
+    CRITICAL_SECTION_BEGIN;
+    count = g_rx_overruns;
+    CRITICAL_SECTION_END;
+    
+    return count;
 }
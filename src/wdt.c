@@ -1,13 +1,31 @@
 
 #include "wdt.h"
 #include "atmega328p.h"
+#include "eeprom_drv.h"
+#include "timer.h"
+#include "crc.h"
+#include "config.h"
+#include <avr/interrupt.h>
 
 
+#define WDT_CRASH_MAGIC     0xC4A5U
+#define WDT_CRASH_CRC_LEN   (sizeof(wdt_crash_record_t) - sizeof(uint16_t))
+
 /* Store reset reason early before MCUSR is cleared */
 static uint8_t g_reset_reason = 0;
 
+/* Survives the watchdog reset: not zeroed by the C runtime */
+static wdt_crash_record_t g_crash NOINIT;
+
+volatile uint8_t g_wdt_task = 0;
+volatile uint8_t g_wdt_stalled = 0;
 
+
+#ifdef FIRA_HOST
+void wdt_early_init(void);          /* Called by the simulator on each reset */
+#else
 void wdt_early_init(void) __attribute__((naked, used, section(".init3")));
+#endif
 void wdt_early_init(void)
 {
     /* Save reset reason */
@@ -59,6 +77,11 @@ void wdt_init(wdt_timeout_t timeout)
         wdt_value = BIT(WDTCSR_WDE) | (timeout & 0x07);
     }
     
+#if WDT_CRASH_CAPTURE
+    /* Interrupt first (crash capture), reset on the following timeout */
+    wdt_value |= BIT(WDTCSR_WDIE);
+#endif
+    
     /* Disable interrupts during timed sequence */
     INTERRUPTS_DISABLE();
     
@@ -104,12 +127,21 @@ void wdt_kick(void)
 
 void wdt_force_reset(void)
 {
-    /* Enable WDT with shortest timeout */
-    wdt_init(WDT_16MS);
+    /* Don't tear a queued EEPROM record */
+    eeprom_flush();
+    
+    /*
+     * Reset-only mode (no WDIE): a requested reset must not go through the
+     * crash capture and be recorded as a hang
+     */
+    INTERRUPTS_DISABLE();
+    WDT_RESET();
+    REG_WDTCSR = BIT(WDTCSR_WDCE) | BIT(WDTCSR_WDE);
+    REG_WDTCSR = BIT(WDTCSR_WDE) | WDT_TIMEOUT_16MS;
     
     /* Enter infinite loop - WDT will reset us */
     while (1) {
-        /* Wait for reset */
+        NOP();
     }
 }
 
@@ -117,3 +149,137 @@ uint8_t wdt_was_reset(void)
 {
     return (g_reset_reason & BIT(MCUSR_WDRF)) ? 1 : 0;
 }
+
+/* ============================================================================
+ * CRASH CAPTURE (interrupt-then-reset mode)
+ * ============================================================================ */
+
+/* Fill in the record and reset; pc is a byte address */
+static void wdt_capture(uint16_t pc, uint16_t sp, uint8_t sreg, uint8_t cause) __attribute__((noreturn));
+static void wdt_capture(uint16_t pc, uint16_t sp, uint8_t sreg, uint8_t cause)
+{
+    g_crash.pc = pc;
+    g_crash.sp = sp;
+    g_crash.sreg = sreg;
+    g_crash.systick_ms = systick_get_ms();
+    g_crash.faults = fault_get_count();
+    g_crash.task = g_wdt_task;
+    g_crash.stalled = g_wdt_stalled;
+    g_crash.cause = cause;
+    g_crash.magic = WDT_CRASH_MAGIC;
+    g_crash.crc = crc16_ccitt(&g_crash, WDT_CRASH_CRC_LEN);
+    
+    /* Don't wait a second full timeout: reset after 16 ms */
+    WDT_RESET();
+    REG_WDTCSR = BIT(WDTCSR_WDCE) | BIT(WDTCSR_WDE);
+    REG_WDTCSR = BIT(WDTCSR_WDE) | WDT_TIMEOUT_16MS;
+    
+    for (;;) {
+        NOP();
+    }
+}
+
+/*
+ * Entered from the watchdog vector with the interrupted PC (word address),
+ * SP and SREG. The interrupted context is abandoned, so clobbering
+ * registers is fine.
+ *
+ * The vector pops the stacked return address itself and passes it as pc.
+ * Reading it here through sp would only work on the AVR: on the host, SP
+ * is a simulated register value, not a pointer into our own stack.
+ */
+void wdt_last_gasp(uint16_t pc, uint16_t sp, uint8_t sreg) __attribute__((used, noreturn));
+void wdt_last_gasp(uint16_t pc, uint16_t sp, uint8_t sreg)
+{
+    /* SREG.I is cleared by the vector */
+    wdt_capture((uint16_t)(pc << 1), sp, (uint8_t)(sreg | BIT(SREG_I)), WDT_CAUSE_HANG);
+}
+
+/* No interrupted PC worth keeping: the guard is checked from the systick ISR */
+static void wdt_stack_capture(uint16_t sp, uint8_t sreg) __attribute__((used, noreturn));
+static void wdt_stack_capture(uint16_t sp, uint8_t sreg)
+{
+    wdt_capture(0, sp, sreg, WDT_CAUSE_STACK);
+}
+
+#ifdef FIRA_HOST
+void wdt_stack_overflow(uint16_t sp)
+{
+    uint8_t sreg = REG_SREG;
+    
+    INTERRUPTS_DISABLE();
+    wdt_stack_capture(sp, sreg);
+}
+#else
+void wdt_stack_overflow(uint16_t sp) __attribute__((naked));
+void wdt_stack_overflow(uint16_t sp)
+{
+    /*
+     * The stack is already at or below the guard, with .noinit (g_crash)
+     * right underneath. The interrupted context is abandoned, so move SP
+     * back to the top of RAM and run the capture (and crc16_ccitt) from
+     * there: wdt_stack_capture(sp = r25:r24, sreg = r22)
+     */
+    __asm__ __volatile__ (
+        "in   r22, __SREG__"        "\n\t"
+        "cli"                       "\n\t"
+        "ldi  r26, lo8(__stack)"    "\n\t"
+        "ldi  r27, hi8(__stack)"    "\n\t"
+        "out  __SP_H__, r27"        "\n\t"
+        "out  __SP_L__, r26"        "\n\t"
+        "jmp  %x0"                  "\n\t"
+        :: "i" (wdt_stack_capture)
+    );
+}
+#endif
+
+#ifdef FIRA_HOST
+ISR(WDT_vect)
+{
+    /* No AVR call stack on the host: PC is unknown */
+    wdt_last_gasp(0, REG_SP, REG_SREG);
+}
+#else
+ISR(WDT_vect, ISR_NAKED)
+{
+    /*
+     * Grab SREG and SP before anything touches them, pop the stacked
+     * return address (high byte on top) and tail-jump:
+     * wdt_last_gasp(pc = r25:r24, sp = r23:r22, sreg = r20)
+     *
+     * sp is advanced past the two popped bytes, so it is the interrupted
+     * SP, the same value the old in-C stack read stored (SP + 2).
+     */
+    __asm__ __volatile__ (
+        "in   r20, __SREG__"        "\n\t"
+        "clr  __zero_reg__"         "\n\t"
+        "in   r22, __SP_L__"        "\n\t"
+        "in   r23, __SP_H__"        "\n\t"
+        "pop  r25"                  "\n\t"
+        "pop  r24"                  "\n\t"
+        "subi r22, lo8(-2)"         "\n\t"
+        "sbci r23, hi8(-2)"         "\n\t"
+        "jmp  %x0"                  "\n\t"
+        :: "i" (wdt_last_gasp)
+    );
+}
+#endif
+
+uint8_t wdt_crash_record_take(wdt_crash_record_t *out)
+{
+    uint8_t valid;
+    
+    /* .noinit holds garbage after power-on; only trust it after a WDT reset */
+    valid = wdt_was_reset() &&
+            g_crash.magic == WDT_CRASH_MAGIC &&
+            crc16_ccitt(&g_crash, WDT_CRASH_CRC_LEN) == g_crash.crc;
+    
+    if (valid) {
+        *out = g_crash;
+    }
+    
+    /* Report each record once */
+    g_crash.magic = 0;
+    
+    return valid;
+}
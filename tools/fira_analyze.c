@@ -0,0 +1,1095 @@
+/*
+ * ============================================================================
+ * FIRA - Log Analyzer
+ * Offline research summary of serial captures and fira_logger.py CSVs
+ * ============================================================================
+ *
+ * Prints the report of fira_logger.py's main() for a file instead of a
+ * live port, at memory bandwidth instead of regex speed:
+ *
+ *   - the file is mapped, never copied or split into line strings
+ *   - 64-byte blocks are classified with SSE2/AVX2 compares into bitmasks
+ *     of line ends, 0x00 frame delimiters and ':' (every text pattern the
+ *     logger looks for is a keyword followed by a colon)
+ *   - only the colons are looked at: the bytes before one tell which
+ *     keyword it closes, a hand-written scanner reads the number after it
+ *
+ * The patterns are those of parse_heartbeat(), parse_crash(),
+ * parse_downtime() and parse_bitflip(), including which match wins when a
+ * line holds several. Binary telemetry is split like TelemetryStream:
+ * COBS frames with a CRC-16/CCITT, text again after a frame that fails to
+ * decode or a run of more than 256 bytes without a 0x00. A line with no
+ * line end at the end of the file is dropped, as the logger never sees it.
+ *
+ * Input is either a raw capture of the UART (fira_host > capture.log, a
+ * serial terminal log) or the CSV the logger writes, recognised by its
+ * header row. Only the CSV has timestamps: the session duration and the
+ * host-side downtime fallback (heartbeat gaps around crashes) need them
+ * and are unknown for a raw capture.
+ *
+ * Usage:
+ *   fira_analyze [--scalar] capture.log|log.csv
+ *   fira_analyze --bench MB [--passes N] [--scalar] capture.log|log.csv
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+#define ANA_BLOCK           64U
+#define ANA_MAX_CHUNK       256U            /* TLM_MAX_CHUNK in fira_logger.py */
+#define ANA_MAX_FRAME       64U             /* Longer chunks cannot be a record */
+#define ANA_CSV_FIELDS      6U              /* Fields before raw_line */
+#define ANA_PASSES          5U
+
+static const char csv_header[] = "timestamp,counter,uptime_sec,faults,crashes,bitflip_jump,raw_line";
+static const char flip_marker[] = "BIT FLIP DETECTED";
+
+/* Binary telemetry records (include/telemetry.h) */
+enum {
+    TLM_REC_HEARTBEAT   = 0x01,
+    TLM_REC_FAULT       = 0x02,
+    TLM_REC_CRASH       = 0x03,
+    TLM_REC_SUMMARY     = 0x04,
+    TLM_REC_CRASH_INFO  = 0x05,
+    TLM_REC_RECOVERY    = 0x06,
+    TLM_REC_SETTINGS    = 0x07,
+    TLM_REC_JITTER      = 0x08,
+    TLM_REC_COUNT
+};
+
+/* Payload bytes per record type, 0 = unknown */
+static const uint8_t tlm_payload[TLM_REC_COUNT] = {
+    0, 10, 10, 3, 22, 14, 8, 5, 29
+};
+
+
+/* ============================================================================
+ * STATE
+ * ============================================================================ */
+
+/* What one line or record contributes (the logger's parse results) */
+typedef struct {
+    uint8_t  heartbeat;
+    uint8_t  crash;
+    uint8_t  downtime;
+    uint8_t  bitflip;
+    uint64_t counter;
+    uint64_t uptime;            /* Seconds */
+    uint64_t faults;
+    uint64_t crashes;
+    uint64_t downtime_ms;
+    int64_t  jump;
+} match_t;
+
+/* Text line being scanned */
+typedef struct {
+    const char *start;
+    const char *limit;          /* Number scanners stop here */
+    const char *counter_end;    /* End of "Counter: N", 0 = none yet */
+    const char *flip;           /* End of the first BIT FLIP DETECTED, 0 = none yet */
+    uint8_t  uptime_ok;
+    uint64_t uptime;            /* Last "Running: Ns" after the counter */
+    match_t  m;
+} line_t;
+
+/* fira_logger.py's stats dict */
+typedef struct {
+    uint64_t samples;
+    uint64_t max_uptime;
+    uint64_t total_crashes;
+    uint64_t total_faults;
+    uint8_t  have_fw_downtime;
+    uint64_t fw_downtime_ms;
+    double   host_downtime_sec;
+    double   last_heartbeat;
+    uint8_t  have_last_heartbeat;
+    uint8_t  gap_open;
+    int64_t *bitflips;
+    size_t   bitflip_count;
+    size_t   bitflip_cap;
+    double   first_time;
+    uint8_t  have_time;
+    uint64_t lines;
+    uint64_t frames;
+} stats_t;
+
+static stats_t g_stats;
+static uint8_t g_csv = 0;
+static uint8_t g_scalar = 0;
+static const char *g_last_row = NULL;
+
+
+/* ============================================================================
+ * CLASSIFICATION
+ * ============================================================================ */
+
+/* Bit i of each mask: byte i of the block is '\n', ':' or 0x00 */
+static inline void classify_scalar(const uint8_t *b, uint64_t *nl, uint64_t *colon, uint64_t *zero)
+{
+    uint64_t n = 0, c = 0, z = 0;
+    unsigned i;
+
+    for (i = 0; i < ANA_BLOCK; i++) {
+        n |= (uint64_t)(b[i] == '\n') << i;
+        c |= (uint64_t)(b[i] == ':') << i;
+        z |= (uint64_t)(b[i] == 0) << i;
+    }
+    *nl = n;
+    *colon = c;
+    *zero = z;
+}
+
+#if defined(__AVX2__)
+
+static inline uint64_t mask_avx2(__m256i lo, __m256i hi, __m256i v)
+{
+    uint32_t a = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v));
+    uint32_t b = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v));
+
+    return (uint64_t)a | ((uint64_t)b << 32);
+}
+
+static inline void classify_simd(const uint8_t *b, uint64_t *nl, uint64_t *colon, uint64_t *zero)
+{
+    __m256i lo = _mm256_loadu_si256((const __m256i *)b);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(b + 32));
+
+    *nl = mask_avx2(lo, hi, _mm256_set1_epi8('\n'));
+    *colon = mask_avx2(lo, hi, _mm256_set1_epi8(':'));
+    *zero = mask_avx2(lo, hi, _mm256_setzero_si256());
+}
+
+#elif defined(__SSE2__)
+
+static inline uint64_t mask_sse2(const __m128i *q, __m128i v)
+{
+    uint64_t m = 0;
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(q[i], v)) << (16 * i);
+    }
+    return m;
+}
+
+static inline void classify_simd(const uint8_t *b, uint64_t *nl, uint64_t *colon, uint64_t *zero)
+{
+    __m128i q[4];
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        q[i] = _mm_loadu_si128((const __m128i *)(b + 16 * i));
+    }
+    *nl = mask_sse2(q, _mm_set1_epi8('\n'));
+    *colon = mask_sse2(q, _mm_set1_epi8(':'));
+    *zero = mask_sse2(q, _mm_setzero_si128());
+}
+
+#else
+
+#define classify_simd classify_scalar
+
+#endif
+
+static const char *simd_name(void)
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "none";
+#endif
+}
+
+
+/* ============================================================================
+ * TEXT SCANNERS
+ * ============================================================================ */
+
+/* \s inside a line (line breaks never get here) */
+static inline const char *skip_space(const char *p, const char *limit)
+{
+    while (p < limit && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+/* \d+, 0 if there is no digit */
+static inline const char *scan_u64(const char *p, const char *limit, uint64_t *value)
+{
+    const char *first = p;
+    uint64_t v = 0;
+
+    while (p < limit && (uint8_t)(*p - '0') < 10) {
+        v = v * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+    *value = v;
+    return p == first ? NULL : p;
+}
+
+static inline int ends_with(const line_t *l, const char *colon, const char *kw, size_t n)
+{
+    return (size_t)(colon - l->start) >= n && memcmp(colon - n, kw, n) == 0;
+}
+
+/* Same, ignoring case (re.IGNORECASE); kw is lower case */
+static inline int ends_with_nocase(const line_t *l, const char *colon, const char *kw, size_t n)
+{
+    const char *p = colon - n;
+    size_t i;
+
+    if ((size_t)(colon - l->start) < n) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        char c = p[i];
+
+        if (kw[i] >= 'a' && kw[i] <= 'z') {
+            c |= 0x20;
+        }
+        if (c != kw[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#define KEYWORD(l, c, kw)           ends_with(l, c, kw, sizeof(kw) - 1)
+#define KEYWORD_NOCASE(l, c, kw)    ends_with_nocase(l, c, kw, sizeof(kw) - 1)
+
+static inline void line_begin(line_t *l, const char *start, const char *limit)
+{
+    l->start = start;
+    l->limit = limit;
+    l->counter_end = NULL;
+    l->flip = NULL;
+    l->uptime_ok = 0;
+    l->m.heartbeat = 0;
+    l->m.crash = 0;
+    l->m.downtime = 0;
+    l->m.bitflip = 0;
+}
+
+/* "Total crashes(?: so far)?:\s*(\d+)", first match wins */
+static void scan_crash(line_t *l, const char *p)
+{
+    uint64_t v;
+
+    if (!l->m.crash && scan_u64(skip_space(p, l->limit), l->limit, &v)) {
+        l->m.crash = 1;
+        l->m.crashes = v;
+    }
+}
+
+/* "Total (?:downtime|time down):\s*(\d+)\s*ms", first match wins */
+static void scan_downtime(line_t *l, const char *p)
+{
+    uint64_t v;
+
+    if (l->m.downtime) {
+        return;
+    }
+    p = scan_u64(skip_space(p, l->limit), l->limit, &v);
+    if (p) {
+        p = skip_space(p, l->limit);
+        if (l->limit - p >= 2 && p[0] == 'm' && p[1] == 's') {
+            l->m.downtime = 1;
+            l->m.downtime_ms = v;
+        }
+    }
+}
+
+/*
+ * One ':' of a text line. The logger's greedy ".*" picks the last
+ * "Running:\s*\d+s" that still has an "Attacks:\s*\d+" after it and the
+ * last such Attacks, i.e. each Attacks pairs with the latest Running
+ * before it.
+ */
+static void on_colon(line_t *l, const char *c)
+{
+    const char *p = c + 1;
+    uint64_t v;
+
+    if (c == l->start) {
+        return;
+    }
+
+    switch (c[-1]) {
+    case 'g':
+        if (l->counter_end && c - 7 >= l->counter_end && KEYWORD(l, c, "Running")) {
+            p = scan_u64(skip_space(p, l->limit), l->limit, &v);
+            if (p && p < l->limit && *p == 's') {
+                l->uptime_ok = 1;
+                l->uptime = v;
+            }
+        }
+        break;
+
+    case 'e':
+        if (KEYWORD(l, c, "Total downtime")) {
+            scan_downtime(l, p);
+        }
+        break;
+
+    case 'n':
+        if (KEYWORD(l, c, "Total time down")) {
+            scan_downtime(l, p);
+        }
+        break;
+
+    case 's':
+        if (l->uptime_ok && KEYWORD(l, c, "Attacks")) {
+            if (scan_u64(skip_space(p, l->limit), l->limit, &v)) {
+                l->m.heartbeat = 1;
+                l->m.uptime = l->uptime;
+                l->m.faults = v;
+            }
+            break;
+        }
+        /* fall through */
+    case 'S':
+        if (KEYWORD_NOCASE(l, c, "total crashes")) {
+            scan_crash(l, p);
+        }
+        break;
+
+    case 'r':
+        if (!l->counter_end && KEYWORD(l, c, "Counter")) {
+            p = scan_u64(skip_space(p, l->limit), l->limit, &v);
+            if (p) {
+                l->counter_end = p;
+                l->m.counter = v;
+            }
+            break;
+        }
+        /* fall through */
+    case 'R':
+        if (KEYWORD_NOCASE(l, c, "total crashes so far")) {
+            scan_crash(l, p);
+        }
+        break;
+
+    case 'p':
+        /* "BIT FLIP DETECTED.*Jump:\s*(-?\d+)", last Jump wins */
+        if (KEYWORD(l, c, "Jump")) {
+            const char *kw = c - 4;
+            int neg;
+
+            if (!l->flip) {
+                const char *f = memmem(l->start, (size_t)(kw - l->start),
+                                       flip_marker, sizeof(flip_marker) - 1);
+                if (!f) {
+                    break;
+                }
+                l->flip = f + sizeof(flip_marker) - 1;
+            }
+            p = skip_space(p, l->limit);
+            neg = (p < l->limit && *p == '-');
+            if (scan_u64(p + neg, l->limit, &v)) {
+                l->m.bitflip = 1;
+                l->m.jump = neg ? -(int64_t)v : (int64_t)v;
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/* ============================================================================
+ * STATISTICS
+ * ============================================================================ */
+
+/* The logger's per-line update; now = host time of the line, if known */
+static void apply(const match_t *m, const double *now)
+{
+    stats_t *s = &g_stats;
+
+    if (m->heartbeat) {
+        if (s->gap_open && s->have_last_heartbeat && now) {
+            s->host_downtime_sec += *now - s->last_heartbeat;
+        }
+        s->gap_open = 0;
+        if (now) {
+            s->last_heartbeat = *now;
+            s->have_last_heartbeat = 1;
+        }
+        if (m->uptime > s->max_uptime) {
+            s->max_uptime = m->uptime;
+        }
+        s->total_faults = m->faults;
+        s->samples++;
+    }
+
+    if (m->crash && m->crashes) {
+        if (m->crashes > s->total_crashes) {
+            s->gap_open = 1;
+        }
+        s->total_crashes = m->crashes;
+    }
+
+    if (m->downtime) {
+        s->have_fw_downtime = 1;
+        s->fw_downtime_ms = m->downtime_ms;
+    }
+
+    if (m->bitflip && m->jump) {
+        if (s->bitflip_count == s->bitflip_cap) {
+            s->bitflip_cap = s->bitflip_cap ? s->bitflip_cap * 2 : 1024;
+            s->bitflips = realloc(s->bitflips, s->bitflip_cap * sizeof(*s->bitflips));
+            if (!s->bitflips) {
+                fprintf(stderr, "[analyze] out of memory\n");
+                exit(1);
+            }
+        }
+        s->bitflips[s->bitflip_count++] = m->jump;
+    }
+}
+
+static int64_t field_value(const char *p, const char *e, const char *key, uint8_t *found)
+{
+    const char *f = memmem(p, (size_t)(e - p), key, strlen(key));
+    uint64_t v;
+    int neg;
+
+    *found = 0;
+    if (!f) {
+        return 0;
+    }
+    f += strlen(key);
+    neg = (f < e && *f == '-');
+    if (!scan_u64(f + neg, e, &v)) {
+        return 0;
+    }
+    *found = 1;
+    return neg ? -(int64_t)v : (int64_t)v;
+}
+
+/* A binary record as format_record() logged it: "[HEARTBEAT] counter=1 ..." */
+static int text_record(const char *p, const char *e, match_t *m)
+{
+    static const char hb[] = "[HEARTBEAT] ";
+    static const char crash[] = "[CRASH] ";
+    static const char fault[] = "[FAULT] ";
+    static const char recovery[] = "[RECOVERY] ";
+    static const char summary[] = "[SUMMARY] ";
+    size_t n = (size_t)(e - p);
+
+    memset(m, 0, sizeof(*m));
+
+    if (n >= sizeof(hb) - 1 && !memcmp(p, hb, sizeof(hb) - 1)) {
+        m->counter = (uint64_t)field_value(p, e, " counter=", &m->heartbeat);
+        m->uptime = (uint64_t)field_value(p, e, " uptime_ms=", &m->heartbeat) / 1000;
+        m->faults = (uint64_t)field_value(p, e, " faults=", &m->heartbeat);
+    } else if (n >= sizeof(crash) - 1 && !memcmp(p, crash, sizeof(crash) - 1)) {
+        m->crashes = (uint64_t)field_value(p, e, " crashes=", &m->crash);
+    } else if (n >= sizeof(fault) - 1 && !memcmp(p, fault, sizeof(fault) - 1)) {
+        m->jump = field_value(p, e, " delta=", &m->bitflip);
+    } else if (n >= sizeof(recovery) - 1 && !memcmp(p, recovery, sizeof(recovery) - 1)) {
+        m->downtime_ms = (uint64_t)field_value(p, e, " total_downtime_ms=", &m->downtime);
+    } else if (n >= sizeof(summary) - 1 && !memcmp(p, summary, sizeof(summary) - 1)) {
+        m->downtime_ms = (uint64_t)field_value(p, e, " downtime_ms=", &m->downtime);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static inline unsigned digits(const char *p, unsigned n, int *ok)
+{
+    unsigned v = 0;
+
+    while (n--) {
+        if ((uint8_t)(*p - '0') >= 10) {
+            *ok = 0;
+        }
+        v = v * 10 + (unsigned)(*p++ - '0');
+    }
+    return v;
+}
+
+/* datetime.isoformat(): YYYY-MM-DDTHH:MM:SS[.ffffff], seconds since 1970 */
+static int iso_time(const char *p, const char *e, double *t)
+{
+    int ok = 1;
+    int y, mo, d;
+    long days;
+    unsigned era, yoe, doy, doe;
+    double frac = 0.0, scale = 0.1;
+
+    if (e - p < 19 || p[4] != '-' || p[7] != '-' || p[10] != 'T' || p[13] != ':' || p[16] != ':') {
+        return 0;
+    }
+    y = (int)digits(p, 4, &ok);
+    mo = (int)digits(p + 5, 2, &ok);
+    d = (int)digits(p + 8, 2, &ok);
+
+    /* days_from_civil() */
+    y -= mo <= 2;
+    era = (unsigned)(y / 400);
+    yoe = (unsigned)(y - (int)era * 400);
+    doy = (unsigned)((153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1);
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    days = (long)era * 146097 + (long)doe - 719468;
+
+    *t = (double)days * 86400.0 + digits(p + 11, 2, &ok) * 3600.0 +
+         digits(p + 14, 2, &ok) * 60.0 + digits(p + 17, 2, &ok);
+    for (p += 19; p < e && (p[0] == '.' || (uint8_t)(*p - '0') < 10); p++) {
+        if (*p != '.') {
+            frac += (*p - '0') * scale;
+            scale /= 10.0;
+        }
+    }
+    *t += frac;
+    return ok;
+}
+
+/* One CSV row: raw_line is the last field */
+static void csv_row(const line_t *l, const char *e)
+{
+    const char *p = l->start;
+    const match_t *m = &l->m;
+    match_t rec;
+    double now;
+    unsigned f;
+
+    if (g_last_row == NULL) {
+        g_stats.have_time = iso_time(l->start, e, &g_stats.first_time);
+    }
+    g_last_row = l->start;
+
+    /* The fields before raw_line never hold commas or quotes */
+    for (f = 0; f < ANA_CSV_FIELDS; f++) {
+        p = memchr(p, ',', (size_t)(e - p));
+        if (!p) {
+            return;
+        }
+        p++;
+    }
+    if (e > p && e[-1] == '\r') {
+        e--;
+    }
+    if (p < e && *p == '[' && text_record(p, e, &rec)) {
+        m = &rec;
+        g_stats.frames++;
+    }
+
+    if (m->heartbeat || m->crash) {
+        apply(m, iso_time(l->start, e, &now) ? &now : NULL);
+    } else if (m->downtime || m->bitflip) {
+        apply(m, NULL);
+    }
+}
+
+static inline void line_end(const line_t *l, const char *e)
+{
+    g_stats.lines++;
+    if (g_csv) {
+        csv_row(l, e);
+    } else if (l->m.heartbeat | l->m.crash | l->m.downtime | l->m.bitflip) {
+        apply(&l->m, NULL);
+    }
+}
+
+
+/* ============================================================================
+ * STREAM
+ * ============================================================================ */
+
+/*
+ * Text lines from p up to the first 0x00 (returned) or the end. With
+ * flush, a last line without '\n' counts too (text inside a frame chunk).
+ */
+static const char *scan_text(const char *p, const char *end, int flush)
+{
+    uint8_t tail[ANA_BLOCK];
+    size_t off;
+    line_t l;
+
+    line_begin(&l, p, end);
+
+    for (off = 0; off < (size_t)(end - p); off += ANA_BLOCK) {
+        const char *base = p + off;
+        const uint8_t *blk = (const uint8_t *)base;
+        uint64_t nl, colon, zero, events;
+
+        if ((size_t)(end - base) < ANA_BLOCK) {
+            /* Spaces raise no events */
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, base, (size_t)(end - base));
+            blk = tail;
+        }
+
+        if (g_scalar) {
+            classify_scalar(blk, &nl, &colon, &zero);
+        } else {
+            classify_simd(blk, &nl, &colon, &zero);
+        }
+
+        events = nl | colon | zero;
+        while (events) {
+            uint64_t bit = events & (0 - events);
+            const char *c = base + __builtin_ctzll(events);
+
+            events ^= bit;
+            if (colon & bit) {
+                on_colon(&l, c);
+            } else {
+                line_end(&l, c);
+                if (zero & bit) {
+                    return c;
+                }
+                line_begin(&l, c + 1, end);
+            }
+        }
+    }
+
+    if (flush && l.start < end) {
+        line_end(&l, end);
+    }
+    return end;
+}
+
+static inline uint32_t rd16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+    return rd16(p) | (rd16(p + 2) << 16);
+}
+
+/* binascii.crc_hqx(data, 0xFFFF), four bytes per step (slicing-by-4) */
+static uint16_t crc_table[4][256];
+
+static void crc16_init(void)
+{
+    unsigned i, b, k;
+
+    for (i = 0; i < 256; i++) {
+        uint16_t c = (uint16_t)(i << 8);
+
+        for (b = 0; b < 8; b++) {
+            c = (uint16_t)((c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1);
+        }
+        crc_table[0][i] = c;
+    }
+    for (k = 1; k < 4; k++) {
+        for (i = 0; i < 256; i++) {
+            uint16_t c = crc_table[k - 1][i];
+
+            crc_table[k][i] = (uint16_t)((c << 8) ^ crc_table[0][c >> 8]);
+        }
+    }
+}
+
+static uint16_t crc16_ccitt(const uint8_t *p, size_t n)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (; n >= 4; n -= 4, p += 4) {
+        crc ^= (uint16_t)((p[0] << 8) | p[1]);
+        crc = crc_table[3][crc >> 8] ^ crc_table[2][crc & 0xFF] ^
+              crc_table[1][p[2]] ^ crc_table[0][p[3]];
+    }
+    while (n--) {
+        crc = (uint16_t)((crc << 8) ^ crc_table[0][(crc >> 8) ^ *p++]);
+    }
+    return crc;
+}
+
+/* decode_frame(); 0 if the chunk is not a valid record */
+static int frame(const uint8_t *p, size_t n)
+{
+    uint8_t raw[ANA_MAX_FRAME];
+    const uint8_t *rec = raw + 1;
+    size_t len = 0;
+    size_t i = 0;
+    match_t m;
+
+    if (n > sizeof(raw)) {
+        return 0;
+    }
+    while (i < n) {
+        uint8_t code = p[i];
+        uint8_t last = (code < 0xFF);
+
+        if (i + code > n) {
+            return 0;
+        }
+        for (i++, code--; code != 0; code--) {
+            raw[len++] = p[i++];
+        }
+        if (last && i < n) {
+            raw[len++] = 0;
+        }
+    }
+
+    if (len < 3 || raw[0] >= TLM_REC_COUNT || tlm_payload[raw[0]] == 0 ||
+        len - 3 != tlm_payload[raw[0]] ||
+        crc16_ccitt(raw, len - 2) != rd16(raw + len - 2)) {
+        return 0;
+    }
+
+    memset(&m, 0, sizeof(m));
+    switch (raw[0]) {
+    case TLM_REC_HEARTBEAT:
+        m.heartbeat = 1;
+        m.counter = rd32(rec);
+        m.uptime = rd32(rec + 4) / 1000;
+        m.faults = rd16(rec + 8);
+        break;
+    case TLM_REC_FAULT:
+        m.bitflip = 1;
+        m.jump = (int32_t)rd32(rec + 4);
+        break;
+    case TLM_REC_CRASH:
+        m.crash = 1;
+        m.crashes = rd16(rec);
+        break;
+    case TLM_REC_RECOVERY:
+        m.downtime = 1;
+        m.downtime_ms = rd32(rec + 4);
+        break;
+    case TLM_REC_SUMMARY:
+        m.downtime = 1;
+        m.downtime_ms = rd32(rec + 16);
+        break;
+    default:
+        break;
+    }
+
+    g_stats.frames++;
+    apply(&m, NULL);
+    return 1;
+}
+
+/*
+ * Frames from p on. Returns where text resumes: after the last delimiter
+ * if more than ANA_MAX_CHUNK bytes follow it, else the end.
+ */
+static const char *scan_frames(const char *p, const char *end)
+{
+    uint8_t tail[ANA_BLOCK];
+    const char *chunk = p;
+    size_t off;
+
+    for (off = 0; off < (size_t)(end - p); off += ANA_BLOCK) {
+        const char *base = p + off;
+        const uint8_t *blk = (const uint8_t *)base;
+        uint64_t nl, colon, zero;
+
+        if ((size_t)(end - base) < ANA_BLOCK) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, base, (size_t)(end - base));
+            blk = tail;
+        }
+
+        if (g_scalar) {
+            classify_scalar(blk, &nl, &colon, &zero);
+        } else {
+            classify_simd(blk, &nl, &colon, &zero);
+        }
+
+        while (zero) {
+            const char *z = base + __builtin_ctzll(zero);
+
+            zero &= zero - 1;
+            if (z > chunk && !frame((const uint8_t *)chunk, (size_t)(z - chunk))) {
+                scan_text(chunk, z, 1);
+            }
+            chunk = z + 1;
+        }
+    }
+
+    return ((size_t)(end - chunk) > ANA_MAX_CHUNK) ? chunk : end;
+}
+
+static void scan(const char *p, const char *end)
+{
+    if (g_csv) {
+        /* Skip the header row */
+        p = memchr(p, '\n', (size_t)(end - p));
+        if (!p) {
+            return;
+        }
+        p++;
+    }
+
+    while (p < end) {
+        p = scan_text(p, end, 0);
+        if (p < end) {
+            p = scan_frames(p + 1, end);
+        }
+    }
+}
+
+static void stats_reset(void)
+{
+    int64_t *bitflips = g_stats.bitflips;
+    size_t cap = g_stats.bitflip_cap;
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.bitflips = bitflips;
+    g_stats.bitflip_cap = cap;
+    g_last_row = NULL;
+}
+
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================ */
+
+static const char rule_double[] =
+    "═══════════════════════════════════════════════════════════════";
+static const char rule_single[] =
+    "───────────────────────────────────────────────────────────────";
+
+static void report(const char *path, const char *end)
+{
+    const stats_t *s = &g_stats;
+    const char *src;
+    double downtime_sec;
+    double availability;
+    double unavailable;
+    double mttr;
+    double total;
+    uint64_t div = s->total_crashes ? s->total_crashes : 1;
+    size_t i;
+
+    if (s->have_fw_downtime) {
+        downtime_sec = (double)s->fw_downtime_ms / 1000.0;
+        src = "measured by firmware";
+    } else {
+        downtime_sec = s->host_downtime_sec;
+        src = "heartbeat gaps seen by host";
+    }
+    total = (double)s->max_uptime + downtime_sec;
+    availability = (total <= 0) ? 100.0 : ((double)s->max_uptime / total) * 100;
+    unavailable = 1.0 - availability / 100.0;
+    mttr = downtime_sec / (double)div;
+
+    printf("\n\n%s\n                    RESEARCH DATA SUMMARY\n%s\n\n", rule_double, rule_double);
+    if (g_csv && s->have_time && g_last_row) {
+        double last;
+
+        if (!iso_time(g_last_row, end, &last)) {
+            last = s->first_time;
+        }
+        printf("Session Duration:     %.1f seconds\n", last - s->first_time);
+    } else {
+        printf("Session Duration:     unknown (no timestamps in a raw capture)\n");
+    }
+    printf("Data Samples:         %llu\n", (unsigned long long)s->samples);
+    printf("Maximum Uptime:       %llu seconds\n", (unsigned long long)s->max_uptime);
+    printf("Total Crashes:        %llu\n", (unsigned long long)s->total_crashes);
+    printf("Total Fault Injects:  %llu\n", (unsigned long long)s->total_faults);
+    printf("Bit Flips Detected:   %zu\n", s->bitflip_count);
+
+    printf("\n%s\n                    AVAILABILITY METRICS\n%s\n\n", rule_single, rule_single);
+    printf("Total Downtime:       %.3f seconds (%s)\n", downtime_sec, src);
+    if (unavailable <= 0) {
+        printf("System Availability:  %.4f%% (inf nines)\n", availability);
+    } else {
+        printf("System Availability:  %.4f%% (%d nines)\n", availability,
+               (int)(-log10(unavailable) + 1e-9));
+    }
+    printf("Mean Time To Recovery (MTTR): %.3f seconds\n", mttr);
+    printf("Mean Time Between Failures: %.1f seconds\n", (double)s->max_uptime / (double)div);
+
+    printf("\n%s\n                    BIT FLIP ANALYSIS\n%s\n\n", rule_single, rule_single);
+    if (s->bitflip_count) {
+        uint64_t sum = 0;
+
+        fputs("Bit flip magnitudes: [", stdout);
+        for (i = 0; i < s->bitflip_count; i++) {
+            printf(i ? ", %lld" : "%lld", (long long)s->bitflips[i]);
+            sum += (uint64_t)llabs(s->bitflips[i]);
+        }
+        fputs("]\n", stdout);
+        printf("Average jump magnitude: %.1f\n", (double)sum / (double)s->bitflip_count);
+    } else {
+        printf("No bit flips recorded (Attack Mode A not active?)\n");
+    }
+
+    printf("\n%s\n                    HYPOTHESIS VALIDATION\n%s\n\n", rule_single, rule_single);
+    printf("Hypothesis: \"With WDT enabled, the system recovers within 2000ms,\n"
+           "             maintaining 90%%+ availability.\"\n\n");
+    printf("Result: %s\n", availability >= 90 ? "✓ VALIDATED" : "✗ NOT VALIDATED");
+    printf("        System achieved %.1f%% availability\n\n", availability);
+    printf("Data analysed from: %s\n%s\n\n", path, rule_double);
+}
+
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--bench MB] [--passes N] [--scalar] capture.log|log.csv\n"
+            "  --bench MB  time the scan over MB of the input repeated in memory\n"
+            "  --passes N  scans per benchmark (default %u)\n"
+            "  --scalar    classify bytes without SIMD (for comparison)\n",
+            prog, ANA_PASSES);
+}
+
+/* Whole copies of the input, up to at least mb megabytes */
+static char *bench_buffer(const char *data, size_t size, size_t mb, size_t *out)
+{
+    size_t copies = (mb * 1000000 + size - 1) / size;
+    size_t total = copies * size;
+    char *buf;
+    size_t i;
+
+    buf = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        return NULL;
+    }
+    for (i = 0; i < copies; i++) {
+        memcpy(buf + i * size, data, size);
+    }
+    *out = total;
+    return buf;
+}
+
+static int bench(const char *data, size_t size, size_t mb, unsigned passes)
+{
+    size_t total;
+    char *buf = bench_buffer(data, size, mb, &total);
+    double best = 0.0;
+    double sum = 0.0;
+    unsigned i;
+
+    if (!buf) {
+        fprintf(stderr, "[analyze] cannot allocate %zu MB\n", mb);
+        return 1;
+    }
+
+    fprintf(stderr, "[analyze] %zu bytes, %s classification, %u passes\n",
+            total, g_scalar ? "scalar" : simd_name(), passes);
+    for (i = 0; i < passes; i++) {
+        double t0, t1, gbps;
+
+        stats_reset();
+        t0 = now_sec();
+        scan(buf, buf + total);
+        t1 = now_sec();
+
+        gbps = (double)total / (t1 - t0) / 1e9;
+        sum += gbps;
+        if (gbps > best) {
+            best = gbps;
+        }
+        fprintf(stderr, "  pass %-2u %8.3f s  %6.2f GB/s  (%llu lines, %llu frames, %llu samples)\n",
+                i + 1, t1 - t0, gbps, (unsigned long long)g_stats.lines,
+                (unsigned long long)g_stats.frames, (unsigned long long)g_stats.samples);
+    }
+    fprintf(stderr, "[analyze] mean %.2f GB/s, best %.2f GB/s\n", sum / passes, best);
+
+    munmap(buf, total);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    size_t bench_mb = 0;
+    unsigned passes = ANA_PASSES;
+    struct stat st;
+    const char *data;
+    double t0, t1;
+    int fd;
+    int rc = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench") && i + 1 < argc) {
+            bench_mb = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--passes") && i + 1 < argc) {
+            passes = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--scalar")) {
+            g_scalar = 1;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path || passes == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "[analyze] cannot open %s\n", path);
+        return 1;
+    }
+    if (st.st_size == 0) {
+        fprintf(stderr, "[analyze] %s is empty\n", path);
+        close(fd);
+        return 1;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "[analyze] cannot map %s\n", path);
+        return 1;
+    }
+    crc16_init();
+    madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    g_csv = (size_t)st.st_size >= sizeof(csv_header) - 1 &&
+            !memcmp(data, csv_header, sizeof(csv_header) - 1);
+
+    if (bench_mb) {
+        rc = bench(data, (size_t)st.st_size, bench_mb, passes);
+    } else {
+        t0 = now_sec();
+        scan(data, data + st.st_size);
+        t1 = now_sec();
+
+        report(path, data + st.st_size);
+        fprintf(stderr, "[analyze] %s: %lld bytes, %llu lines, %llu records in %.3f s (%.2f GB/s, %s)\n",
+                g_csv ? "CSV" : "raw capture", (long long)st.st_size,
+                (unsigned long long)g_stats.lines, (unsigned long long)g_stats.frames,
+                t1 - t0, (double)st.st_size / (t1 - t0) / 1e9,
+                g_scalar ? "scalar" : simd_name());
+    }
+
+    munmap((void *)data, (size_t)st.st_size);
+    free(g_stats.bitflips);
+    return rc;
+}
@@ -0,0 +1,1181 @@
+/*
+ * ============================================================================
+ * FIRA - Multi-Board Capture
+ * One event loop for any number of serial ports, one CSV per board
+ * ============================================================================
+ *
+ * Replaces one fira_logger.py process per board. All ports are opened
+ * non-blocking and multiplexed with epoll; each has its own input buffer,
+ * split into lines (and binary telemetry frames) exactly like the
+ * logger's TelemetryStream. Every line is stamped with its arrival time
+ * and becomes a row of the logger's CSV format (timestamp and raw_line;
+ * the parsed columns are left to fira_analyze).
+ *
+ * Rows are batched into CAP_BLOCK_BYTES blocks per board, which a writer
+ * thread puts on disk, so a slow disk never stalls the reads. A board
+ * that has all its blocks in flight loses rows rather than the loop
+ * blocking, and these are counted as dropped. Overruns the serial driver
+ * reports (TIOCGICOUNT, not on ptys) are shown as well.
+ *
+ * --test N stands N pseudo-terminals in for boards: a generator thread
+ * plays a capture (or synthetic heartbeats) into each at --rate bytes/s,
+ * like a UART that cannot wait, and checks what arrived against what
+ * was sent.
+ *
+ * Usage:
+ *   fira_capture [--out DIR] [--baud N] [--time SEC] [--stats SEC] PORT...
+ *   fira_capture --test N [--rate BPS] [--replay FILE] [--out DIR] [--time SEC]
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/serial.h>
+
+
+#define CAP_MAX_PORTS       64U
+#define CAP_IN_BYTES        4096U           /* Per-port line buffer */
+#define CAP_BLOCK_BYTES     65536U          /* One batched write */
+#define CAP_BLOCKS          4U              /* Per port, filling + in flight */
+#define CAP_MAX_CHUNK       256U            /* TLM_MAX_CHUNK in fira_logger.py */
+#define CAP_MAX_FRAME       64U             /* Longer chunks cannot be a record */
+#define CAP_FLUSH_MS        250U            /* Partly filled blocks go out after this */
+#define CAP_REOPEN_MS       1000U
+#define CAP_DRAIN_MS        200U            /* Quiet time that ends a test run */
+#define CAP_TS_MAX          32U
+#define CAP_GEN_TICK_NS     1000000L
+#define CAP_DEFAULT_RATE    11520U          /* 115200 baud, 8N1 */
+
+static const char csv_header[] = "timestamp,counter,uptime_sec,faults,crashes,bitflip_jump,raw_line";
+
+/* Binary telemetry records (include/telemetry.h), as format_record() prints them */
+typedef struct {
+    const char *name;
+    const char *layout;         /* struct module codes, little-endian */
+    const char *fields;
+} tlm_record_t;
+
+static const tlm_record_t tlm_records[] = {
+    [0x01] = { "HEARTBEAT",  "IIH",      "counter uptime_ms faults" },
+    [0x02] = { "FAULT",      "IiH",      "counter delta faults" },
+    [0x03] = { "CRASH",      "HB",       "crashes reset_reason" },
+    [0x04] = { "SUMMARY",    "IIHHIIH",  "uptime_ms counter faults crashes avail_ppm downtime_ms drops" },
+    [0x05] = { "CRASH_INFO", "HHBIHBBB", "pc sp sreg systick_ms faults task stalled cause" },
+    [0x06] = { "RECOVERY",   "II",       "downtime_ms total_downtime_ms" },
+    [0x07] = { "SETTINGS",   "BBBBB",    "ok mode interval_sec armed arrival" },
+    [0x08] = { "JITTER",     "BHHHHHHHHHHHHHH",
+               "task interval_ms skipped h0 h1 h2 h3 h4 h5 h6 h7 h8 h9 h10 h11" },
+};
+
+#define TLM_REC_COUNT       (sizeof(tlm_records) / sizeof(tlm_records[0]))
+
+
+/* ============================================================================
+ * STATE
+ * ============================================================================ */
+
+struct cap_port;
+
+typedef struct cap_block {
+    struct cap_block *next;
+    struct cap_port *port;
+    size_t len;
+    char data[CAP_BLOCK_BYTES];
+} cap_block_t;
+
+typedef struct cap_port {
+    const char *path;
+    char name[32];
+    int fd;                     /* -1 while disconnected */
+    int out;
+    uint64_t reopen_at;
+
+    /* TelemetryStream */
+    uint8_t in[CAP_IN_BYTES];
+    size_t in_len;
+    uint8_t binary;
+
+    /* Output batching; free blocks are shared with the writer (g_lock) */
+    cap_block_t *block;
+    cap_block_t *free;
+    uint64_t block_since;
+
+    uint64_t bytes;             /* Read from the port */
+    uint64_t window_bytes;
+    uint64_t lines;
+    uint64_t records;
+    uint64_t split;             /* Lines cut at CAP_IN_BYTES */
+    uint64_t dropped_rows;
+    uint64_t dropped_bytes;
+    uint64_t write_errors;      /* Writer thread */
+    uint32_t reconnects;
+
+    uint8_t icount_ok;
+    struct serial_icounter_struct icount0;
+    uint64_t overruns;
+} cap_port_t;
+
+/* Test board: master side of a pty */
+typedef struct {
+    int fd;
+    size_t pos;
+    double budget;
+    uint64_t sent;
+    uint64_t unsent;            /* Pty full: lost, as on a UART */
+} cap_board_t;
+
+static cap_port_t g_ports[CAP_MAX_PORTS];
+static unsigned g_port_count = 0;
+static int g_epoll = -1;
+static const char *g_out_dir = ".";
+static speed_t g_baud = B115200;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static cap_block_t *g_queue_head = NULL;
+static cap_block_t *g_queue_tail = NULL;
+static uint8_t g_writer_stop = 0;
+
+static volatile sig_atomic_t g_quit = 0;
+
+/* Arrival time of the current batch of reads, as datetime.isoformat() */
+static char g_ts[CAP_TS_MAX];
+static size_t g_ts_len = 0;
+
+static cap_board_t g_boards[CAP_MAX_PORTS];
+static const uint8_t *g_gen_data = NULL;
+static size_t g_gen_size = 0;
+static double g_gen_rate = CAP_DEFAULT_RATE;
+static volatile uint8_t g_gen_stop = 0;
+
+
+/* ============================================================================
+ * TIME
+ * ============================================================================ */
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000U + (uint64_t)ts.tv_nsec / 1000000U;
+}
+
+/* Local time, seconds formatted once per second */
+static void stamp(void)
+{
+    static time_t last = 0;
+    static char prefix[CAP_TS_MAX];
+    struct timespec ts;
+    long usec;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (ts.tv_sec != last) {
+        struct tm tm;
+
+        localtime_r(&ts.tv_sec, &tm);
+        strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &tm);
+        last = ts.tv_sec;
+    }
+
+    usec = ts.tv_nsec / 1000;
+    if (usec) {
+        g_ts_len = (size_t)snprintf(g_ts, sizeof(g_ts), "%s.%06ld", prefix, usec);
+    } else {
+        g_ts_len = (size_t)snprintf(g_ts, sizeof(g_ts), "%s", prefix);
+    }
+}
+
+
+/* ============================================================================
+ * OUTPUT
+ * ============================================================================ */
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_lock);
+    for (;;) {
+        cap_block_t *b;
+        size_t done = 0;
+        int failed = 0;
+
+        while (!g_queue_head && !g_writer_stop) {
+            pthread_cond_wait(&g_cond, &g_lock);
+        }
+        b = g_queue_head;
+        if (!b) {
+            break;
+        }
+        g_queue_head = b->next;
+        if (!g_queue_head) {
+            g_queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&g_lock);
+
+        while (done < b->len) {
+            ssize_t n = write(b->port->out, b->data + done, b->len - done);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                failed = 1;
+                break;
+            }
+            done += (size_t)n;
+        }
+
+        pthread_mutex_lock(&g_lock);
+        if (failed) {
+            b->port->write_errors++;
+        }
+        b->len = 0;
+        b->next = b->port->free;
+        b->port->free = b;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+/* Hand the block being filled to the writer */
+static void submit(cap_port_t *p)
+{
+    cap_block_t *b = p->block;
+
+    if (!b || b->len == 0) {
+        return;
+    }
+    p->block = NULL;
+
+    pthread_mutex_lock(&g_lock);
+    b->next = NULL;
+    if (g_queue_tail) {
+        g_queue_tail->next = b;
+    } else {
+        g_queue_head = b;
+    }
+    g_queue_tail = b;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static cap_block_t *take_block(cap_port_t *p)
+{
+    cap_block_t *b;
+
+    pthread_mutex_lock(&g_lock);
+    b = p->free;
+    if (b) {
+        p->free = b->next;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return b;
+}
+
+static void put(cap_block_t *b, const void *data, size_t n)
+{
+    memcpy(b->data + b->len, data, n);
+    b->len += n;
+}
+
+/* One CSV row: csv.writer quotes a field with a comma or a quote in it */
+static void emit_row(cap_port_t *p, const char *line, size_t n)
+{
+    size_t need = g_ts_len + 6 + 2 * n + 4;
+    cap_block_t *b = p->block;
+
+    if (!b || CAP_BLOCK_BYTES - b->len < need) {
+        submit(p);
+        b = p->block = take_block(p);
+        if (!b) {
+            p->dropped_rows++;
+            p->dropped_bytes += n;
+            return;
+        }
+        p->block_since = now_ms();
+    }
+
+    put(b, g_ts, g_ts_len);
+    put(b, ",,,,,,", 6);
+    if (memchr(line, ',', n) || memchr(line, '"', n)) {
+        size_t i;
+
+        b->data[b->len++] = '"';
+        for (i = 0; i < n; i++) {
+            if (line[i] == '"') {
+                b->data[b->len++] = '"';
+            }
+            b->data[b->len++] = line[i];
+        }
+        b->data[b->len++] = '"';
+    } else {
+        put(b, line, n);
+    }
+    put(b, "\r\n", 2);
+}
+
+static void flush_idle(uint64_t now)
+{
+    unsigned i;
+
+    for (i = 0; i < g_port_count; i++) {
+        cap_port_t *p = &g_ports[i];
+
+        if (p->block && p->block->len && now - p->block_since >= CAP_FLUSH_MS) {
+            submit(p);
+        }
+    }
+}
+
+
+/* ============================================================================
+ * TELEMETRY STREAM
+ * ============================================================================ */
+
+/*
+ * str.splitlines() breaks and str.strip() whitespace, as byte lengths of
+ * the UTF-8 sequence at s (0 = none). Beyond ASCII: U+0085, U+00A0,
+ * U+1680, U+2000..U+200A, U+2028, U+2029, U+202F, U+205F and U+3000.
+ */
+static size_t break_len(const uint8_t *s, const uint8_t *end)
+{
+    if (s[0] < 0x80) {
+        return (s[0] >= '\n' && s[0] <= '\r') || (s[0] >= 0x1C && s[0] <= 0x1E);
+    }
+    if (end - s >= 2 && s[0] == 0xC2 && s[1] == 0x85) {
+        return 2;
+    }
+    if (end - s >= 3 && s[0] == 0xE2 && s[1] == 0x80 && (s[2] == 0xA8 || s[2] == 0xA9)) {
+        return 3;
+    }
+    return 0;
+}
+
+static size_t space_len(const uint8_t *s, const uint8_t *end)
+{
+    if (s[0] < 0x80) {
+        return s[0] == ' ' || (s[0] >= '\t' && s[0] <= '\r') || (s[0] >= 0x1C && s[0] <= 0x1F);
+    }
+    if (end - s >= 2 && s[0] == 0xC2 && (s[1] == 0x85 || s[1] == 0xA0)) {
+        return 2;
+    }
+    if (end - s >= 3) {
+        uint32_t c = ((uint32_t)s[0] << 16) | ((uint32_t)s[1] << 8) | s[2];
+
+        if (c == 0xE19A80 || (c >= 0xE28080 && c <= 0xE2808A) || c == 0xE280A8 ||
+            c == 0xE280A9 || c == 0xE280AF || c == 0xE2819F || c == 0xE38080) {
+            return 3;
+        }
+    }
+    return 0;
+}
+
+/* Same, for the sequence that ends at e */
+static size_t space_before(const uint8_t *a, const uint8_t *e)
+{
+    size_t k;
+
+    for (k = 1; k <= 3 && (size_t)(e - a) >= k; k++) {
+        if ((k == 1 || e[-(long)k] >= 0xC0) && space_len(e - k, e) == k) {
+            return k;
+        }
+        if (e[-(long)k] < 0x80 || e[-(long)k] >= 0xC0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/* Length of the valid UTF-8 sequence at s, 0 if there is none */
+static size_t utf8_len(const uint8_t *s, const uint8_t *end)
+{
+    size_t n = (size_t)(end - s);
+    uint8_t lo = 0x80, hi = 0xBF;
+    size_t len, i;
+
+    if (s[0] < 0x80) {
+        return 1;
+    } else if (s[0] >= 0xC2 && s[0] <= 0xDF) {
+        len = 2;
+    } else if (s[0] >= 0xE0 && s[0] <= 0xEF) {
+        len = 3;
+        lo = (s[0] == 0xE0) ? 0xA0 : 0x80;
+        hi = (s[0] == 0xED) ? 0x9F : 0xBF;
+    } else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+        len = 4;
+        lo = (s[0] == 0xF0) ? 0x90 : 0x80;
+        hi = (s[0] == 0xF4) ? 0x8F : 0xBF;
+    } else {
+        return 0;
+    }
+
+    if (n < len || s[1] < lo || s[1] > hi) {
+        return 0;
+    }
+    for (i = 2; i < len; i++) {
+        if (s[i] < 0x80 || s[i] > 0xBF) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/* TelemetryStream._text(): decoded with errors='ignore', stripped, non-empty lines */
+static void text(cap_port_t *p, const uint8_t *s, size_t n)
+{
+    uint8_t clean[CAP_IN_BYTES];
+    const uint8_t *end = s + n;
+    size_t i;
+
+    for (i = 0; i < n && s[i] < 0x80; i++) {
+    }
+    if (i < n && n <= sizeof(clean)) {
+        size_t k = 0;
+
+        for (i = 0; i < n; ) {
+            size_t len = utf8_len(s + i, end);
+
+            if (len == 0) {
+                i++;
+                continue;
+            }
+            memcpy(clean + k, s + i, len);
+            k += len;
+            i += len;
+        }
+        s = clean;
+        end = clean + k;
+    }
+
+    while (s < end) {
+        const uint8_t *e = s;
+        const uint8_t *a = s;
+        const uint8_t *z;
+        size_t k = 0;
+
+        while (e < end && (k = break_len(e, end)) == 0) {
+            e++;
+        }
+        z = e;
+        while (a < z && (k = space_len(a, z)) != 0) {
+            a += k;
+        }
+        while (z > a && (k = space_before(a, z)) != 0) {
+            z -= k;
+        }
+        if (z > a) {
+            p->lines++;
+            emit_row(p, (const char *)a, (size_t)(z - a));
+        }
+        s = e + (e < end ? break_len(e, end) : 1);
+    }
+}
+
+static uint16_t crc16_ccitt(const uint8_t *p, size_t n)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (n--) {
+        unsigned b;
+
+        crc ^= (uint16_t)(*p++ << 8);
+        for (b = 0; b < 8; b++) {
+            crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static size_t layout_size(const char *layout)
+{
+    size_t n = 0;
+
+    for (; *layout; layout++) {
+        n += (*layout == 'B') ? 1 : (*layout == 'H') ? 2 : 4;
+    }
+    return n;
+}
+
+/* decode_frame() + format_record(); 0 if the chunk is not a valid record */
+static int frame(cap_port_t *p, const uint8_t *s, size_t n)
+{
+    uint8_t raw[CAP_MAX_FRAME];
+    char line[CAP_MAX_FRAME * 12];
+    const tlm_record_t *r;
+    const uint8_t *v;
+    const char *layout;
+    const char *field;
+    size_t len = 0;
+    size_t i = 0;
+    int k;
+
+    if (n > sizeof(raw)) {
+        return 0;
+    }
+    while (i < n) {
+        uint8_t code = s[i];
+        uint8_t last = (code < 0xFF);
+
+        if (i + code > n) {
+            return 0;
+        }
+        for (i++, code--; code != 0; code--) {
+            raw[len++] = s[i++];
+        }
+        if (last && i < n) {
+            raw[len++] = 0;
+        }
+    }
+
+    if (len < 3 || raw[0] >= TLM_REC_COUNT || !tlm_records[raw[0]].name ||
+        crc16_ccitt(raw, len - 2) != (raw[len - 2] | (raw[len - 1] << 8))) {
+        return 0;
+    }
+    r = &tlm_records[raw[0]];
+    if (len - 3 != layout_size(r->layout)) {
+        return 0;
+    }
+
+    k = snprintf(line, sizeof(line), "[%s]", r->name);
+    v = raw + 1;
+    field = r->fields;
+    for (layout = r->layout; *layout; layout++) {
+        size_t w = strcspn(field, " ");
+        long long x;
+
+        switch (*layout) {
+        case 'B':
+            x = v[0];
+            v += 1;
+            break;
+        case 'H':
+            x = v[0] | (v[1] << 8);
+            v += 2;
+            break;
+        default:
+            x = (uint32_t)(v[0] | (v[1] << 8) | (v[2] << 16) | ((uint32_t)v[3] << 24));
+            if (*layout == 'i') {
+                x = (int32_t)x;
+            }
+            v += 4;
+            break;
+        }
+        k += snprintf(line + k, sizeof(line) - (size_t)k, " %.*s=%lld", (int)w, field, x);
+        field += w + (field[w] == ' ');
+    }
+
+    p->records++;
+    emit_row(p, line, (size_t)k);
+    return 1;
+}
+
+/* TelemetryStream.feed() over what has arrived so far */
+static void feed(cap_port_t *p)
+{
+    uint8_t *buf = p->in;
+    size_t off = 0;
+
+    while (off < p->in_len) {
+        uint8_t *s = buf + off;
+        size_t n = p->in_len - off;
+
+        if (p->binary) {
+            uint8_t *z = memchr(s, 0, n);
+
+            if (!z) {
+                if (n > CAP_MAX_CHUNK) {
+                    p->binary = 0;
+                    continue;
+                }
+                break;
+            }
+            if (z > s && !frame(p, s, (size_t)(z - s))) {
+                text(p, s, (size_t)(z - s));
+            }
+            off += (size_t)(z - s) + 1;
+        } else {
+            uint8_t *nl = memchr(s, '\n', n);
+            uint8_t *z = memchr(s, 0, nl ? (size_t)(nl - s) : n);
+
+            if (z) {
+                text(p, s, (size_t)(z - s));
+                off += (size_t)(z - s) + 1;
+                p->binary = 1;
+            } else if (nl) {
+                text(p, s, (size_t)(nl - s));
+                off += (size_t)(nl - s) + 1;
+            } else {
+                break;
+            }
+        }
+    }
+
+    if (off == 0 && p->in_len == CAP_IN_BYTES) {
+        /* No line end in a full buffer: pass it on in one piece */
+        p->split++;
+        text(p, buf, p->in_len);
+        off = p->in_len;
+    }
+    p->in_len -= off;
+    memmove(buf, buf + off, p->in_len);
+}
+
+
+/* ============================================================================
+ * PORTS
+ * ============================================================================ */
+
+static int port_open(cap_port_t *p)
+{
+    struct termios tio;
+    struct epoll_event ev;
+    int fd = open(p->path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* Raw bytes, no echo (a pty slave starts out canonical) */
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        cfsetispeed(&tio, g_baud);
+        cfsetospeed(&tio, g_baud);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    p->icount_ok = (ioctl(fd, TIOCGICOUNT, &p->icount0) == 0);
+
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = p;
+    if (epoll_ctl(g_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    p->fd = fd;
+    p->in_len = 0;
+    p->binary = 0;
+    return 0;
+}
+
+static void port_close(cap_port_t *p, uint64_t now)
+{
+    if (p->fd >= 0) {
+        close(p->fd);
+        p->fd = -1;
+        p->reopen_at = now + CAP_REOPEN_MS;
+        fprintf(stderr, "[capture] %s: disconnected\n", p->name);
+    }
+}
+
+static int port_add(const char *path)
+{
+    char file[512];
+    cap_port_t *p;
+    const char *s;
+    size_t i;
+    unsigned k;
+
+    if (g_port_count == CAP_MAX_PORTS) {
+        fprintf(stderr, "[capture] at most %u ports\n", CAP_MAX_PORTS);
+        return -1;
+    }
+    p = &g_ports[g_port_count];
+    p->path = path;
+    p->fd = -1;
+
+    /* /dev/ttyACM0 -> ttyACM0, /dev/pts/3 -> pts-3 */
+    s = strncmp(path, "/dev/", 5) ? path : path + 5;
+    for (i = 0; s[i] && i < sizeof(p->name) - 1; i++) {
+        p->name[i] = (s[i] == '/') ? '-' : s[i];
+    }
+    p->name[i] = '\0';
+
+    snprintf(file, sizeof(file), "%s/%s.csv", g_out_dir, p->name);
+    p->out = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (p->out < 0) {
+        fprintf(stderr, "[capture] cannot create %s\n", file);
+        return -1;
+    }
+
+    for (k = 0; k < CAP_BLOCKS; k++) {
+        cap_block_t *b = malloc(sizeof(*b));
+
+        if (!b) {
+            fprintf(stderr, "[capture] out of memory\n");
+            return -1;
+        }
+        b->port = p;
+        b->len = 0;
+        b->next = p->free;
+        p->free = b;
+    }
+    p->block = take_block(p);
+    put(p->block, csv_header, sizeof(csv_header) - 1);
+    put(p->block, "\r\n", 2);
+    p->block_since = now_ms();
+
+    if (port_open(p) != 0) {
+        fprintf(stderr, "[capture] cannot open %s (retrying)\n", path);
+        p->reopen_at = now_ms() + CAP_REOPEN_MS;
+    }
+    fprintf(stderr, "[capture] %s -> %s\n", path, file);
+    g_port_count++;
+    return 0;
+}
+
+static void port_read(cap_port_t *p, uint64_t now)
+{
+    for (;;) {
+        ssize_t n = read(p->fd, p->in + p->in_len, CAP_IN_BYTES - p->in_len);
+
+        if (n > 0) {
+            p->bytes += (uint64_t)n;
+            p->window_bytes += (uint64_t)n;
+            p->in_len += (size_t)n;
+            feed(p);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            return;
+        }
+        /* EOF or EIO: unplugged, or the pty master went away */
+        port_close(p, now);
+        return;
+    }
+}
+
+static void port_overruns(cap_port_t *p)
+{
+    struct serial_icounter_struct ic;
+
+    if (p->fd >= 0 && p->icount_ok && ioctl(p->fd, TIOCGICOUNT, &ic) == 0) {
+        p->overruns = (uint64_t)(ic.overrun - p->icount0.overrun) +
+                      (uint64_t)(ic.buf_overrun - p->icount0.buf_overrun);
+    }
+}
+
+
+/* ============================================================================
+ * TEST BOARDS
+ * ============================================================================ */
+
+static const uint8_t *synthetic_log(size_t *size)
+{
+    static char buf[1 << 16];
+    size_t n = 0;
+    unsigned i = 1;
+
+    while (n < sizeof(buf) - 64) {
+        n += (size_t)snprintf(buf + n, sizeof(buf) - n,
+                              "Counter: %u | Running: %us | Attacks: %u |\r\n", i, i / 10, i / 30);
+        i++;
+    }
+    *size = n;
+    return (const uint8_t *)buf;
+}
+
+static const uint8_t *replay_log(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long n;
+
+    if (!f || fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) <= 0) {
+        if (f) {
+            fclose(f);
+        }
+        return NULL;
+    }
+    rewind(f);
+    buf = malloc((size_t)n);
+    if (!buf || fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *size = (size_t)n;
+    return buf;
+}
+
+static int board_add(unsigned i)
+{
+    cap_board_t *b = &g_boards[i];
+    const char *slave;
+    char *path;
+
+    b->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (b->fd < 0 || grantpt(b->fd) != 0 || unlockpt(b->fd) != 0 || !(slave = ptsname(b->fd))) {
+        fprintf(stderr, "[capture] cannot create a pseudo-terminal\n");
+        return -1;
+    }
+    /* Boards start at different points of the log */
+    b->pos = (g_gen_size / (i + 2)) % g_gen_size;
+
+    path = strdup(slave);
+    return path ? port_add(path) : -1;
+}
+
+/* Every board sends rate bytes/s; what the pty cannot take is lost */
+static void *generator_main(void *arg)
+{
+    struct timespec tick = { 0, CAP_GEN_TICK_NS };
+    uint64_t last = now_ms();
+    unsigned count = *(unsigned *)arg;
+
+    while (!g_gen_stop) {
+        uint64_t now;
+        unsigned i;
+
+        nanosleep(&tick, NULL);
+        now = now_ms();
+
+        for (i = 0; i < count; i++) {
+            cap_board_t *b = &g_boards[i];
+
+            b->budget += g_gen_rate * (double)(now - last) / 1000.0;
+            while (b->budget >= 1.0) {
+                size_t want = (size_t)b->budget;
+                ssize_t n;
+
+                if (want > g_gen_size - b->pos) {
+                    want = g_gen_size - b->pos;
+                }
+                n = write(b->fd, g_gen_data + b->pos, want);
+                if (n < 0) {
+                    n = 0;
+                }
+                __atomic_add_fetch(&b->sent, (uint64_t)n, __ATOMIC_RELAXED);
+                if ((size_t)n < want) {
+                    __atomic_add_fetch(&b->unsent, want - (size_t)n, __ATOMIC_RELAXED);
+                }
+                b->budget -= (double)want;
+                b->pos = (b->pos + want) % g_gen_size;
+            }
+        }
+        last = now;
+    }
+    return NULL;
+}
+
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================ */
+
+/* window_sec: rates over the bytes since the last report */
+static void report(double window_sec, double total_sec)
+{
+    unsigned i;
+
+    fprintf(stderr, "\n[capture] %.1f s\n", total_sec);
+    fprintf(stderr, "  %-16s %10s %12s %10s %8s %10s %8s %8s  %s\n", "port", "B/s", "bytes",
+            "lines", "records", "dropped", "split", "overrun", "state");
+    for (i = 0; i < g_port_count; i++) {
+        cap_port_t *p = &g_ports[i];
+        char overrun[24];
+
+        port_overruns(p);
+        if (p->icount_ok) {
+            snprintf(overrun, sizeof(overrun), "%llu", (unsigned long long)p->overruns);
+        } else {
+            snprintf(overrun, sizeof(overrun), "-");
+        }
+        fprintf(stderr, "  %-16s %10.0f %12llu %10llu %8llu %10llu %8llu %8s  %s",
+                p->name, window_sec > 0 ? (double)p->window_bytes / window_sec : 0.0,
+                (unsigned long long)p->bytes, (unsigned long long)p->lines,
+                (unsigned long long)p->records, (unsigned long long)p->dropped_bytes,
+                (unsigned long long)p->split, overrun, p->fd >= 0 ? "open" : "closed");
+        if (p->reconnects) {
+            fprintf(stderr, " (%u reconnects)", p->reconnects);
+        }
+        if (p->write_errors) {
+            fprintf(stderr, " (%llu write errors)", (unsigned long long)p->write_errors);
+        }
+        fputc('\n', stderr);
+        p->window_bytes = 0;
+    }
+}
+
+/* Test run: the capture must have everything the boards got out */
+static int report_test(unsigned count)
+{
+    unsigned i;
+    int lost = 0;
+
+    fprintf(stderr, "\n[capture] test boards (generator -> capture, bytes)\n");
+    fprintf(stderr, "  %-16s %12s %10s %12s %10s\n", "port", "sent", "unsent", "received", "missing");
+    for (i = 0; i < count; i++) {
+        const cap_board_t *b = &g_boards[i];
+        const cap_port_t *p = &g_ports[i];
+        long long missing = (long long)b->sent - (long long)p->bytes;
+
+        fprintf(stderr, "  %-16s %12llu %10llu %12llu %10lld\n", p->name,
+                (unsigned long long)b->sent, (unsigned long long)b->unsent,
+                (unsigned long long)p->bytes, missing);
+        if (missing != 0 || b->unsent || p->dropped_bytes) {
+            lost = 1;
+        }
+    }
+    fprintf(stderr, "[capture] %s\n", lost ? "DATA LOST" : "no data lost");
+    return lost;
+}
+
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    g_quit = 1;
+}
+
+static speed_t baud_of(unsigned long baud)
+{
+    switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 500000:  return B500000;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    default:      return 0;
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] PORT...\n"
+            "       %s --test N [--rate BPS] [--replay FILE] [options]\n"
+            "  --out DIR      one PORT-name.csv per port here (default .)\n"
+            "  --baud N       serial speed (default 115200)\n"
+            "  --time SEC     stop after SEC seconds (default: on Ctrl+C)\n"
+            "  --stats SEC    per-port report interval (default 10)\n"
+            "  --test N       N pseudo-terminal boards fed by a generator\n"
+            "  --rate BPS     bytes/s per test board (default %u)\n"
+            "  --replay FILE  what the test boards send (default: heartbeat lines)\n",
+            prog, prog, CAP_DEFAULT_RATE);
+}
+
+static void loop(uint64_t stop_at, unsigned stats_ms, uint64_t start)
+{
+    struct epoll_event events[CAP_MAX_PORTS];
+    uint64_t next_stats = start + stats_ms;
+    uint64_t last_stats = start;
+
+    while (!g_quit) {
+        uint64_t now = now_ms();
+        int n;
+        int i;
+
+        if (stop_at && now >= stop_at) {
+            break;
+        }
+
+        n = epoll_wait(g_epoll, events, CAP_MAX_PORTS, (int)CAP_FLUSH_MS);
+        now = now_ms();
+        if (n > 0) {
+            stamp();
+        }
+        for (i = 0; i < n; i++) {
+            cap_port_t *p = events[i].data.ptr;
+
+            if (p->fd < 0) {
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                port_read(p, now);
+            }
+            if (p->fd >= 0 && (events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR))) {
+                port_read(p, now);
+                port_close(p, now);
+            }
+        }
+
+        flush_idle(now);
+
+        for (i = 0; i < (int)g_port_count; i++) {
+            cap_port_t *p = &g_ports[i];
+
+            if (p->fd < 0 && now >= p->reopen_at) {
+                if (port_open(p) == 0) {
+                    p->reconnects++;
+                    fprintf(stderr, "[capture] %s: reconnected\n", p->name);
+                } else {
+                    p->reopen_at = now + CAP_REOPEN_MS;
+                }
+            }
+        }
+
+        if (now >= next_stats) {
+            report((double)(now - last_stats) / 1000.0, (double)(now - start) / 1000.0);
+            last_stats = now;
+            next_stats = now + stats_ms;
+        }
+    }
+}
+
+/* After the test boards stop: read until the ports go quiet */
+static void drain(void)
+{
+    struct epoll_event events[CAP_MAX_PORTS];
+    int n;
+    int i;
+
+    while ((n = epoll_wait(g_epoll, events, CAP_MAX_PORTS, (int)CAP_DRAIN_MS)) > 0) {
+        uint64_t now = now_ms();
+
+        stamp();
+        for (i = 0; i < n; i++) {
+            cap_port_t *p = events[i].data.ptr;
+
+            if (p->fd >= 0) {
+                port_read(p, now);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct sigaction sa;
+    pthread_t writer;
+    pthread_t generator;
+    const char *replay = NULL;
+    double seconds = 0.0;
+    unsigned stats_ms = 10000;
+    unsigned test = 0;
+    uint64_t start;
+    unsigned i;
+    int rc = 0;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--out") && a + 1 < argc) {
+            g_out_dir = argv[++a];
+        } else if (!strcmp(argv[a], "--baud") && a + 1 < argc) {
+            g_baud = baud_of(strtoul(argv[++a], NULL, 0));
+            if (!g_baud) {
+                fprintf(stderr, "[capture] unsupported baud rate %s\n", argv[a]);
+                return 2;
+            }
+        } else if (!strcmp(argv[a], "--time") && a + 1 < argc) {
+            seconds = strtod(argv[++a], NULL);
+        } else if (!strcmp(argv[a], "--stats") && a + 1 < argc) {
+            stats_ms = (unsigned)(strtod(argv[++a], NULL) * 1000.0);
+        } else if (!strcmp(argv[a], "--test") && a + 1 < argc) {
+            test = (unsigned)strtoul(argv[++a], NULL, 0);
+        } else if (!strcmp(argv[a], "--rate") && a + 1 < argc) {
+            g_gen_rate = strtod(argv[++a], NULL);
+        } else if (!strcmp(argv[a], "--replay") && a + 1 < argc) {
+            replay = argv[++a];
+        } else if (argv[a][0] != '-') {
+            break;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((test == 0) == (a == argc) || test > CAP_MAX_PORTS || stats_ms == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+    mkdir(g_out_dir, 0755);
+    stamp();
+
+    if (test) {
+        g_gen_data = replay ? replay_log(replay, &g_gen_size) : synthetic_log(&g_gen_size);
+        if (!g_gen_data) {
+            fprintf(stderr, "[capture] cannot read %s\n", replay);
+            return 1;
+        }
+        for (i = 0; i < test; i++) {
+            if (board_add(i) != 0) {
+                return 1;
+            }
+        }
+    } else {
+        for (; a < argc; a++) {
+            if (port_add(argv[a]) != 0) {
+                return 1;
+            }
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    pthread_create(&writer, NULL, writer_main, NULL);
+    if (test) {
+        pthread_create(&generator, NULL, generator_main, &test);
+    }
+
+    start = now_ms();
+    loop(seconds > 0 ? start + (uint64_t)(seconds * 1000.0) : 0, stats_ms, start);
+
+    if (test) {
+        g_gen_stop = 1;
+        pthread_join(generator, NULL);
+        drain();
+    }
+
+    /* Rows cut off at the end (no line end yet) are dropped, as by the logger */
+    for (i = 0; i < g_port_count; i++) {
+        submit(&g_ports[i]);
+    }
+    pthread_mutex_lock(&g_lock);
+    g_writer_stop = 1;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+    pthread_join(writer, NULL);
+
+    /* Final rates are over the whole run */
+    for (i = 0; i < g_port_count; i++) {
+        g_ports[i].window_bytes = g_ports[i].bytes;
+    }
+    report((double)(now_ms() - start) / 1000.0, (double)(now_ms() - start) / 1000.0);
+    if (test) {
+        rc = report_test(test);
+    }
+
+    for (i = 0; i < g_port_count; i++) {
+        if (g_ports[i].fd >= 0) {
+            close(g_ports[i].fd);
+        }
+        close(g_ports[i].out);
+    }
+    for (i = 0; i < test; i++) {
+        close(g_boards[i].fd);
+    }
+    return rc;
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+FIRA - Flash Image CRC Embedder
+===============================
+
+Post-link step (see the $(ELF) rule in the Makefile). Rebuilds the flash
+image from the ELF's loadable segments, exactly as it ends up in
+build/fira.hex (.text, then the .data initialisers), computes its CRC-32
+with the checksum slot g_flash_image left out, and writes length and CRC
+into that slot in the ELF itself. The HEX made from the ELF afterwards,
+and simavr runs of the ELF, carry the same value.
+
+Running it again on a patched ELF gives the same result, since the slot
+is not part of the checksum. Only needs the standard library.
+
+Usage:
+    python3 fira_flashcrc.py build/fira.elf
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+SLOT_SYMBOL = 'g_flash_image'
+SLOT_FORMAT = '<IH'                 # flash_image_t: crc, length
+SLOT_SIZE = struct.calcsize(SLOT_FORMAT)
+
+FLASH_LIMIT = 0x800000              # avr-gcc puts RAM at 0x800000, EEPROM at 0x810000
+FLASH_SIZE = 0x8000                 # ATmega328P
+
+PT_LOAD = 1
+SHT_SYMTAB = 2
+
+
+def read_elf32(path):
+    with open(path, 'rb') as f:
+        elf = bytearray(f.read())
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        raise ValueError(f"{path}: not a little-endian ELF32 file")
+    return elf
+
+
+def sections(elf):
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum = struct.unpack_from('<HH', elf, 0x2E)
+    for i in range(shnum):
+        yield struct.unpack_from('<IIIIIIIIII', elf, shoff + i * shentsize)
+
+
+def find_symbol(elf, name):
+    """(address, file offset) of a symbol, or None."""
+    secs = list(sections(elf))
+    for sec in secs:
+        if sec[1] != SHT_SYMTAB:
+            continue
+        strtab = secs[sec[6]]
+        for off in range(sec[4], sec[4] + sec[5], sec[9]):
+            st_name, st_value, _, _, _, st_shndx = struct.unpack_from('<IIIBBH', elf, off)
+            end = elf.index(b'\0', strtab[4] + st_name)
+            if elf[strtab[4] + st_name:end].decode('ascii', 'replace') != name:
+                continue
+            home = secs[st_shndx]
+            return st_value, home[4] + st_value - home[3]
+    return None
+
+
+def flash_image(elf):
+    """Loadable bytes placed at their load (flash) addresses."""
+    phoff, = struct.unpack_from('<I', elf, 0x1C)
+    phentsize, phnum = struct.unpack_from('<HH', elf, 0x2A)
+    image = bytearray()
+    for i in range(phnum):
+        p_type, p_offset, _, p_paddr, p_filesz, _, _, _ = \
+            struct.unpack_from('<IIIIIIII', elf, phoff + i * phentsize)
+        if p_type != PT_LOAD or p_filesz == 0 or p_paddr >= FLASH_LIMIT:
+            continue
+        end = p_paddr + p_filesz
+        if len(image) < end:
+            image.extend(b'\xff' * (end - len(image)))
+        image[p_paddr:end] = elf[p_offset:p_offset + p_filesz]
+    return image
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('elf', help='linked firmware (patched in place)')
+    args = parser.parse_args()
+
+    try:
+        elf = read_elf32(args.elf)
+    except (OSError, ValueError) as e:
+        print(f"fira_flashcrc: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    slot = find_symbol(elf, SLOT_SYMBOL)
+    if slot is None:
+        print(f"fira_flashcrc: no '{SLOT_SYMBOL}' in {args.elf}", file=sys.stderr)
+        sys.exit(1)
+    addr, offset = slot
+
+    image = flash_image(elf)
+    if not 0 < len(image) <= FLASH_SIZE or addr + SLOT_SIZE > len(image):
+        print(f"fira_flashcrc: bad image layout ({len(image)} bytes, slot at 0x{addr:04X})",
+              file=sys.stderr)
+        sys.exit(1)
+
+    # Same order as the firmware: everything but the slot, low to high
+    crc = zlib.crc32(image[:addr])
+    crc = zlib.crc32(image[addr + SLOT_SIZE:], crc)
+
+    struct.pack_into(SLOT_FORMAT, elf, offset, crc, len(image))
+    with open(args.elf, 'wb') as f:
+        f.write(elf)
+
+    print(f"CRC   {len(image)} bytes, CRC-32 0x{crc:08X} at 0x{addr:04X}")
+
+
+if __name__ == '__main__':
+    main()
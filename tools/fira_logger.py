@@ -19,6 +19,9 @@ import sys
 import time
 import csv
 import re
+import struct
+import binascii
+import math
 from datetime import datetime
 from collections import defaultdict
 
@@ -38,8 +41,8 @@ def find_arduino_port():
 
 def parse_heartbeat(line):
     """Extract data from heartbeat line."""
-    # Pattern: System Running: 123  [Uptime: 45s, Faults: 6]
-    pattern = r"System Running:\s*(\d+).*Uptime:\s*(\d+)s.*Faults:\s*(\d+)"
+    # Pattern: Counter: 123 | Running: 45s | Attacks: 6 |
+    pattern = r"Counter:\s*(\d+).*Running:\s*(\d+)s.*Attacks:\s*(\d+)"
     match = re.search(pattern, line)
     if match:
         return {
@@ -52,7 +55,18 @@ def parse_heartbeat(line):
 
 def parse_crash(line):
     """Detect crash notification."""
-    pattern = r"Total Crashes:\s*(\d+)"
+    # Pattern: Oops! I crashed. Total crashes so far: 3  /  | Total crashes: 3
+    pattern = r"Total crashes(?: so far)?:\s*(\d+)"
+    match = re.search(pattern, line, re.IGNORECASE)
+    if match:
+        return int(match.group(1))
+    return None
+
+
+def parse_downtime(line):
+    """Extract the firmware's cumulative measured downtime (ms)."""
+    # Pattern: | Total downtime: 4213ms  /  Total time down: 4213ms
+    pattern = r"Total (?:downtime|time down):\s*(\d+)\s*ms"
     match = re.search(pattern, line)
     if match:
         return int(match.group(1))
@@ -68,15 +82,132 @@ def parse_bitflip(line):
     return None
 
 
-def calculate_availability(total_uptime_sec, crash_count, wdt_timeout_sec=2):
-    """Calculate system availability percentage."""
-    if total_uptime_sec == 0:
+# Binary telemetry records (see include/telemetry.h)
+TLM_RECORDS = {
+    0x01: ('heartbeat', struct.Struct('<IIH'), ('counter', 'uptime_ms', 'faults')),
+    0x02: ('fault', struct.Struct('<IiH'), ('counter', 'delta', 'faults')),
+    0x03: ('crash', struct.Struct('<HB'), ('crashes', 'reset_reason')),
+    0x04: ('summary', struct.Struct('<IIHHIIH'),
+           ('uptime_ms', 'counter', 'faults', 'crashes', 'avail_ppm', 'downtime_ms', 'drops')),
+    0x05: ('crash_info', struct.Struct('<HHBIHBBB'),
+           ('pc', 'sp', 'sreg', 'systick_ms', 'faults', 'task', 'stalled', 'cause')),
+    0x06: ('recovery', struct.Struct('<II'), ('downtime_ms', 'total_downtime_ms')),
+    0x07: ('settings', struct.Struct('<BBBBB'), ('ok', 'mode', 'interval_sec', 'armed', 'arrival')),
+    0x08: ('jitter', struct.Struct('<BHH12H'),
+           ('task', 'interval_ms', 'skipped') + tuple(f'h{b}' for b in range(12))),
+}
+
+# Frames are far shorter than this; a longer run without 0x00 means ASCII
+TLM_MAX_CHUNK = 256
+
+
+def cobs_decode(data):
+    """Decode one COBS block (delimiter already stripped). Returns None if malformed."""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        code = data[i]
+        if code == 0 or i + code > n:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(chunk):
+    """Decode a COBS frame into a record dict, or None if it is not a valid frame."""
+    raw = cobs_decode(chunk)
+    if raw is None or len(raw) < 3:
+        return None
+    body, crc = raw[:-2], raw[-2] | (raw[-1] << 8)
+    if binascii.crc_hqx(body, 0xFFFF) != crc:
+        return None
+    layout = TLM_RECORDS.get(body[0])
+    if layout is None or len(body) - 1 != layout[1].size:
+        return None
+    record = dict(zip(layout[2], layout[1].unpack_from(body, 1)))
+    record['type'] = layout[0]
+    return record
+
+
+def format_record(record):
+    """Render a binary record as a single text line for the console and CSV."""
+    fields = ' '.join(f"{k}={v}" for k, v in record.items() if k != 'type')
+    return f"[{record['type'].upper()}] {fields}"
+
+
+class TelemetryStream:
+    """Split a mixed ASCII / COBS-framed byte stream into lines and records.
+
+    The firmware prints its boot banner as ASCII, then emits a single 0x00
+    and switches to frames. After a reboot the banner reappears; it fails
+    frame decoding and is passed through as text.
+    """
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.binary = False
+
+    def _text(self, data):
+        for line in data.decode('utf-8', errors='ignore').splitlines():
+            line = line.strip()
+            if line:
+                yield 'line', line
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            if self.binary:
+                end = self.buf.find(0)
+                if end < 0:
+                    if len(self.buf) > TLM_MAX_CHUNK:
+                        self.binary = False
+                        continue
+                    break
+                chunk = bytes(self.buf[:end])
+                del self.buf[:end + 1]
+                if not chunk:
+                    continue
+                record = decode_frame(chunk)
+                if record is not None:
+                    yield 'record', record
+                else:
+                    yield from self._text(chunk)
+            else:
+                nl = self.buf.find(b'\n')
+                zero = self.buf.find(0)
+                if zero >= 0 and (nl < 0 or zero < nl):
+                    text = bytes(self.buf[:zero])
+                    del self.buf[:zero + 1]
+                    self.binary = True
+                    yield from self._text(text)
+                    continue
+                if nl < 0:
+                    break
+                text = bytes(self.buf[:nl])
+                del self.buf[:nl + 1]
+                yield from self._text(text)
+
+
+def calculate_availability(total_uptime_sec, total_downtime_sec):
+    """Calculate system availability percentage from measured downtime."""
+    total_time = total_uptime_sec + total_downtime_sec
+    if total_time <= 0:
         return 100.0
-    total_downtime = crash_count * wdt_timeout_sec
-    total_time = total_uptime_sec + total_downtime
     return (total_uptime_sec / total_time) * 100
 
 
+def nines(availability_pct):
+    """Count the leading nines of an availability (99.97% -> 3)."""
+    unavailable = 1.0 - availability_pct / 100.0
+    if unavailable <= 0:
+        return float('inf')
+    return int(-math.log10(unavailable) + 1e-9)
+
+
 def main():
     # Parse arguments
     if len(sys.argv) >= 2:
@@ -114,7 +245,14 @@ Press Ctrl+C to stop logging and generate report.
         'total_faults': 0,
         'bitflips': [],
         'max_uptime': 0,
-        'samples': 0
+        'samples': 0,
+        # Downtime as measured by the firmware (ms), if it reports it
+        'fw_downtime_ms': None,
+        # Fallback: wall-clock gap from the last heartbeat before a crash
+        # to the first one after it, as seen by this host
+        'host_downtime_sec': 0.0,
+        'last_heartbeat_wall': None,
+        'gap_open': False,
     }
 
     try:
@@ -129,43 +267,76 @@ Press Ctrl+C to stop logging and generate report.
 
             print("Logging started. Waiting for data...\n")
 
+            stream = TelemetryStream()
+
             while True:
                 try:
-                    line = ser.readline().decode('utf-8', errors='ignore').strip()
-                    if not line:
+                    data = ser.read(ser.in_waiting or 1)
+                    if not data:
                         continue
 
-                    timestamp = datetime.now().isoformat()
-
-                    # Print to console
-                    print(line)
-
-                    # Parse different message types
-                    heartbeat = parse_heartbeat(line)
-                    crash_count = parse_crash(line)
-                    bitflip = parse_bitflip(line)
-
-                    # Update statistics
-                    counter = heartbeat['counter'] if heartbeat else ''
-                    uptime = heartbeat['uptime'] if heartbeat else ''
-                    faults = heartbeat['faults'] if heartbeat else ''
-                    crashes = crash_count if crash_count else ''
-                    bitflip_val = bitflip if bitflip else ''
-
-                    if heartbeat:
-                        stats['last_counter'] = heartbeat['counter']
-                        stats['max_uptime'] = max(stats['max_uptime'], heartbeat['uptime'])
-                        stats['total_faults'] = heartbeat['faults']
-                        stats['samples'] += 1
-
-                    if crash_count:
-                        stats['total_crashes'] = crash_count
-
-                    if bitflip:
-                        stats['bitflips'].append(bitflip)
-
-                    # Write to CSV
-                    writer.writerow([timestamp, counter, uptime, faults, crashes, bitflip_val, line])
+                    for kind, item in stream.feed(data):
+                        timestamp = datetime.now().isoformat()
+
+                        downtime_ms = None
+                        if kind == 'record':
+                            heartbeat, crash_count, bitflip = None, None, None
+                            if item['type'] == 'heartbeat':
+                                heartbeat = {
+                                    'counter': item['counter'],
+                                    'uptime': item['uptime_ms'] // 1000,
+                                    'faults': item['faults']
+                                }
+                            elif item['type'] == 'crash':
+                                crash_count = item['crashes']
+                            elif item['type'] == 'fault':
+                                bitflip = item['delta']
+                            elif item['type'] == 'recovery':
+                                downtime_ms = item['total_downtime_ms']
+                            elif item['type'] == 'summary':
+                                downtime_ms = item['downtime_ms']
+                            line = format_record(item)
+                        else:
+                            line = item
+                            heartbeat = parse_heartbeat(line)
+                            crash_count = parse_crash(line)
+                            bitflip = parse_bitflip(line)
+                            downtime_ms = parse_downtime(line)
+
+                        # Print to console
+                        print(line)
+
+                        # Update statistics
+                        counter = heartbeat['counter'] if heartbeat else ''
+                        uptime = heartbeat['uptime'] if heartbeat else ''
+                        faults = heartbeat['faults'] if heartbeat else ''
+                        crashes = crash_count if crash_count else ''
+                        bitflip_val = bitflip if bitflip else ''
+
+                        now = time.monotonic()
+                        if heartbeat:
+                            if stats['gap_open'] and stats['last_heartbeat_wall'] is not None:
+                                stats['host_downtime_sec'] += now - stats['last_heartbeat_wall']
+                            stats['gap_open'] = False
+                            stats['last_heartbeat_wall'] = now
+                            stats['last_counter'] = heartbeat['counter']
+                            stats['max_uptime'] = max(stats['max_uptime'], heartbeat['uptime'])
+                            stats['total_faults'] = heartbeat['faults']
+                            stats['samples'] += 1
+
+                        if crash_count:
+                            if crash_count > stats['total_crashes']:
+                                stats['gap_open'] = True
+                            stats['total_crashes'] = crash_count
+
+                        if downtime_ms is not None:
+                            stats['fw_downtime_ms'] = downtime_ms
+
+                        if bitflip:
+                            stats['bitflips'].append(bitflip)
+
+                        # Write to CSV
+                        writer.writerow([timestamp, counter, uptime, faults, crashes, bitflip_val, line])
                     csvfile.flush()
 
                 except KeyboardInterrupt:
@@ -183,7 +354,14 @@ Press Ctrl+C to stop logging and generate report.
 
     # Generate report
     duration = (datetime.now() - stats['start_time']).total_seconds()
-    availability = calculate_availability(stats['max_uptime'], stats['total_crashes'])
+    if stats['fw_downtime_ms'] is not None:
+        downtime_sec = stats['fw_downtime_ms'] / 1000.0
+        downtime_src = 'measured by firmware'
+    else:
+        downtime_sec = stats['host_downtime_sec']
+        downtime_src = 'heartbeat gaps seen by host'
+    availability = calculate_availability(stats['max_uptime'], downtime_sec)
+    mttr = downtime_sec / max(stats['total_crashes'], 1)
 
     print(f"""
 
@@ -202,8 +380,9 @@ Bit Flips Detected:   {len(stats['bitflips'])}
                     AVAILABILITY METRICS
 ───────────────────────────────────────────────────────────────
 
-System Availability:  {availability:.2f}%
-Mean Time To Recovery (MTTR): 2.0 seconds (WDT timeout)
+Total Downtime:       {downtime_sec:.3f} seconds ({downtime_src})
+System Availability:  {availability:.4f}% ({nines(availability)} nines)
+Mean Time To Recovery (MTTR): {mttr:.3f} seconds
 Mean Time Between Failures: {stats['max_uptime'] / max(stats['total_crashes'], 1):.1f} seconds
 
 ───────────────────────────────────────────────────────────────
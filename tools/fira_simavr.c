@@ -0,0 +1,560 @@
+/*
+ * ============================================================================
+ * FIRA - simavr Harness
+ * Cycle-accurate run of build/fira.elf with timing reports
+ * ============================================================================
+ *
+ * Loads the real AVR binary into simavr (atmega328p @ F_CPU), bridges
+ * USART0 to stdout or a pseudo-terminal and reports, in CPU cycles:
+ *
+ *   - boot time: reset vector -> first heartbeat, either a "Counter: " line
+ *     or a binary TLM_REC_HEARTBEAT frame (TELEMETRY_BINARY builds)
+ *   - ISR durations per vector (entry -> reti), min / avg / max
+ *   - recovery: fault injection ISR (TIMER1_COMPA) -> next heartbeat,
+ *     including any watchdog reset in between
+ *
+ * Gaps longer than the 16-bit compare reach TIMER1_COMPA several times,
+ * and only the last entry injects. The firmware's g_fault_left (ticks
+ * still to go) tells them apart: it is found in the ELF symbol table and
+ * read at each entry. Without it every entry counts as a fault.
+ *
+ * simavr's watchdog model resets the core and sets WDRF, so ATTACK_MODE_C
+ * recovers exactly as on the board. A jump to 0x0000 (ATTACK_MODE_B) shows
+ * up as a reset with no MCUSR flags.
+ *
+ * If the run ends without a single heartbeat the boot and recovery figures
+ * are meaningless: the harness says so and exits with status 3.
+ *
+ * Usage:
+ *   fira_simavr [--time SEC] [--pty] [--quiet] build/fira.elf
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "sim_interrupts.h"
+#include "avr_uart.h"
+
+
+#ifndef F_CPU
+#define F_CPU               16000000UL
+#endif
+
+#define SIM_MCU             "atmega328p"
+#define SIM_VECTORS         26U             /* Reset + 25 interrupt vectors */
+#define SIM_MAX_FAULTS      256U
+#define SIM_MAX_BOOTS       64U
+#define SIM_RX_QUEUE        256U
+#define SIM_REG_MCUSR       0x54
+#define SIM_RX_POLL_STEPS   4096U           /* Instructions between pty polls */
+
+#define SIM_VEC_TIMER1_COMPA 11U
+#define SIM_DATA_OFFSET     0x800000UL      /* Data space in AVR ELF addresses */
+#define SIM_SYM_FAULT_LEFT  "g_fault_left"
+
+/* Binary heartbeat: [0x01][counter:4][uptime_ms:4][faults:2][crc16:2] */
+#define SIM_REC_HEARTBEAT   0x01U
+#define SIM_HEARTBEAT_LEN   13U
+#define SIM_FRAME_MAX       64U             /* COBS bytes kept per frame */
+#define SIM_EXIT_NO_HEARTBEAT 3
+
+static const char heartbeat_marker[] = "Counter: ";
+
+static const char *const vector_names[SIM_VECTORS] = {
+    "RESET", "INT0", "INT1", "PCINT0", "PCINT1", "PCINT2", "WDT",
+    "TIMER2_COMPA", "TIMER2_COMPB", "TIMER2_OVF", "TIMER1_CAPT",
+    "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_OVF", "TIMER0_COMPA",
+    "TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART_RX", "USART_UDRE",
+    "USART_TX", "ADC", "EE_READY", "ANALOG_COMP", "TWI", "SPM_READY"
+};
+
+
+/* ============================================================================
+ * STATE
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t entered;           /* Cycle of the pending entry, 0 = not running */
+} isr_stats_t;
+
+typedef struct {
+    uint64_t at;                /* Cycle the fault ISR was entered */
+    uint64_t recovered;         /* Cycle of the next heartbeat, 0 = never */
+    uint8_t  resets;            /* Resets between fault and heartbeat */
+} fault_event_t;
+
+typedef struct {
+    uint64_t at;                /* Cycle of the reset vector */
+    uint64_t first_heartbeat;
+    uint8_t  mcusr;
+} boot_event_t;
+
+static avr_t *g_avr;
+static isr_stats_t g_isr[SIM_VECTORS];
+
+static fault_event_t g_faults[SIM_MAX_FAULTS];
+static uint32_t g_fault_count = 0;
+static uint32_t g_fault_open = 0;           /* First fault without a heartbeat */
+static uint32_t g_fault_left_addr = 0;      /* SRAM address of g_fault_left, 0 = unknown */
+static uint64_t g_fault_steps = 0;          /* TIMER1_COMPA entries inside a long gap */
+
+static boot_event_t g_boots[SIM_MAX_BOOTS];
+static uint32_t g_boot_count = 0;
+
+static uint32_t g_marker_match = 0;
+static uint8_t g_frame[SIM_FRAME_MAX];     /* Bytes since the last 0x00 */
+static uint32_t g_frame_len = 0;           /* > SIM_FRAME_MAX = overlong, ignored */
+static uint64_t g_text_heartbeats = 0;
+static uint64_t g_frame_heartbeats = 0;
+static uint8_t g_quiet = 0;
+static int g_pty = -1;
+
+static uint8_t g_rx_queue[SIM_RX_QUEUE];
+static uint16_t g_rx_head = 0;
+static uint16_t g_rx_tail = 0;
+static uint8_t g_rx_xon = 1;
+static avr_irq_t *g_uart_in;
+
+
+/* ============================================================================
+ * EVENTS
+ * ============================================================================ */
+
+static void on_heartbeat(void)
+{
+    uint64_t now = g_avr->cycle;
+
+    if (g_boot_count && !g_boots[g_boot_count - 1].first_heartbeat) {
+        g_boots[g_boot_count - 1].first_heartbeat = now;
+    }
+
+    while (g_fault_open < g_fault_count) {
+        g_faults[g_fault_open++].recovered = now;
+    }
+}
+
+static void on_reset(void)
+{
+    uint32_t v;
+
+    if (g_boot_count < SIM_MAX_BOOTS) {
+        g_boots[g_boot_count].at = g_avr->cycle;
+        g_boots[g_boot_count].first_heartbeat = 0;
+        g_boots[g_boot_count].mcusr = g_avr->data[SIM_REG_MCUSR];
+        g_boot_count++;
+    }
+
+    for (v = g_fault_open; v < g_fault_count; v++) {
+        g_faults[v].resets++;
+    }
+
+    /* A reset abandons any ISR in flight (e.g. the naked WDT handler) */
+    for (v = 0; v < SIM_VECTORS; v++) {
+        g_isr[v].entered = 0;
+    }
+    g_marker_match = 0;
+    g_frame_len = 0;
+}
+
+/* 1 if this TIMER1_COMPA entry only moves the compare on inside a long gap */
+static int fault_isr_is_step(void)
+{
+    const uint8_t *p;
+
+    if (!g_fault_left_addr) {
+        return 0;
+    }
+    p = &g_avr->data[g_fault_left_addr];
+    return (p[0] | p[1] | p[2] | p[3]) != 0;
+}
+
+/* AVR_INT_IRQ_RUNNING: 1 on vector entry, 0 on reti */
+static void isr_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    isr_stats_t *s = &g_isr[(uintptr_t)param];
+    uint64_t now = g_avr->cycle;
+    (void)irq;
+
+    if (value) {
+        s->entered = now ? now : 1;
+        if ((uintptr_t)param == SIM_VEC_TIMER1_COMPA && fault_isr_is_step()) {
+            g_fault_steps++;
+        } else if ((uintptr_t)param == SIM_VEC_TIMER1_COMPA && g_fault_count < SIM_MAX_FAULTS) {
+            g_faults[g_fault_count].at = now;
+            g_faults[g_fault_count].recovered = 0;
+            g_faults[g_fault_count].resets = 0;
+            g_fault_count++;
+        }
+        return;
+    }
+
+    if (s->entered) {
+        uint64_t d = now - s->entered;
+        if (s->count == 0 || d < s->min) {
+            s->min = d;
+        }
+        if (d > s->max) {
+            s->max = d;
+        }
+        s->total += d;
+        s->count++;
+        s->entered = 0;
+    }
+}
+
+/* ============================================================================
+ * HEARTBEAT DETECTION
+ * ============================================================================ */
+
+/* CRC-16/CCITT-FALSE, as crc16_ccitt() in the firmware */
+static uint16_t crc16_ccitt(const uint8_t *p, uint32_t len)
+{
+    uint16_t crc = 0xFFFFU;
+    uint8_t i;
+
+    while (len--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* 1 if the COBS bytes before a 0x00 decode to a valid heartbeat record */
+static int frame_is_heartbeat(const uint8_t *src, uint32_t len)
+{
+    uint8_t raw[SIM_FRAME_MAX];
+    uint32_t n = 0;
+    uint32_t i = 0;
+    uint16_t crc;
+
+    while (i < len) {
+        uint8_t code = src[i++];
+        uint8_t k;
+
+        if (code == 0 || i + code - 1U > len) {
+            return 0;
+        }
+        for (k = 1; k < code; k++) {
+            raw[n++] = src[i++];
+        }
+        if (i < len) {
+            raw[n++] = 0;
+        }
+    }
+
+    if (n != SIM_HEARTBEAT_LEN || raw[0] != SIM_REC_HEARTBEAT) {
+        return 0;
+    }
+    crc = crc16_ccitt(raw, n - 2U);
+    return raw[n - 2U] == (uint8_t)crc && raw[n - 1U] == (uint8_t)(crc >> 8);
+}
+
+static void scan_heartbeat(uint8_t c)
+{
+    /* ASCII heartbeat line */
+    if (c == (uint8_t)heartbeat_marker[g_marker_match]) {
+        if (++g_marker_match == sizeof(heartbeat_marker) - 1) {
+            g_marker_match = 0;
+            g_text_heartbeats++;
+            on_heartbeat();
+        }
+    } else {
+        g_marker_match = (c == (uint8_t)heartbeat_marker[0]) ? 1U : 0U;
+    }
+
+    /* Binary heartbeat frame; ASCII lines just overflow the buffer */
+    if (c == 0) {
+        if (g_frame_len > 0 && g_frame_len <= SIM_FRAME_MAX &&
+            frame_is_heartbeat(g_frame, g_frame_len)) {
+            g_frame_heartbeats++;
+            on_heartbeat();
+        }
+        g_frame_len = 0;
+    } else if (g_frame_len < SIM_FRAME_MAX) {
+        g_frame[g_frame_len++] = c;
+    } else {
+        g_frame_len = SIM_FRAME_MAX + 1U;
+    }
+}
+
+/* ============================================================================
+ * UART BRIDGE
+ * ============================================================================ */
+
+static void uart_out_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    uint8_t c = (uint8_t)value;
+    (void)irq;
+    (void)param;
+
+    if (g_pty >= 0) {
+        if (write(g_pty, &c, 1) < 0) {
+            /* Nobody attached to the pty yet */
+        }
+    } else if (!g_quiet) {
+        putchar(c);
+    }
+
+    scan_heartbeat(c);
+}
+
+static void uart_xon_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)value;
+    g_rx_xon = (uint8_t)(uintptr_t)param;
+}
+
+/* Move bytes typed on the pty into USART0 while its receiver has room */
+static void uart_pump_rx(void)
+{
+    uint8_t buf[64];
+    ssize_t n;
+    ssize_t i;
+
+    if (g_pty < 0) {
+        return;
+    }
+
+    n = read(g_pty, buf, sizeof(buf));
+    for (i = 0; i < n; i++) {
+        uint16_t next = (uint16_t)((g_rx_head + 1U) % SIM_RX_QUEUE);
+        if (next != g_rx_tail) {
+            g_rx_queue[g_rx_head] = buf[i];
+            g_rx_head = next;
+        }
+    }
+
+    while (g_rx_xon && g_rx_tail != g_rx_head) {
+        avr_raise_irq(g_uart_in, g_rx_queue[g_rx_tail]);
+        g_rx_tail = (uint16_t)((g_rx_tail + 1U) % SIM_RX_QUEUE);
+    }
+}
+
+static int open_pty(void)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("pty");
+        exit(1);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "[simavr] UART0 on %s\n", ptsname(fd));
+    return fd;
+}
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================ */
+
+static double cycles_to_us(uint64_t cycles)
+{
+    return (double)cycles * 1e6 / (double)F_CPU;
+}
+
+static void report(void)
+{
+    uint32_t i;
+
+    fprintf(stderr, "\n[simavr] %.3f s simulated (%llu cycles)\n",
+            (double)g_avr->cycle / (double)F_CPU, (unsigned long long)g_avr->cycle);
+
+    fprintf(stderr, "[simavr] heartbeats: %llu text, %llu binary\n",
+            (unsigned long long)g_text_heartbeats, (unsigned long long)g_frame_heartbeats);
+
+    fprintf(stderr, "\nBoots (reset vector -> first heartbeat):\n");
+    for (i = 0; i < g_boot_count; i++) {
+        const boot_event_t *b = &g_boots[i];
+        fprintf(stderr, "  #%-3u MCUSR=0x%02X  ", i, b->mcusr);
+        if (b->first_heartbeat) {
+            fprintf(stderr, "%10llu cycles  %10.1f us\n",
+                    (unsigned long long)(b->first_heartbeat - b->at),
+                    cycles_to_us(b->first_heartbeat - b->at));
+        } else {
+            fprintf(stderr, "no heartbeat\n");
+        }
+    }
+
+    fprintf(stderr, "\nISR durations (entry -> reti, cycles):\n");
+    fprintf(stderr, "  %-14s %10s %8s %8s %8s\n", "vector", "count", "min", "avg", "max");
+    for (i = 1; i < SIM_VECTORS; i++) {
+        const isr_stats_t *s = &g_isr[i];
+        if (s->count) {
+            fprintf(stderr, "  %-14s %10llu %8llu %8llu %8llu\n", vector_names[i],
+                    (unsigned long long)s->count, (unsigned long long)s->min,
+                    (unsigned long long)(s->total / s->count), (unsigned long long)s->max);
+        }
+    }
+
+    fprintf(stderr, "\nRecovery (fault ISR -> next heartbeat):\n");
+    if (g_fault_left_addr) {
+        fprintf(stderr, "  (%llu long-gap compare step%s not counted)\n",
+                (unsigned long long)g_fault_steps, g_fault_steps == 1 ? "" : "s");
+    } else {
+        fprintf(stderr, "  (no %s symbol: every TIMER1_COMPA entry counted)\n", SIM_SYM_FAULT_LEFT);
+    }
+    for (i = 0; i < g_fault_count; i++) {
+        const fault_event_t *f = &g_faults[i];
+        fprintf(stderr, "  fault %-3u at %10.3f ms  ", i + 1, cycles_to_us(f->at) / 1000.0);
+        if (f->recovered) {
+            fprintf(stderr, "%12.1f us  (%u reset%s)\n", cycles_to_us(f->recovered - f->at),
+                    f->resets, f->resets == 1 ? "" : "s");
+        } else {
+            fprintf(stderr, "not recovered\n");
+        }
+    }
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+/* g_fault_left from the ELF symbols; LTO may suffix a static (".lto_priv.0") */
+static void find_fault_left(const elf_firmware_t *fw)
+{
+#if ELF_SYMBOLS
+    size_t n = strlen(SIM_SYM_FAULT_LEFT);
+    uint32_t i;
+
+    for (i = 0; i < fw->symbolcount; i++) {
+        const avr_symbol_t *sym = fw->symbol[i];
+        if (strncmp(sym->symbol, SIM_SYM_FAULT_LEFT, n) == 0 &&
+            (sym->symbol[n] == '\0' || sym->symbol[n] == '.') &&
+            sym->addr >= SIM_DATA_OFFSET && sym->size == 4) {
+            g_fault_left_addr = sym->addr - SIM_DATA_OFFSET;
+            return;
+        }
+    }
+#else
+    (void)fw;
+#endif
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--time SEC] [--pty] [--quiet] firmware.elf\n"
+            "  --time SEC  simulated seconds to run (default 30)\n"
+            "  --pty       bridge UART0 to a pseudo-terminal instead of stdout\n"
+            "  --quiet     do not echo UART0 (reports only)\n"
+            "Heartbeats are \"Counter: \" lines or binary TLM_REC_HEARTBEAT frames.\n"
+            "Exits with status %d if the run never saw one (nothing was measured).\n",
+            prog, SIM_EXIT_NO_HEARTBEAT);
+}
+
+int main(int argc, char **argv)
+{
+    elf_firmware_t fw;
+    const char *elf = NULL;
+    double seconds = 30.0;
+    uint64_t limit;
+    uint32_t flags = 0;
+    avr_irq_t *irq;
+    uint32_t v;
+    uint32_t steps = 0;
+    int state = cpu_Running;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--time") && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "--pty")) {
+            g_pty = open_pty();
+        } else if (!strcmp(argv[i], "--quiet")) {
+            g_quiet = 1;
+        } else if (argv[i][0] != '-' && !elf) {
+            elf = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!elf) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(elf, &fw) != 0) {
+        fprintf(stderr, "[simavr] cannot load %s\n", elf);
+        return 1;
+    }
+    strncpy(fw.mmcu, SIM_MCU, sizeof(fw.mmcu) - 1);
+    fw.frequency = F_CPU;
+
+    g_avr = avr_make_mcu_by_name(SIM_MCU);
+    if (!g_avr) {
+        fprintf(stderr, "[simavr] no core for %s\n", SIM_MCU);
+        return 1;
+    }
+    avr_init(g_avr);
+    avr_load_firmware(g_avr, &fw);
+    find_fault_left(&fw);
+
+    /* UART0: our own sink instead of simavr's line-buffered stdio echo */
+    avr_ioctl(g_avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(g_avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+    irq = avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT);
+    avr_irq_register_notify(irq, uart_out_hook, NULL);
+    g_uart_in = avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+    irq = avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUT_XON);
+    avr_irq_register_notify(irq, uart_xon_hook, (void *)(uintptr_t)1);
+    irq = avr_io_getirq(g_avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUT_XOFF);
+    avr_irq_register_notify(irq, uart_xon_hook, (void *)(uintptr_t)0);
+
+    for (v = 1; v < SIM_VECTORS; v++) {
+        irq = avr_get_interrupt_irq(g_avr, (uint8_t)v);
+        if (irq) {
+            avr_irq_register_notify(irq + AVR_INT_IRQ_RUNNING, isr_hook, (void *)(uintptr_t)v);
+        }
+    }
+
+    limit = (uint64_t)(seconds * (double)F_CPU);
+    on_reset();
+
+    while (state != cpu_Done && state != cpu_Crashed && g_avr->cycle < limit) {
+        avr_flashaddr_t pc = g_avr->pc;
+
+        state = avr_run(g_avr);
+
+        if (g_avr->pc == 0 && pc != 0) {
+            on_reset();
+        }
+        if (++steps == SIM_RX_POLL_STEPS) {
+            steps = 0;
+            uart_pump_rx();
+        }
+    }
+
+    fflush(stdout);
+    report();
+
+    if (state == cpu_Crashed) {
+        return 1;
+    }
+    if (g_text_heartbeats + g_frame_heartbeats == 0) {
+        fprintf(stderr, "\n[simavr] ERROR: no heartbeat seen in %.3f s, neither a \"Counter: \" "
+                "line nor a binary heartbeat frame; boot and recovery times were not measured\n",
+                (double)g_avr->cycle / (double)F_CPU);
+        return SIM_EXIT_NO_HEARTBEAT;
+    }
+    return 0;
+}
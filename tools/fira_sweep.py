@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+FIRA - Fault Campaign Sweep
+===========================
+
+Runs every attack mode x injection interval combination through the
+firmware's UART command channel (see include/cmd.h), without reflashing.
+For each configuration it disarms, sets mode and interval, resets the
+stats, arms, lets a fixed number of heartbeats go by and records the
+query answer as one CSV row.
+
+Works against a board on a serial port or against the host build, whose
+virtual clock runs far faster than real time. Heartbeats, not wall time,
+measure each run, so both give the same data. Needs the ASCII console
+(TELEMETRY_BINARY = 0).
+
+Usage:
+    python3 fira_sweep.py --port /dev/ttyACM0 [options]
+    python3 fira_sweep.py --sim build/host/fira_host [options]
+
+Requirements:
+    pip install pyserial   (only for --port)
+"""
+
+import argparse
+import csv
+import os
+import re
+import select
+import subprocess
+import sys
+import tempfile
+import time
+
+BAUD_RATE = 115200
+
+REPLY_TIMEOUT = 5.0     # seconds per command attempt
+REPLY_RETRIES = 4       # a reset mid-command loses the line
+
+OK_PATTERN = re.compile(r"^OK mode=(\w) int=(\d+) armed=(\d)(.*)$")
+FIELD_PATTERN = re.compile(r"(\w+)=(\d+)")
+
+
+class SerialLink:
+    """Board on a serial port."""
+
+    def __init__(self, port):
+        import serial
+        self.ser = serial.Serial(port, BAUD_RATE, timeout=0.2)
+        time.sleep(2)  # Wait for the bootloader after the DTR reset
+
+    def write(self, data):
+        self.ser.write(data)
+
+    def readline(self, timeout):
+        deadline = time.monotonic() + timeout
+        buf = b''
+        while time.monotonic() < deadline:
+            buf += self.ser.readline()
+            if buf.endswith(b'\n'):
+                return buf.decode('ascii', errors='replace').strip()
+        return None
+
+    def close(self):
+        self.ser.close()
+
+
+class SimLink:
+    """Host build fed through --uart-in on stdin."""
+
+    def __init__(self, binary, eeprom):
+        self.proc = subprocess.Popen(
+            [binary, '--time', '100000000', '--eeprom', eeprom, '--uart-in', '-'],
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+        self.buf = b''
+
+    def write(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+    def readline(self, timeout):
+        deadline = time.monotonic() + timeout
+        fd = self.proc.stdout.fileno()
+        while b'\n' not in self.buf:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            ready, _, _ = select.select([fd], [], [], left)
+            if ready:
+                chunk = os.read(fd, 4096)
+                if not chunk:
+                    return None
+                self.buf += chunk
+        line, self.buf = self.buf.split(b'\n', 1)
+        return line.decode('ascii', errors='replace').strip()
+
+    def close(self):
+        self.proc.kill()
+        self.proc.wait()
+
+
+class Sweep:
+    def __init__(self, link, verbose):
+        self.link = link
+        self.verbose = verbose
+        self.heartbeats = 0
+        self.boots = 0
+        self.bitflips = 0
+
+    def _line(self, timeout):
+        line = self.link.readline(timeout)
+        if line is None:
+            return None
+        if self.verbose:
+            print(f"  < {line}")
+        if line.startswith('Counter:'):
+            self.heartbeats += 1
+            if 'CORRUPTION DETECTED' in line:
+                self.bitflips += 1
+        elif line.startswith('Hey! I just woke up'):
+            self.boots += 1
+        return line
+
+    def command(self, cmd):
+        """Send one command, return the parsed OK reply (or raise)."""
+        for _ in range(REPLY_RETRIES):
+            self.link.write(cmd.encode('ascii') + b'\n')
+            deadline = time.monotonic() + REPLY_TIMEOUT
+            while time.monotonic() < deadline:
+                line = self._line(deadline - time.monotonic())
+                if line is None:
+                    break
+                if line == 'ERR':
+                    raise RuntimeError(f"firmware rejected '{cmd}'")
+                match = OK_PATTERN.match(line)
+                if match:
+                    reply = {
+                        'mode': match.group(1),
+                        'interval': int(match.group(2)),
+                        'armed': int(match.group(3)),
+                    }
+                    reply.update({k: int(v) for k, v in FIELD_PATTERN.findall(match.group(4))})
+                    return reply
+        raise RuntimeError(f"no reply to '{cmd}'")
+
+    def wait_heartbeats(self, count):
+        target = self.heartbeats + count
+        while self.heartbeats < target:
+            if self._line(REPLY_TIMEOUT * 4) is None:
+                raise RuntimeError("device went silent")
+
+    def run(self, mode, interval, heartbeats):
+        self.command('d')
+        self.command(f'm {mode}')
+        self.command(f'i {interval}')
+        self.command('r')
+        self.command('a')
+
+        self.boots = 0
+        self.bitflips = 0
+        start = self.heartbeats
+        self.wait_heartbeats(heartbeats)
+        result = self.command('q')
+
+        result.update({
+            'heartbeats': self.heartbeats - start,
+            'reboots': self.boots,
+            'bitflips_seen': self.bitflips,
+        })
+        return result
+
+
+COLUMNS = ['mode', 'interval', 'heartbeats', 'faults', 'crashes', 'reboots',
+           'bitflips_seen', 'fixed', 'uptime', 'downtime', 'ppm', 'counter']
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument('--port', help='serial port of the board')
+    target.add_argument('--sim', metavar='BINARY', help='host build (build/host/fira_host)')
+    parser.add_argument('--modes', default='n,a,b,c', help='attack modes, n or a-j (default: n,a,b,c)')
+    parser.add_argument('--intervals', default='1,2,3,5,10',
+                        help='injection intervals in seconds (default: 1,2,3,5,10)')
+    parser.add_argument('--heartbeats', type=int, default=600,
+                        help='heartbeats per configuration (default: 600 = 60 s)')
+    parser.add_argument('--csv', default='fira_sweep.csv', help='output file')
+    parser.add_argument('-v', '--verbose', action='store_true', help='echo the console')
+    args = parser.parse_args()
+
+    modes = [m.strip().lower() for m in args.modes.split(',') if m.strip()]
+    intervals = [int(i) for i in args.intervals.split(',') if i.strip()]
+
+    eeprom = None
+    if args.sim:
+        fd, eeprom = tempfile.mkstemp(prefix='fira_sweep_', suffix='.bin')
+        os.close(fd)
+        os.unlink(eeprom)       # Let the simulator create a blank one
+        link = SimLink(args.sim, eeprom)
+    else:
+        link = SerialLink(args.port)
+
+    sweep = Sweep(link, args.verbose)
+    total = len(modes) * len(intervals)
+
+    try:
+        with open(args.csv, 'w', newline='') as csvfile:
+            writer = csv.DictWriter(csvfile, fieldnames=COLUMNS, extrasaction='ignore')
+            writer.writeheader()
+
+            for n, (mode, interval) in enumerate(
+                    ((m, i) for m in modes for i in intervals), 1):
+                print(f"[{n}/{total}] mode {mode.upper()} every {interval}s ...",
+                      end='', flush=True)
+                row = sweep.run(mode, interval, args.heartbeats)
+                writer.writerow(row)
+                csvfile.flush()
+                print(f" faults={row['faults']} crashes={row['crashes']}"
+                      f" downtime={row['downtime']}ms availability={row['ppm'] / 1e4:.4f}%")
+
+            # Leave the board safe
+            sweep.command('d')
+    except RuntimeError as e:
+        print(f"\nSweep aborted: {e}", file=sys.stderr)
+        sys.exit(1)
+    finally:
+        link.close()
+        if eeprom and os.path.exists(eeprom):
+            os.unlink(eeprom)
+
+    print(f"Results written to {args.csv}")
+
+
+if __name__ == '__main__':
+    main()